@@ -69,6 +69,7 @@
 #include "search.h"
 #include "select.h"
 #include "set.h"
+#include "snapshot.h"
 #include "thermal.h"
 #include "undo.h"
 #include "rtree.h"
@@ -166,6 +167,7 @@ typedef enum
   F_ResetLinesAndPolygons,
   F_ResetPinsViasAndPads,
   F_Restore,
+  F_Resume,
   F_Rotate,
   F_Save,
   F_Selected,
@@ -405,6 +407,7 @@ static FunctionType Functions[] = {
   {"ResetLinesAndPolygons", F_ResetLinesAndPolygons},
   {"ResetPinsViasAndPads", F_ResetPinsViasAndPads},
   {"Restore", F_Restore},
+  {"Resume", F_Resume},
   {"Revert", F_Revert},
   {"Rotate", F_Rotate},
   {"Save", F_Save},
@@ -1885,6 +1888,7 @@ ActionDumpLibrary (int argc, char **argv, Coord x, Coord y)
 {
   int i, j;
 
+  WaitForLibrary ();
   printf ("**** Do not count on this format.  It will change ****\n\n");
   printf ("MenuN   = %d\n", (int) Library.MenuN);
   printf ("MenuMax = %d\n", (int) Library.MenuMax);
@@ -2445,12 +2449,12 @@ ActionDisperseElements (int argc, char **argv, Coord x, Coord y)
 	dy -= (element->MarkY + dy) % PCB->Grid;
 	dy += PCB->Grid;
 
-	/* move the element */
-	MoveElementLowLevel (PCB->Data, element, dx, dy);
-
 	/* and add to the undo list so we can undo this operation */
 	AddObjectToMoveUndoList (ELEMENT_TYPE, NULL, NULL, element, dx, dy);
 
+	/* move the element */
+	MoveElementLowLevel (PCB->Data, element, dx, dy);
+
 	/* keep track of how tall this row is */
 	minx += element->BoundingBox.X2 - element->BoundingBox.X1 + GAP;
 	if (maxy < element->BoundingBox.Y2)
@@ -3943,7 +3947,9 @@ ActionAutoPlaceSelected (int argc, char **argv, Coord x, Coord y)
 
 /* --------------------------------------------------------------------------- */
 
-static const char autoroute_syntax[] = N_("AutoRoute(AllRats|SelectedRats)");
+static const char autoroute_syntax[] =
+  N_("AutoRoute(AllRats|SelectedRats)\n"
+     "AutoRoute(Resume[, filename])");
 
 static const char autoroute_help[] = N_("Auto-route some or all rat lines.");
 
@@ -3957,6 +3963,12 @@ Attempt to autoroute all rats.
 @item SelectedRats
 Attempt to autoroute the selected rats.
 
+@item Resume
+Continue an autoroute run from the state saved after its last finished
+pass, see the @code{--autoroute-checkpoint} option.  The file name
+defaults to the value of that option.  The layout, the layer groups
+and the routing styles must not have changed since.
+
 @end table
 
 Before autorouting, it's important to set up a few things.  First,
@@ -3988,6 +4000,11 @@ ActionAutoRoute (int argc, char **argv, Coord x, Coord y)
 	  if (AutoRoute (true))
 	    SetChangedFlag (true);
 	  break;
+	case F_Resume:
+	  if (AutoRouteResume (ARG (1) ? ARG (1)
+			       : Settings.AutorouteCheckpoint))
+	    SetChangedFlag (true);
+	  break;
 	}
     }
   return 0;
@@ -4537,13 +4554,11 @@ ActionChangePinName (int argc, char **argv, Coord x, Coord y)
 	{
 	  if (NSTRCMP (pinnum, pin->Number) == 0)
 	    {
-	      AddObjectToChangeNameUndoList (PIN_TYPE, NULL, NULL,
-					     pin, pin->Name);
-	      /*
-	       * Note:  we can't free() pin->Name first because 
-	       * it is used in the undo list
-	       */
-	      pin->Name = strdup (pinname);
+	      /* the undo list keeps its own copy of the interned name */
+	      AddObjectToChangeNameUndoList (PIN_TYPE, element, pin,
+					     pin, STRDUP (pin->Name));
+	      ReleaseString (pin->Name);
+	      pin->Name = InternString (pinname);
 	      SetChangedFlag (true);
 	      changed = 1;
 	    }
@@ -4554,13 +4569,11 @@ ActionChangePinName (int argc, char **argv, Coord x, Coord y)
 	{
 	  if (NSTRCMP (pinnum, pad->Number) == 0)
 	    {
-	      AddObjectToChangeNameUndoList (PAD_TYPE, NULL, NULL,
-					     pad, pad->Name);
-	      /* 
-	       * Note:  we can't free() pad->Name first because 
-	       * it is used in the undo list
-	       */
-	      pad->Name = strdup (pinname);
+	      /* the undo list keeps its own copy of the interned name */
+	      AddObjectToChangeNameUndoList (PAD_TYPE, element, pad,
+					     pad, STRDUP (pad->Name));
+	      ReleaseString (pad->Name);
+	      pad->Name = InternString (pinname);
 	      SetChangedFlag (true);
 	      changed = 1;
 	    }
@@ -5720,7 +5733,8 @@ ActionUnselect (int argc, char **argv, Coord x, Coord y)
 static const char saveto_syntax[] =
   N_("SaveTo(Layout|LayoutAs,filename)\n"
   "SaveTo(AllConnections|AllUnusedPins|ElementConnections,filename)\n"
-  "SaveTo(PasteBuffer,filename)");
+  "SaveTo(PasteBuffer,filename)\n"
+  "SaveTo(Snapshot,filename)");
 
 static const char saveto_help[] = N_("Saves data to a file.");
 
@@ -5746,6 +5760,12 @@ Save connections to the element at the cursor to a file.
 @item PasteBuffer
 Save the content of the active Buffer to a file. This is the graphical way to create a footprint.
 
+@item Snapshot
+Saves the current layout as a binary snapshot.  Snapshots load much
+faster than @file{.pcb} files and are loaded like any layout, but they
+are not meant to be edited by hand or kept under version control.  The
+layout isn't marked as saved, and its filename isn't changed.
+
 @end table
 
 %end-doc */
@@ -5836,6 +5856,11 @@ ActionSaveTo (int argc, char **argv, Coord x, Coord y)
       return SaveBufferElements (name);
     }
 
+  if (strcasecmp (function, "Snapshot") == 0)
+    {
+      return SaveSnapshot (name);
+    }
+
   AFAIL (saveto);
 }
 
@@ -7016,6 +7041,8 @@ delete_attr (AttributeListType *list, AttributeType *attr)
   int idx = attr - list->List;
   if (idx < 0 || idx >= list->Number)
     return;
+  ReleaseString (attr->name);
+  ReleaseString (attr->value);
   if (list->Number - idx > 1)
     memmove (attr, attr+1, (list->Number - idx - 1) * sizeof(AttributeType));
   list->Number --;
@@ -7295,8 +7322,8 @@ ActionElementSetAttr (int argc, char **argv, Coord x, Coord y)
 
   if (attr && value)
     {
-      free (attr->value);
-      attr->value = strdup (value);
+      ReleaseString (attr->value);
+      attr->value = InternString (value);
     }
   if (attr && ! value)
     {
@@ -7367,8 +7394,8 @@ pcb_spawnvp (char **argv)
   else
     {
       int rv;
-      /* Parent */
-      wait (&rv);
+      /* Parent; don't reap somebody else's child, like a backup */
+      waitpid (pid, &rv, 0);
     }
   return 0;
 #endif
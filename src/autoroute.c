@@ -65,7 +65,14 @@
 #include "global.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <setjmp.h>
+#include <stddef.h>
+#if defined (HAVE_FORK) && defined (HAVE_SYS_WAIT_H)
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "data.h"
 #include "macro.h"
@@ -110,6 +117,11 @@
 //#define DEBUG_SHOW_ZIGZAG
 */
 
+/* Batches of nets are routed by child processes when we can fork. */
+#if defined (HAVE_FORK) && defined (HAVE_SYS_WAIT_H)
+#define PARALLEL_ROUTE
+#endif
+
 static direction_t
 directionIncrement(direction_t dir)
 {
@@ -320,6 +332,38 @@ typedef struct routebox
 }
 routebox_t;
 
+/*!
+ * \brief Fixed-size object pool for routeboxes and edges.
+ *
+ * A route creates and drops millions of expansion areas and edges, and
+ * the obstacles of a board number in the tens of thousands, so these
+ * are carved out of slabs owned by the pool instead of going through
+ * malloc one by one.  Objects handed back with route_pool_put() are
+ * recycled through a free list; route_pool_reset() drops all objects at
+ * once but keeps the slabs for the next user, route_pool_destroy()
+ * gives the slabs back to the system.
+ */
+typedef struct route_slab route_slab;
+struct route_slab
+{
+  route_slab *next;
+  double data[1];		/*!< aligned start of the objects. */
+};
+
+typedef struct route_pool
+{
+  size_t size;			/*!< object size, at least a pointer. */
+  route_slab *slabs;		/*!< all slabs, in the order they are carved. */
+  route_slab *cur;		/*!< slab being carved, or NULL. */
+  int used;			/*!< objects carved from cur. */
+  void *free_list;		/*!< recycled objects, linked through their first word. */
+} route_pool_t;
+
+#define ROUTE_POOL(type) { sizeof (type), NULL, NULL, 0, NULL }
+
+/*! Objects carved out of each slab. */
+#define ROUTE_POOL_SLAB 512
+
 typedef struct routedata
 {
   /* one rtree per layer *group */
@@ -335,6 +379,8 @@ typedef struct routedata
   Coord max_bloat;
   Coord max_keep;
   mtspace_t *mtspace;
+  /* all routeboxes of the board and of the routes made on it */
+  route_pool_t boxes;
 }
 routedata_t;
 
@@ -346,6 +392,7 @@ typedef struct edge_struct
   cost_t cost;			/* cached edge cost */
   routebox_t *mincost_target;	/* minimum cost from cost_point to any target */
   vetting_t *work;		/* for via search edges */
+  int heap_index;		/* position in the work heap, or 0 */
   direction_t expand_dir;
   struct
   {
@@ -405,6 +452,14 @@ struct routeone_state
   cost_t best_cost;
 };
 
+struct routeone_status
+{
+  bool found_route;
+  int route_had_conflicts;
+  cost_t best_route_cost;
+  bool net_completely_routed;
+};
+
 
 /* ---------------------------------------------------------------------------
  * some local prototypes
@@ -447,6 +502,201 @@ static int passes = 12;
 static int routing_layers = 0;
 static float total_wire_length = 0;
 static int total_via_count = 0;
+/* work of the searches, for the statistics of a pass */
+static struct
+{
+  long edges;			/* edges expanded */
+  long mtspace_queries;		/* queries for via sites */
+} route_work;
+
+/* ---------------------------------------------------------------------------
+ * object pools, see route_pool_t
+ */
+static void *
+route_pool_get (route_pool_t * pool)
+{
+  void *obj = pool->free_list;
+
+  if (obj != NULL)
+    {
+      pool->free_list = *(void **) obj;
+      return obj;
+    }
+  if (pool->cur == NULL || pool->used == ROUTE_POOL_SLAB)
+    {
+      route_slab *next = pool->cur ? pool->cur->next : pool->slabs;
+
+      if (next == NULL)
+	{
+	  next = (route_slab *) malloc (offsetof (route_slab, data)
+					+ pool->size * ROUTE_POOL_SLAB);
+	  assert (next);
+	  next->next = NULL;
+	  if (pool->cur)
+	    pool->cur->next = next;
+	  else
+	    pool->slabs = next;
+	}
+      pool->cur = next;
+      pool->used = 0;
+    }
+  return (char *) pool->cur->data + pool->size * pool->used++;
+}
+
+static void *
+route_pool_get0 (route_pool_t * pool)
+{
+  void *obj = route_pool_get (pool);
+
+  memset (obj, 0, pool->size);
+  return obj;
+}
+
+static void
+route_pool_put (route_pool_t * pool, void *obj)
+{
+  *(void **) obj = pool->free_list;
+  pool->free_list = obj;
+}
+
+/*!
+ * \brief Drops all objects of the pool at once, keeping the slabs.
+ */
+static void
+route_pool_reset (route_pool_t * pool)
+{
+  pool->cur = NULL;
+  pool->used = 0;
+  pool->free_list = NULL;
+}
+
+static void
+route_pool_destroy (route_pool_t * pool)
+{
+  while (pool->slabs)
+    {
+      route_slab *slab = pool->slabs;
+
+      pool->slabs = slab->next;
+      free (slab);
+    }
+  route_pool_reset (pool);
+}
+
+/* the expansion areas and edges of one search, dropped by RouteOne() */
+static route_pool_t area_pool = ROUTE_POOL (routebox_t);
+static route_pool_t edge_pool = ROUTE_POOL (edge_t);
+
+/* ---------------------------------------------------------------------------
+ * recording the routes of a net, see RouteBatch()
+ */
+typedef enum
+{
+  JOB_LINE,			/* RD_DrawLine() */
+  JOB_VIA,			/* RD_DrawVia() */
+  JOB_THERMAL,			/* RD_DrawThermal() */
+  JOB_MERGE,			/* MergeNets() of a routed subnet */
+  JOB_BAD,			/* a conflicting box */
+  JOB_ROUTED,			/* the result of RouteOne() */
+  JOB_DONE			/* the net is finished */
+} job_op_type;
+
+/* a box made since the recording started can't be passed by address */
+typedef struct
+{
+  int made;			/* 1 + index in job.made, or 0 */
+  routebox_t *rb;
+} job_box_t;
+
+typedef struct
+{
+  job_op_type type;
+  Coord X1, Y1, X2, Y2, thick;
+  Cardinal group, layer;
+  bool is_bad, is_45;
+  job_box_t a, b;
+  struct routeone_status ros;
+  cost_t cost;
+  long edges, mtspace_queries;	/* route_work of the net, for JOB_DONE */
+} job_op_t;
+
+static struct
+{
+  /* the boxes made by the RD_Draw*() functions, in order, or NULL */
+  vector_t *made;
+  /* the recorded operations, in a child only */
+  job_op_t *ops;
+  int n_ops, max_ops;
+  /* the part of the board the net must stay in */
+  BoxType region;
+  bool outside;
+} job;
+
+static job_box_t
+job_box (routebox_t * rb)
+{
+  job_box_t b;
+  int i;
+
+  b.made = 0;
+  b.rb = rb;
+  if (job.made)
+    for (i = vector_size (job.made); i > 0; i--)
+      if (vector_element (job.made, i - 1) == rb)
+	{
+	  b.made = i;
+	  b.rb = NULL;
+	  break;
+	}
+  return b;
+}
+
+#ifdef PARALLEL_ROUTE
+static routebox_t *
+job_unbox (job_box_t b)
+{
+  if (b.made)
+    return (routebox_t *) vector_element (job.made, b.made - 1);
+  return b.rb;
+}
+#endif
+
+/*!
+ * \brief Notes a box made while a net is recorded or replayed.
+ */
+static void
+job_made (routebox_t * rb)
+{
+  if (!job.made)
+    return;
+  vector_append (job.made, rb);
+  if (!box_in_box (&job.region, &rb->box))
+    job.outside = true;
+}
+
+/*!
+ * \brief Adds an operation to the record of a child.
+ *
+ * \return NULL if nothing is recorded.
+ */
+static job_op_t *
+job_record (job_op_type type)
+{
+  job_op_t *op;
+
+  if (!job.ops)
+    return NULL;
+  if (job.n_ops == job.max_ops)
+    {
+      job.max_ops *= 2;
+      job.ops = (job_op_t *) realloc (job.ops,
+				      job.max_ops * sizeof (job_op_t));
+    }
+  op = &job.ops[job.n_ops++];
+  memset (op, 0, sizeof (*op));
+  op->type = type;
+  return op;
+}
 
 /* assertion helper for routeboxen */
 #ifndef NDEBUG
@@ -649,8 +899,8 @@ point_in_shrunk_box (const routebox_t * box, Coord X, Coord Y)
  */
 
 static routebox_t *
-AddPin (PointerListType layergroupboxes[], PinType *pin, bool is_via,
-	RouteStyleType * style)
+AddPin (routedata_t * rd, PointerListType layergroupboxes[], PinType *pin,
+	bool is_via, RouteStyleType * style)
 {
   routebox_t **rbpp, *lastrb = NULL;
   int i, ht;
@@ -658,8 +908,7 @@ AddPin (PointerListType layergroupboxes[], PinType *pin, bool is_via,
   for (i = 0; i < max_group; i++)
     {
       rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[i]);
-      *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-      memset ((void *) *rbpp, 0, sizeof (**rbpp));
+      *rbpp = (routebox_t *) route_pool_get0 (&rd->boxes);
       (*rbpp)->group = i;
       ht = HALF_THICK (MAX (pin->Thickness, pin->DrillingHole));
       init_const_box (*rbpp,
@@ -696,7 +945,7 @@ AddPin (PointerListType layergroupboxes[], PinType *pin, bool is_via,
   return lastrb;
 }
 static routebox_t *
-AddPad (PointerListType layergroupboxes[],
+AddPad (routedata_t * rd, PointerListType layergroupboxes[],
 	ElementType *element, PadType *pad, RouteStyleType * style)
 {
   Coord halfthick;
@@ -706,9 +955,7 @@ AddPad (PointerListType layergroupboxes[],
   assert (PCB->LayerGroups.Number[layergroup] > 0);
   rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[layergroup]);
   assert (rbpp);
-  *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-  assert (*rbpp);
-  memset (*rbpp, 0, sizeof (**rbpp));
+  *rbpp = (routebox_t *) route_pool_get0 (&rd->boxes);
   (*rbpp)->group = layergroup;
   halfthick = HALF_THICK (pad->Thickness);
   init_const_box (*rbpp,
@@ -731,8 +978,8 @@ AddPad (PointerListType layergroupboxes[],
   return *rbpp;
 }
 static routebox_t *
-AddLine (PointerListType layergroupboxes[], int layergroup, LineType *line,
-	 LineType *ptr, RouteStyleType * style)
+AddLine (routedata_t * rd, PointerListType layergroupboxes[], int layergroup,
+	 LineType *line, LineType *ptr, RouteStyleType * style)
 {
   routebox_t **rbpp;
   assert (layergroupboxes && line);
@@ -740,8 +987,7 @@ AddLine (PointerListType layergroupboxes[], int layergroup, LineType *line,
   assert (PCB->LayerGroups.Number[layergroup] > 0);
 
   rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[layergroup]);
-  *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-  memset (*rbpp, 0, sizeof (**rbpp));
+  *rbpp = (routebox_t *) route_pool_get0 (&rd->boxes);
   (*rbpp)->group = layergroup;
   init_const_box (*rbpp,
 		  /*X1 */ MIN (line->Point1.X,
@@ -775,7 +1021,7 @@ AddLine (PointerListType layergroupboxes[], int layergroup, LineType *line,
   return *rbpp;
 }
 static routebox_t *
-AddIrregularObstacle (PointerListType layergroupboxes[],
+AddIrregularObstacle (routedata_t * rd, PointerListType layergroupboxes[],
 		      Coord X1, Coord Y1,
 		      Coord X2, Coord Y2, Cardinal layergroup,
 		      void *parent, RouteStyleType * style)
@@ -788,8 +1034,7 @@ AddIrregularObstacle (PointerListType layergroupboxes[],
   assert (PCB->LayerGroups.Number[layergroup] > 0);
 
   rbpp = (routebox_t **) GetPointerMemory (&layergroupboxes[layergroup]);
-  *rbpp = (routebox_t *)malloc (sizeof (**rbpp));
-  memset (*rbpp, 0, sizeof (**rbpp));
+  *rbpp = (routebox_t *) route_pool_get0 (&rd->boxes);
   (*rbpp)->group = layergroup;
   init_const_box (*rbpp, X1, Y1, X2, Y2, keep);
   (*rbpp)->flags.nonstraight = 1;
@@ -803,14 +1048,14 @@ AddIrregularObstacle (PointerListType layergroupboxes[],
 }
 
 static routebox_t *
-AddPolygon (PointerListType layergroupboxes[], Cardinal layer,
-	    PolygonType *polygon, RouteStyleType * style)
+AddPolygon (routedata_t * rd, PointerListType layergroupboxes[],
+	    Cardinal layer, PolygonType *polygon, RouteStyleType * style)
 {
   int is_not_rectangle = 1;
   int layergroup = GetLayerGroupNumberByNumber (layer);
   routebox_t *rb;
   assert (0 <= layergroup && layergroup < max_group);
-  rb = AddIrregularObstacle (layergroupboxes,
+  rb = AddIrregularObstacle (rd, layergroupboxes,
 			     polygon->BoundingBox.X1,
 			     polygon->BoundingBox.Y1,
 			     polygon->BoundingBox.X2,
@@ -839,19 +1084,19 @@ AddPolygon (PointerListType layergroupboxes[], Cardinal layer,
   return rb;
 }
 static void
-AddText (PointerListType layergroupboxes[], Cardinal layergroup,
-	 TextType *text, RouteStyleType * style)
+AddText (routedata_t * rd, PointerListType layergroupboxes[],
+	 Cardinal layergroup, TextType *text, RouteStyleType * style)
 {
-  AddIrregularObstacle (layergroupboxes,
+  AddIrregularObstacle (rd, layergroupboxes,
 			text->BoundingBox.X1, text->BoundingBox.Y1,
 			text->BoundingBox.X2, text->BoundingBox.Y2,
 			layergroup, text, style);
 }
 static routebox_t *
-AddArc (PointerListType layergroupboxes[], Cardinal layergroup,
-	ArcType *arc, RouteStyleType * style)
+AddArc (routedata_t * rd, PointerListType layergroupboxes[],
+	Cardinal layergroup, ArcType *arc, RouteStyleType * style)
 {
-  return AddIrregularObstacle (layergroupboxes,
+  return AddIrregularObstacle (rd, layergroupboxes,
 			       arc->BoundingBox.X1, arc->BoundingBox.Y1,
 			       arc->BoundingBox.X2, arc->BoundingBox.Y2,
 			       layergroup, arc, style);
@@ -993,6 +1238,7 @@ CreateRouteData ()
   /* create routedata */
   rd = (routedata_t *)malloc (sizeof (*rd));
   memset ((void *) rd, 0, sizeof (*rd));
+  rd->boxes.size = sizeof (routebox_t);
   /* create default style */
   rd->defaultstyle.Thick = Settings.LineThickness;
   rd->defaultstyle.Diameter = Settings.ViaThickness;
@@ -1081,7 +1327,7 @@ CreateRouteData ()
 			  && fake_line.Point2.Y == line->Point2.Y)
 			break;
 		      rb =
-			AddLine (layergroupboxes, connection->group,
+			AddLine (rd, layergroupboxes, connection->group,
 				 &fake_line, line, rd->styles[j]);
 		      if (last_in_subnet && rb != last_in_subnet)
 			MergeNets (last_in_subnet, rb, ORIGINAL);
@@ -1092,13 +1338,13 @@ CreateRouteData ()
 		    }
 		  fake_line.Point2 = line->Point2;
 		  rb =
-		    AddLine (layergroupboxes, connection->group, &fake_line,
+		    AddLine (rd, layergroupboxes, connection->group, &fake_line,
 			     line, rd->styles[j]);
 		}
 	      else
 		{
 		  rb =
-		    AddLine (layergroupboxes, connection->group, line, line,
+		    AddLine (rd, layergroupboxes, connection->group, line, line,
 			     rd->styles[j]);
 		}
 	    }
@@ -1107,22 +1353,22 @@ CreateRouteData ()
 	      {
 	      case PAD_TYPE:
 		rb =
-		  AddPad (layergroupboxes, (ElementType *)connection->ptr1,
+		  AddPad (rd, layergroupboxes, (ElementType *)connection->ptr1,
 			  (PadType *)connection->ptr2, rd->styles[j]);
 		break;
 	      case PIN_TYPE:
 		rb =
-		  AddPin (layergroupboxes, (PinType *)connection->ptr2, false,
+		  AddPin (rd, layergroupboxes, (PinType *)connection->ptr2, false,
 			  rd->styles[j]);
 		break;
 	      case VIA_TYPE:
 		rb =
-		  AddPin (layergroupboxes, (PinType *)connection->ptr2, true,
+		  AddPin (rd, layergroupboxes, (PinType *)connection->ptr2, true,
 			  rd->styles[j]);
 		break;
 	      case POLYGON_TYPE:
 		rb =
-		  AddPolygon (layergroupboxes,
+		  AddPolygon (rd, layergroupboxes,
 			      GetLayerNumber (PCB->Data, (LayerType *)connection->ptr1),
 			      (struct polygon_st *)connection->ptr2, rd->styles[j]);
 		break;
@@ -1163,7 +1409,7 @@ CreateRouteData ()
     if (TEST_FLAG (DRCFLAG, pin))
       CLEAR_FLAG (DRCFLAG, pin);
     else
-      AddPin (layergroupboxes, pin, false, rd->styles[NUM_STYLES]);
+      AddPin (rd, layergroupboxes, pin, false, rd->styles[NUM_STYLES]);
   }
   ENDALL_LOOP;
   ALLPAD_LOOP (PCB->Data);
@@ -1171,7 +1417,7 @@ CreateRouteData ()
     if (TEST_FLAG (DRCFLAG, pad))
       CLEAR_FLAG (DRCFLAG, pad);
     else
-      AddPad (layergroupboxes, element, pad, rd->styles[NUM_STYLES]);
+      AddPad (rd, layergroupboxes, element, pad, rd->styles[NUM_STYLES]);
   }
   ENDALL_LOOP;
   /* add all vias */
@@ -1180,7 +1426,7 @@ CreateRouteData ()
     if (TEST_FLAG (DRCFLAG, via))
       CLEAR_FLAG (DRCFLAG, via);
     else
-      AddPin (layergroupboxes, via, true, rd->styles[NUM_STYLES]);
+      AddPin (rd, layergroupboxes, via, true, rd->styles[NUM_STYLES]);
   }
   END_LOOP;
 
@@ -1214,17 +1460,17 @@ CreateRouteData ()
 		if (fake_line.Point2.X == line->Point2.X
 		    && fake_line.Point2.Y == line->Point2.Y)
 		  break;
-		AddLine (layergroupboxes, layergroup, &fake_line, line,
+		AddLine (rd, layergroupboxes, layergroup, &fake_line, line,
 			 rd->styles[NUM_STYLES]);
 		fake_line.Point1 = fake_line.Point2;
 	      }
 	    fake_line.Point2 = line->Point2;
-	    AddLine (layergroupboxes, layergroup, &fake_line, line,
+	    AddLine (rd, layergroupboxes, layergroup, &fake_line, line,
 		     rd->styles[NUM_STYLES]);
 	  }
 	else
 	  {
-	    AddLine (layergroupboxes, layergroup, line, line,
+	    AddLine (rd, layergroupboxes, layergroup, line, line,
 		     rd->styles[NUM_STYLES]);
 	  }
       }
@@ -1235,19 +1481,19 @@ CreateRouteData ()
 	if (TEST_FLAG (DRCFLAG, polygon))
 	  CLEAR_FLAG (DRCFLAG, polygon);
 	else
-	  AddPolygon (layergroupboxes, i, polygon, rd->styles[NUM_STYLES]);
+	  AddPolygon (rd, layergroupboxes, i, polygon, rd->styles[NUM_STYLES]);
       }
       END_LOOP;
       /* add all copper text */
       TEXT_LOOP (LAYER_PTR (i));
       {
-	AddText (layergroupboxes, layergroup, text, rd->styles[NUM_STYLES]);
+	AddText (rd, layergroupboxes, layergroup, text, rd->styles[NUM_STYLES]);
       }
       END_LOOP;
       /* add all arcs */
       ARC_LOOP (LAYER_PTR (i));
       {
-	AddArc (layergroupboxes, layergroup, arc, rd->styles[NUM_STYLES]);
+	AddArc (rd, layergroupboxes, layergroup, arc, rd->styles[NUM_STYLES]);
       }
       END_LOOP;
     }
@@ -1258,7 +1504,7 @@ CreateRouteData ()
       /* create the r-tree */
       rd->layergrouptree[i] =
 	r_create_tree ((const BoxType **) layergroupboxes[i].Ptr,
-		       layergroupboxes[i].PtrN, 1);
+		       layergroupboxes[i].PtrN, 0);
     }
 
   if (AutoRouteParameters.use_vias)
@@ -1293,6 +1539,7 @@ DestroyRouteData (routedata_t ** rd)
     r_destroy_tree (&(*rd)->layergrouptree[i]);
   if (AutoRouteParameters.use_vias)
     mtspace_destroy (&(*rd)->mtspace);
+  route_pool_destroy (&(*rd)->boxes);
   free (*rd);
   *rd = NULL;
 }
@@ -1325,7 +1572,7 @@ RB_down_count (routebox_t * rb)
     {
       if (rb->parent.expansion_area->flags.homeless)
 	RB_down_count (rb->parent.expansion_area);
-      free (rb);
+      route_pool_put (&area_pool, rb);
     }
 }
 
@@ -1753,9 +2000,7 @@ CreateEdge (routebox_t * rb,
 {
   edge_t *e;
   assert (__routebox_is_good (rb));
-  e = (edge_t *)malloc (sizeof (*e));
-  memset ((void *) e, 0, sizeof (*e));
-  assert (e);
+  e = (edge_t *) route_pool_get0 (&edge_pool);
   e->rb = rb;
   if (rb->flags.homeless)
     RB_up_count (rb);
@@ -1952,7 +2197,7 @@ KillEdge (void *edge)
     RB_down_count (e->rb);
   if (e->flags.via_search)
     mtsFreeWork (&e->work);
-  free (e);
+  route_pool_put (&edge_pool, e);
 }
 
 static void
@@ -2089,8 +2334,7 @@ CreateExpansionArea (const BoxType * area, Cardinal group,
 		     routebox_t * parent,
 		     bool relax_edge_requirements, edge_t * src_edge)
 {
-  routebox_t *rb = (routebox_t *) malloc (sizeof (*rb));
-  memset ((void *) rb, 0, sizeof (*rb));
+  routebox_t *rb = (routebox_t *) route_pool_get0 (&area_pool);
   assert (area && parent);
   init_const_box (rb, area->X1, area->Y1, area->X2, area->Y2, 0);
   rb->group = group;
@@ -2498,8 +2742,7 @@ blocker_to_heap (heap_t * heap, routebox_t * rb,
 static routebox_t *
 CreateBridge (const BoxType * area, routebox_t * parent, direction_t dir)
 {
-  routebox_t *rb = (routebox_t *) malloc (sizeof (*rb));
-  memset ((void *) rb, 0, sizeof (*rb));
+  routebox_t *rb = (routebox_t *) route_pool_get0 (&area_pool);
   assert (area && parent);
   init_const_box (rb, area->X1, area->Y1, area->X2, area->Y2, 0);
   rb->group = parent->group;
@@ -2656,7 +2899,7 @@ moveable_edge (vector_t * result, const BoxType * box, direction_t dir,
       if (!box_is_good (&b))
 	return;			/* how did this happen ? */
       nrb = CreateBridge (&b, rb, dir);
-      r_insert_entry (tree, &nrb->box, 1);
+      r_insert_entry (tree, &nrb->box, 0);
       vector_append (area_vec, nrb);
       nrb->flags.homeless = 0;	/* not homeless any more */
       /* mark this one as conflicted */
@@ -2720,7 +2963,7 @@ moveable_edge (vector_t * result, const BoxType * box, direction_t dir,
       assert (box_intersect (&b, &blocker->sbox));
       b = shrink_box (&b, 1);
       nrb = CreateBridge (&b, rb, dir);
-      r_insert_entry (tree, &nrb->box, 1);
+      r_insert_entry (tree, &nrb->box, 0);
       vector_append (area_vec, nrb);
       nrb->flags.homeless = 0;	/* not homeless any more */
       ne = CreateEdge (nrb, nrb->cost_point.X, nrb->cost_point.Y,
@@ -3241,8 +3484,18 @@ RD_DrawThermal (routedata_t * rd, Coord X, Coord Y,
 		bool is_bad)
 {
   routebox_t *rb;
-  rb = (routebox_t *) malloc (sizeof (*rb));
-  memset ((void *) rb, 0, sizeof (*rb));
+  job_op_t *op;
+
+  if ((op = job_record (JOB_THERMAL)))
+    {
+      op->X1 = X;
+      op->Y1 = Y;
+      op->group = group;
+      op->layer = layer;
+      op->a = job_box (subnet);
+      op->is_bad = is_bad;
+    }
+  rb = (routebox_t *) route_pool_get0 (&rd->boxes);
   init_const_box (rb, X, Y, X + 1, Y + 1, 0);
   rb->group = group;
   rb->layer = layer;
@@ -3256,8 +3509,9 @@ RD_DrawThermal (routedata_t * rd, Coord X, Coord Y,
   MergeNets (rb, subnet, NET);
   MergeNets (rb, subnet, SUBNET);
   /* add it to the r-tree, this may be the whole route! */
-  r_insert_entry (rd->layergrouptree[rb->group], &rb->box, 1);
+  r_insert_entry (rd->layergrouptree[rb->group], &rb->box, 0);
   rb->flags.homeless = 0;
+  job_made (rb);
 }
 
 static void
@@ -3268,7 +3522,16 @@ RD_DrawVia (routedata_t * rd, Coord X, Coord Y,
   int i;
   int ka = AutoRouteParameters.style->Keepaway;
   PinType *live_via = NULL;
+  job_op_t *op;
 
+  if ((op = job_record (JOB_VIA)))
+    {
+      op->X1 = X;
+      op->Y1 = Y;
+      op->thick = radius;
+      op->a = job_box (subnet);
+      op->is_bad = is_bad;
+    }
   if (TEST_FLAG (LIVEROUTEFLAG, PCB))
     {
        live_via = CreateNewVia (PCB->Data, X, Y, radius * 2,
@@ -3284,8 +3547,7 @@ RD_DrawVia (routedata_t * rd, Coord X, Coord Y,
     {
       if (!is_layer_group_active[i])
 	continue;
-      rb = (routebox_t *) malloc (sizeof (*rb));
-      memset ((void *) rb, 0, sizeof (*rb));
+      rb = (routebox_t *) route_pool_get0 (&rd->boxes);
       init_const_box (rb,
 		      /*X1 */ X - radius, /*Y1 */ Y - radius,
 		      /*X2 */ X + radius + 1, /*Y2 */ Y + radius + 1, ka);
@@ -3317,9 +3579,10 @@ RD_DrawVia (routedata_t * rd, Coord X, Coord Y,
       MergeNets (rb, subnet, SUBNET);
       assert (__routebox_is_good (rb));
       /* and add it to the r-tree! */
-      r_insert_entry (rd->layergrouptree[rb->group], &rb->box, 1);
+      r_insert_entry (rd->layergrouptree[rb->group], &rb->box, 0);
       rb->flags.homeless = 0;	/* not homeless anymore */
       rb->livedraw_obj.via = live_via;
+      job_made (rb);
     }
 }
 static void
@@ -3341,6 +3604,20 @@ RD_DrawLine (routedata_t * rd,
 
   routebox_t *rb;
   Coord ka = AutoRouteParameters.style->Keepaway;
+  job_op_t *op;
+
+  if ((op = job_record (JOB_LINE)))
+    {
+      op->X1 = X1;
+      op->Y1 = Y1;
+      op->X2 = X2;
+      op->Y2 = Y2;
+      op->thick = halfthick;
+      op->group = group;
+      op->a = job_box (subnet);
+      op->is_bad = is_bad;
+      op->is_45 = is_45;
+    }
 
   /* don't draw zero-length segments. */
   if (X1 == X2 && Y1 == Y2)
@@ -3377,8 +3654,7 @@ RD_DrawLine (routedata_t * rd,
   /* dump the queue, no match here */
   if (qX1 == -1)
     return;			/* but not this! */
-  rb = (routebox_t *) malloc (sizeof (*rb));
-  memset ((void *) rb, 0, sizeof (*rb));
+  rb = (routebox_t *) route_pool_get0 (&rd->boxes);
   assert (is_45 ? (ABS (qX2 - qX1) == ABS (qY2 - qY1))	/* line must be 45-degrees */
 	  : (qX1 == qX2 || qY1 == qY2) /* line must be ortho */ );
   init_const_box (rb,
@@ -3405,7 +3681,8 @@ RD_DrawLine (routedata_t * rd,
   MergeNets (rb, qsn, SUBNET);
   assert (__routebox_is_good (rb));
   /* and add it to the r-tree! */
-  r_insert_entry (rd->layergrouptree[rb->group], &rb->box, 1);
+  r_insert_entry (rd->layergrouptree[rb->group], &rb->box, 0);
+  job_made (rb);
 
   if (TEST_FLAG (LIVEROUTEFLAG, PCB))
     {
@@ -3772,9 +4049,7 @@ CreateSearchEdge (struct routeone_state *s, vetting_t * work, edge_t * parent,
   if (cost < s->best_cost)
     {
       edge_t *ne;
-      ne = (edge_t *)malloc (sizeof (*ne));
-      memset ((void *) ne, 0, sizeof (*ne));
-      assert (ne);
+      ne = (edge_t *) route_pool_get0 (&edge_pool);
       ne->flags.via_search = 1;
       ne->flags.in_plane = in_plane;
       ne->rb = rb;
@@ -3786,7 +4061,7 @@ CreateSearchEdge (struct routeone_state *s, vetting_t * work, edge_t * parent,
       ne->cost_to_point = parent->cost_to_point;
       ne->cost_point = parent->cost_point;
       ne->cost = cost;
-      heap_insert (s->workheap, ne->cost, ne);
+      heap_insert_indexed (s->workheap, ne->cost, ne, &ne->heap_index);
     }
   else
     {
@@ -3801,7 +4076,7 @@ add_or_destroy_edge (struct routeone_state *s, edge_t * e)
   assert (__edge_is_good (e));
   assert (is_layer_group_active[e->rb->group]);
   if (e->cost < s->best_cost)
-    heap_insert (s->workheap, e->cost, e);
+    heap_insert_indexed (s->workheap, e->cost, e, &e->heap_index);
   else
     DestroyEdge (&e);
 }
@@ -3826,6 +4101,8 @@ best_path_candidate (struct routeone_state *s,
       /* don't free this when we destroy edge! */
       if (s->best_path->flags.homeless)
 	RB_up_count (s->best_path);
+      /* the edges costing as much won't be expanded; free them now */
+      heap_prune (s->workheap, s->best_cost, KillEdge);
     }
 }
 
@@ -3859,6 +4136,7 @@ add_via_sites (struct routeone_state *s,
      XXX: routing with conflicts may poke over edge. */
 
   /* ask for a via box near our cost_point first */
+  route_work.mtspace_queries++;
   work = mtspace_query_rect (mtspace, &region, radius, keepaway,
 			     NULL, vss->free_space_vec,
 			     vss->lo_conflict_space_vec,
@@ -3872,7 +4150,13 @@ add_via_sites (struct routeone_state *s,
 		    targets, in_plane);
 }
 
-void
+/*!
+ * \brief Goes on with a deferred search for via sites.
+ *
+ * \return true if the search edge went back into the work heap, for
+ * the rest of the search.
+ */
+bool
 do_via_search (edge_t * search, struct routeone_state *s,
 	       struct routeone_via_site_state *vss, mtspace_t * mtspace,
 	       rtree_t * targets)
@@ -3885,6 +4169,7 @@ do_via_search (edge_t * search, struct routeone_state *s,
 
   radius = HALF_THICK (AutoRouteParameters.style->Diameter);
   keepaway = AutoRouteParameters.style->Keepaway;
+  route_work.mtspace_queries++;
   work = mtspace_query_rect (mtspace, NULL, 0, 0,
 			     search->work, vss->free_space_vec,
 			     vss->lo_conflict_space_vec,
@@ -3926,15 +4211,22 @@ do_via_search (edge_t * search, struct routeone_state *s,
 	    }
 	}
     }
-  /* prevent freeing of work when this edge is destroyed */
-  search->flags.via_search = 0;
   if (!work)
-    return;
-  CreateSearchEdge (s, work, search, within, within_conflict_level, targets,
-		    search->flags.in_plane);
+    {
+      /* prevent freeing of work when this edge is destroyed */
+      search->flags.via_search = 0;
+      return false;
+    }
   assert (vector_is_empty (vss->free_space_vec));
   assert (vector_is_empty (vss->lo_conflict_space_vec));
   assert (vector_is_empty (vss->hi_conflict_space_vec));
+  /* the rest of the search goes back into the heap, at the same cost */
+  search->work = work;
+  if (search->cost >= s->best_cost)
+    return false;
+  heap_insert_indexed (s->workheap, search->cost, search,
+		       &search->heap_index);
+  return true;
 }
 
 /* vector of expansion areas to be eventually removed from r-tree
@@ -4058,15 +4350,6 @@ source_conflicts (rtree_t * tree, routebox_t * rb)
   touch_conflicts (NULL, 1);
 }
 
-struct routeone_status
-{
-  bool found_route;
-  int route_had_conflicts;
-  cost_t best_route_cost;
-  bool net_completely_routed;
-};
-
-
 static struct routeone_status
 RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 {
@@ -4080,6 +4363,7 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
   vector_t *source_vec;
   /* working vector */
   vector_t *edge_vec;
+  job_op_t *op;
 
   struct routeone_state s;
   struct routeone_via_site_state vss;
@@ -4219,7 +4503,7 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
       edge_t *e = (edge_t *)vector_remove_last (source_vec);
       assert (is_layer_group_active[e->rb->group]);
       e->cost = edge_cost (e, EXPENSIVE);
-      heap_insert (s.workheap, e->cost, e);
+      heap_insert_indexed (s.workheap, e->cost, e, &e->heap_index);
     }
   vector_destroy (&source_vec);
   /* okay, process items from heap until it is empty! */
@@ -4250,12 +4534,14 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
        */
       if (seen++ > max_edges)
 	goto dontexpand;
+      route_work.edges++;
       assert (__edge_is_good (e));
       /* mark or unmark conflictors as needed */
       touch_conflicts (e->rb->conflicts_with, 1);
       if (e->flags.via_search)
 	{
-	  do_via_search (e, &s, &vss, rd->mtspace, targets);
+	  if (do_via_search (e, &s, &vss, rd->mtspace, targets))
+	    continue;		/* the edge went back into the heap */
 	  goto dontexpand;
 	}
       /* we should never add edges on inactive layer groups to the heap. */
@@ -4345,7 +4631,7 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 	         &e->rb->box, NULL, no_planes,0));
 	       */
 	      r_insert_entry (rd->layergrouptree[e->rb->group], &e->rb->box,
-			      1);
+			      0);
 	      e->rb->flags.homeless = 0;	/* not homeless any more */
 	      /* add to vector of all expansion areas in r-tree */
 	      vector_append (area_vec, e->rb);
@@ -4500,7 +4786,7 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 	    goto dontexpand;
 	  nrb = CreateExpansionArea (&ans->inflated, e->rb->group, e->rb,
 				     true, e);
-	  r_insert_entry (rd->layergrouptree[nrb->group], &nrb->box, 1);
+	  r_insert_entry (rd->layergrouptree[nrb->group], &nrb->box, 0);
 	  vector_append (area_vec, nrb);
 	  nrb->flags.homeless = 0;	/* not homeless any more */
 	  broken =
@@ -4547,6 +4833,12 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 	    {
 	      rb = (routebox_t *)vector_remove_last (s.best_path->conflicts_with);
 	      rb->flags.is_bad = 1;
+	      if ((op = job_record (JOB_BAD)))
+		{
+		  op->a = job_box (rb);
+		  if (!box_in_box (&job.region, &rb->box))
+		    job.outside = true;
+		}
 	      result.route_had_conflicts++;
 	    }
 	}
@@ -4560,6 +4852,11 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
 	  TracePath (rd, s.best_path, s.best_target, from,
 		     result.route_had_conflicts);
 	  MergeNets (from, s.best_target, SUBNET);
+	  if ((op = job_record (JOB_MERGE)))
+	    {
+	      op->a = job_box (from);
+	      op->b = job_box (s.best_target);
+	    }
 	}
       else
 	{
@@ -4591,6 +4888,10 @@ RouteOne (routedata_t * rd, routebox_t * from, routebox_t * to, int max_edges)
       r_delete_entry (rd->layergrouptree[rb->group], &rb->box);
     }
   vector_destroy (&area_vec);
+  /* the search is over: drop its expansion areas, including homeless
+   * ones still held by the best path, and its edges in one go */
+  route_pool_reset (&area_pool);
+  route_pool_reset (&edge_pool);
   /* clean up; remove all 'source', 'target', and 'nobloat' flags */
   LIST_LOOP (from, same_net, p);
   if (p->flags.source && p->conflicts_with)
@@ -4715,6 +5016,8 @@ struct routeall_status
   /* net was ripped */
   int ripped;
   int total_nets_routed;
+  /* nets routed in this pass */
+  int nets;
 };
 
 static double
@@ -4731,146 +5034,1011 @@ calculate_progress (double this_heap_item, double this_heap_size,
   return process_fraction;
 }
 
-struct routeall_status
-RouteAll (routedata_t * rd)
+static void
+count_route (struct routeall_status *ras, struct routeone_status *ros)
 {
-  struct routeall_status ras;
-  struct routeone_status ros;
+  if (ros->found_route)
+    {
+      if (ros->route_had_conflicts)
+	ras->conflict_subnets++;
+      else
+	{
+	  ras->routed_subnets++;
+	  ras->total_nets_routed++;
+	}
+    }
+  else if (!ros->net_completely_routed)
+    ras->failed++;
+}
+
+/*!
+ * \brief Shows the progress and asks the user whether to go on.
+ *
+ * \return true if the user cancelled.
+ */
+static bool
+route_cancelled (int this_heap_item, int this_heap_size,
+		 struct routeall_status *ras)
+{
+  double percent = calculate_progress (this_heap_item, this_heap_size, ras);
+
+  if (!gui->progress (percent * 100., 100, _("Autorouting tracks")))
+    return false;
+  ras->total_nets_routed = 0;
+  ras->conflict_subnets = 0;
+  Message ("Autorouting cancelled\n");
+  return true;
+}
+
+/*!
+ * \brief Rips up the unfixed traces of a net if any of its boxes is bad.
+ *
+ * Traces which are kept move to the other via space.
+ *
+ * \return true if the net was ripped up and must be routed again.
+ */
+static bool
+RipNet (routedata_t * rd, routebox_t * net, struct routeall_status *ras)
+{
+  routebox_t *p;
   bool rip;
-  int request_cancel;
-#ifdef NET_HEAP
-  heap_t *net_heap;
+
+  /* rip up all unfixed traces in this net ? */
+  if (AutoRouteParameters.rip_always)
+    rip = true;
+  else
+    {
+      rip = false;
+      LIST_LOOP (net, same_net, p);
+      if (p->flags.is_bad)
+	{
+	  rip = true;
+	  break;
+	}
+      END_LOOP;
+    }
+
+  LIST_LOOP (net, same_net, p);
+  p->flags.is_bad = 0;
+  if (!p->flags.fixed)
+    {
+#ifndef NDEBUG
+      bool del;
 #endif
-  heap_t *this_pass, *next_pass, *tmp;
-  routebox_t *net, *p, *pp;
-  cost_t total_net_cost, last_cost = 0, this_cost = 0;
-  int i;
-  int this_heap_size;
-  int this_heap_item;
+      assert (!p->flags.homeless);
+      if (rip)
+	{
+	  RemoveFromNet (p, NET);
+	  RemoveFromNet (p, SUBNET);
+	}
+      if (AutoRouteParameters.use_vias && p->type != VIA_SHADOW
+	  && p->type != PLANE)
+	{
+	  mtspace_remove (rd->mtspace, &p->box,
+			  p->flags.is_odd ? ODD : EVEN,
+			  p->style->Keepaway);
+	  if (!rip)
+	    mtspace_add (rd->mtspace, &p->box,
+			 p->flags.is_odd ? EVEN : ODD,
+			 p->style->Keepaway);
+	}
+      if (rip)
+	{
+	  if (TEST_FLAG (LIVEROUTEFLAG, PCB))
+	    ripout_livedraw_obj (p);
+#ifndef NDEBUG
+	  del =
+#endif
+	    r_delete_entry (rd->layergrouptree[p->group], &p->box);
+#ifndef NDEBUG
+	  assert (del);
+#endif
+	  route_pool_put (&rd->boxes, p);
+	}
+      else
+	{
+	  p->flags.is_odd = AutoRouteParameters.is_odd;
+	}
+    }
+  END_LOOP;
+  if (TEST_FLAG (LIVEROUTEFLAG, PCB))
+    Draw ();
+  /* reset to original connectivity */
+  if (rip)
+    {
+      ras->ripped++;
+      ResetSubnet (net);
+    }
+  return rip;
+}
 
-  /* initialize heap for first pass; 
-   * do smallest area first; that makes
-   * the subsequent costs more representative */
-  this_pass = heap_create ();
-  next_pass = heap_create ();
+/*!
+ * \brief Routes the subnets of a net to each other.
+ *
+ * \return false if the user cancelled.
+ */
+static bool
+RouteNet (routedata_t * rd, routebox_t * net, int pass,
+	  struct routeall_status *ras, cost_t * total_net_cost,
+	  int this_heap_item, int this_heap_size)
+{
+  struct routeone_status ros;
+  routebox_t *p, *pp;
+  job_op_t *op;
 #ifdef NET_HEAP
-  net_heap = heap_create ();
+  heap_t *net_heap = heap_create ();
 #endif
-  LIST_LOOP (rd->first_net, different_net, net);
+
+  *total_net_cost = 0;
+  /* the loop here ensures that we get to all subnets even if
+   * some of them are unreachable from the first subnet. */
+  LIST_LOOP (net, same_net, p);
   {
-    double area;
-    BoxType bb = shrink_routebox (net);
-    LIST_LOOP (net, same_net, p);
-    {
-      MAKEMIN (bb.X1, p->sbox.X1);
-      MAKEMIN (bb.Y1, p->sbox.Y1);
-      MAKEMAX (bb.X2, p->sbox.X2);
-      MAKEMAX (bb.Y2, p->sbox.Y2);
-    }
-    END_LOOP;
-    area = (double) (bb.X2 - bb.X1) * (bb.Y2 - bb.Y1);
-    heap_insert (this_pass, area, net);
+#ifdef NET_HEAP
+    BoxType b = shrink_routebox (p);
+    /* using a heap allows us to start from smaller objects and
+     * end at bigger ones. also prefer to start at planes, then pads */
+    heap_insert (net_heap, (float) (b.X2 - b.X1) *
+#if defined(ROUTE_RANDOMIZED)
+		 (0.3 + rand () / (RAND_MAX + 1.0)) *
+#endif
+		 (b.Y2 - b.Y1) * (p->type == PLANE ?
+				  -1 : (p->type ==
+					PAD ? 1 : 10)), p);
   }
   END_LOOP;
-
-  ras.total_nets_routed = 0;
-  /* refinement/finishing passes */
-  for (i = 0; i <= passes + smoothes; i++)
+  ros.net_completely_routed = 0;
+  while (!heap_is_empty (net_heap))
     {
-#ifdef ROUTE_VERBOSE
-      if (i > 0 && i <= passes)
-	printf ("--------- STARTING REFINEMENT PASS %d ------------\n", i);
-      else if (i > passes)
-	printf ("--------- STARTING SMOOTHING PASS %d -------------\n",
-		i - passes);
+      p = (routebox_t *) heap_remove_smallest (net_heap);
 #endif
-      ras.total_subnets = ras.routed_subnets = ras.conflict_subnets =
-	ras.failed = ras.ripped = 0;
-      assert (heap_is_empty (next_pass));
+      if (!p->flags.fixed || p->flags.subnet_processed ||
+	  p->type == OTHER)
+	continue;
 
-      this_heap_size = heap_size (this_pass);
-      for (this_heap_item = 0; !heap_is_empty (this_pass); this_heap_item++)
+      while (!ros.net_completely_routed)
 	{
-#ifdef ROUTE_DEBUG
-	  if (aabort)
-	    break;
-#endif
-	  net = (routebox_t *) heap_remove_smallest (this_pass);
-	  InitAutoRouteParameters (i, net->style, i < passes, i > passes,
-				   i == passes + smoothes);
-	  if (i > 0)
+	  assert (no_expansion_boxes (rd));
+	  /* FIX ME: the number of edges to examine should be in autoroute parameters
+	   * i.e. the 2000 and 800 hard-coded below should be controllable by the user
+	   */
+	  ros =
+	    RouteOne (rd, p, NULL,
+		      ((AutoRouteParameters.
+			is_smoothing ? 2000 : 800) * (pass +
+						      1)) *
+		      routing_layers);
+	  *total_net_cost += ros.best_route_cost;
+	  if ((op = job_record (JOB_ROUTED)))
+	    op->ros = ros;
+	  count_route (ras, &ros);
+	  if (!ros.found_route)
 	    {
-	      /* rip up all unfixed traces in this net ? */
-	      if (AutoRouteParameters.rip_always)
-		rip = true;
-	      else
-		{
-		  rip = false;
-		  LIST_LOOP (net, same_net, p);
-		  if (p->flags.is_bad)
-		    {
-		      rip = true;
-		      break;
-		    }
-		  END_LOOP;
-		}
-
-	      LIST_LOOP (net, same_net, p);
-	      p->flags.is_bad = 0;
-	      if (!p->flags.fixed)
-		{
-#ifndef NDEBUG
-		  bool del;
+	      /* don't bother trying any other source in this subnet */
+	      LIST_LOOP (p, same_subnet, pp);
+	      pp->flags.subnet_processed = 1;
+	      END_LOOP;
+	      break;
+	    }
+	  /* note that we can infer nothing about ras.total_subnets based
+	   * on the number of calls to RouteOne, because we may be unable
+	   * to route a net from a particular starting point, but perfectly
+	   * able to route it from some other. */
+	  if (job.ops)
+	    continue;		/* a child leaves the GUI alone */
+	  if (route_cancelled (this_heap_item, this_heap_size, ras))
+	    {
+#ifdef NET_HEAP
+	      heap_destroy (&net_heap);
 #endif
-		  assert (!p->flags.homeless);
-		  if (rip)
-		    {
-		      RemoveFromNet (p, NET);
-		      RemoveFromNet (p, SUBNET);
-		    }
-		  if (AutoRouteParameters.use_vias && p->type != VIA_SHADOW
-		      && p->type != PLANE)
-		    {
-		      mtspace_remove (rd->mtspace, &p->box,
-				      p->flags.is_odd ? ODD : EVEN,
-				      p->style->Keepaway);
-		      if (!rip)
-			mtspace_add (rd->mtspace, &p->box,
-				     p->flags.is_odd ? EVEN : ODD,
-				     p->style->Keepaway);
-		    }
-		  if (rip)
-		    {
-		      if (TEST_FLAG (LIVEROUTEFLAG, PCB))
-			ripout_livedraw_obj (p);
-#ifndef NDEBUG
-		      del =
+	      return false;
+	    }
+	}
+    }
+#ifndef NET_HEAP
+  END_LOOP;
 #endif
-			r_delete_entry (rd->layergrouptree[p->group],
-					&p->box);
-#ifndef NDEBUG
-		      assert (del);
+  if (!ros.net_completely_routed)
+    {
+      net->flags.is_bad = 1;	/* don't skip this the next round */
+      if ((op = job_record (JOB_BAD)))
+	op->a = job_box (net);
+    }
+
+  /* reset subnet_processed flags */
+  LIST_LOOP (net, same_net, p);
+  {
+    p->flags.subnet_processed = 0;
+  }
+  END_LOOP;
+#ifdef NET_HEAP
+  heap_destroy (&net_heap);
 #endif
-		    }
-		  else
-		    {
-		      p->flags.is_odd = AutoRouteParameters.is_odd;
-		    }
-		}
-	      END_LOOP;
-	      if (TEST_FLAG (LIVEROUTEFLAG, PCB))
-		Draw ();
-	      /* reset to original connectivity */
-	      if (rip)
-		{
-		  ras.ripped++;
-		  ResetSubnet (net);
-		}
-	      else
-		{
-		  heap_insert (next_pass, 0, net);
-		  continue;
-		}
+  return true;
+}
+
+#ifdef PARALLEL_ROUTE
+/* The routes of a net in a batch must stay this many times the bloat
+ * of its style around the net, see net_region(). */
+#define BATCH_MARGIN 10
+
+/* a net of a batch, see RouteBatch() */
+struct batch_net
+{
+  routebox_t *net;
+  BoxType region;
+  int heap_item;
+  pid_t pid;
+  int fd;
+};
+
+/*!
+ * \brief The part of the board a net of a batch may be routed in.
+ *
+ * This is the bounding box of the net, grown by BATCH_MARGIN times the
+ * bloat of the current style.
+ */
+static BoxType
+net_region (routebox_t * net)
+{
+  BoxType region = net->box;
+  routebox_t *p;
+
+  LIST_LOOP (net, same_net, p);
+  {
+    MAKEMIN (region.X1, p->box.X1);
+    MAKEMIN (region.Y1, p->box.Y1);
+    MAKEMAX (region.X2, p->box.X2);
+    MAKEMAX (region.Y2, p->box.Y2);
+  }
+  END_LOOP;
+  return bloat_box (&region, BATCH_MARGIN * AutoRouteParameters.bloat);
+}
+
+/*!
+ * \brief Whether the region of a net touches one of the batch.
+ */
+static bool
+batch_overlaps (struct batch_net *batch, int n, const BoxType * region)
+{
+  int k;
+
+  for (k = 0; k < n; k++)
+    if (box_intersect (&batch[k].region, region))
+      return true;
+  return false;
+}
+
+/*!
+ * \brief Routes a net of a batch in a child and sends the record of
+ * its routes down fd.
+ */
+static void
+route_child (routedata_t * rd, struct batch_net *b, int pass, int fd)
+{
+  struct routeall_status ras;
+  job_op_t *op;
+  cost_t cost;
+  char *buf;
+  size_t left;
+  ssize_t n;
+
+  /* the child must not change the board nor draw on it */
+  CLEAR_FLAG (LIVEROUTEFLAG, PCB);
+#ifdef ROUTE_DEBUG
+  ddraw = NULL;
+#endif
+  memset (&ras, 0, sizeof (ras));
+  memset (&route_work, 0, sizeof (route_work));
+  job.max_ops = 256;
+  job.n_ops = 0;
+  job.ops = (job_op_t *) malloc (job.max_ops * sizeof (job_op_t));
+  job.made = vector_create ();
+  job.region = b->region;
+  job.outside = false;
+  InitAutoRouteParameters (pass, b->net->style, pass < passes,
+			   pass > passes, pass == passes + smoothes);
+  RouteNet (rd, b->net, pass, &ras, &cost, b->heap_item, 0);
+  op = job_record (JOB_DONE);
+  op->cost = cost;
+  op->is_bad = job.outside;
+  op->edges = route_work.edges;
+  op->mtspace_queries = route_work.mtspace_queries;
+
+  buf = (char *) job.ops;
+  left = job.n_ops * sizeof (job_op_t);
+  while (left > 0)
+    {
+      n = write (fd, buf, left);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	_exit (1);
+      buf += n;
+      left -= n;
+    }
+  _exit (0);
+}
+
+/*!
+ * \brief Reads the record a child sends.
+ */
+static job_op_t *
+read_record (int fd, int *n_ops)
+{
+  size_t size = 0, max = 64 * sizeof (job_op_t);
+  char *buf = (char *) malloc (max);
+  ssize_t n;
+
+  for (;;)
+    {
+      if (size == max)
+	{
+	  max *= 2;
+	  buf = (char *) realloc (buf, max);
+	}
+      n = read (fd, buf + size, max - size);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	break;
+      size += n;
+    }
+  *n_ops = size / sizeof (job_op_t);
+  return (job_op_t *) buf;
+}
+
+/*!
+ * \brief Repeats the routes a child made for a net.
+ *
+ * \return The cost of the routes.
+ */
+static cost_t
+replay_record (routedata_t * rd, job_op_t * ops, int n_ops,
+	       struct routeall_status *ras)
+{
+  cost_t cost = 0;
+  job_op_t *op;
+
+  for (op = ops; op < ops + n_ops; op++)
+    switch (op->type)
+      {
+      case JOB_LINE:
+	RD_DrawLine (rd, op->X1, op->Y1, op->X2, op->Y2, op->thick,
+		     op->group, job_unbox (op->a), op->is_bad, op->is_45);
+	break;
+      case JOB_VIA:
+	RD_DrawVia (rd, op->X1, op->Y1, op->thick, job_unbox (op->a),
+		    op->is_bad);
+	break;
+      case JOB_THERMAL:
+	RD_DrawThermal (rd, op->X1, op->Y1, op->group, op->layer,
+			job_unbox (op->a), op->is_bad);
+	break;
+      case JOB_MERGE:
+	MergeNets (job_unbox (op->a), job_unbox (op->b), SUBNET);
+	break;
+      case JOB_BAD:
+	job_unbox (op->a)->flags.is_bad = 1;
+	break;
+      case JOB_ROUTED:
+	count_route (ras, &op->ros);
+	break;
+      case JOB_DONE:
+	cost = op->cost;
+	route_work.edges += op->edges;
+	route_work.mtspace_queries += op->mtspace_queries;
+	break;
+      }
+  if (TEST_FLAG (LIVEROUTEFLAG, PCB))
+    Draw ();
+  return cost;
+}
+
+/*!
+ * \brief Routes a batch of nets at once, in child processes.
+ *
+ * The nets of a batch are ripped up already, and their regions don't
+ * overlap, see net_region().  Each child gets a copy-on-write image of
+ * the route data, routes its net and sends back a record of what it
+ * did.  The records are repeated in heap order, so the result doesn't
+ * depend on which child finishes first.
+ *
+ * A net is routed again here if its child failed, or if its routes or
+ * conflicts left its region, since they may then collide with those of
+ * another net of the batch.  The records of the nets after it whose
+ * region touches the new routes are dropped as well.
+ *
+ * \return false if the user cancelled.
+ */
+static bool
+RouteBatch (routedata_t * rd, struct batch_net *batch, int n, int pass,
+	    struct routeall_status *ras, heap_t * next_pass,
+	    cost_t * this_cost, int this_heap_size)
+{
+  BoxType *dirty = (BoxType *) malloc (n * sizeof (BoxType));
+  int n_dirty = 0;
+  bool cancelled = false;
+  int k, j;
+
+  for (k = 0; k < n; k++)
+    {
+      int fds[2];
+
+      batch[k].pid = -1;
+      /* a single net is routed right here */
+      if (n == 1 || pipe (fds) != 0)
+	continue;
+      batch[k].pid = fork ();
+      if (batch[k].pid == 0)
+	{
+	  close (fds[0]);
+	  route_child (rd, &batch[k], pass, fds[1]);
+	}
+      close (fds[1]);
+      if (batch[k].pid < 0)
+	close (fds[0]);
+      else
+	batch[k].fd = fds[0];
+    }
+
+  for (k = 0; k < n; k++)
+    {
+      struct batch_net *b = &batch[k];
+      job_op_t *ops = NULL;
+      int n_ops = 0, status;
+      bool replay = false;
+      cost_t cost;
+
+      if (b->pid > 0)
+	{
+	  ops = read_record (b->fd, &n_ops);
+	  close (b->fd);
+	  replay = waitpid (b->pid, &status, 0) == b->pid
+	    && WIFEXITED (status) && WEXITSTATUS (status) == 0
+	    && n_ops > 0 && ops[n_ops - 1].type == JOB_DONE
+	    && !ops[n_ops - 1].is_bad;
+	  for (j = 0; replay && j < n_dirty; j++)
+	    if (box_intersect (&b->region, &dirty[j]))
+	      replay = false;
+	}
+      InitAutoRouteParameters (pass, b->net->style, pass < passes,
+			       pass > passes, pass == passes + smoothes);
+      job.made = vector_create ();
+      job.region = b->region;
+      if (replay)
+	cost = replay_record (rd, ops, n_ops, ras);
+      else if (!RouteNet (rd, b->net, pass, ras, &cost, b->heap_item,
+			  this_heap_size))
+	cancelled = true;
+      else if (!vector_is_empty (job.made))
+	{
+	  BoxType *d = &dirty[n_dirty++];
+
+	  *d = ((routebox_t *) vector_element (job.made, 0))->box;
+	  for (j = 1; j < vector_size (job.made); j++)
+	    {
+	      routebox_t *rb = (routebox_t *) vector_element (job.made, j);
+
+	      MAKEMIN (d->X1, rb->box.X1);
+	      MAKEMIN (d->Y1, rb->box.Y1);
+	      MAKEMAX (d->X2, rb->box.X2);
+	      MAKEMAX (d->Y2, rb->box.Y2);
+	    }
+	}
+      vector_destroy (&job.made);
+      free (ops);
+      if (cancelled
+	  || (cancelled = route_cancelled (b->heap_item, this_heap_size, ras)))
+	break;
+
+      /* Route easiest nets from this pass first on next pass. */
+      heap_insert (next_pass, cost, b->net);
+      if (cost < EXPENSIVE)
+	*this_cost += cost;
+    }
+
+  /* the user doesn't want the other nets any more */
+  for (k++; k < n; k++)
+    if (batch[k].pid > 0)
+      {
+	kill (batch[k].pid, SIGKILL);
+	close (batch[k].fd);
+	waitpid (batch[k].pid, NULL, 0);
+      }
+  free (dirty);
+  return !cancelled;
+}
+#endif
+
+/* ---------------------------------------------------------------------------
+ * statistics and checkpoints of the passes, see RouteAll()
+ */
+
+#define CHECKPOINT_MAGIC "# PCB autoroute checkpoint"
+#define CHECKPOINT_VERSION 1
+
+/*!
+ * \brief Logs the statistics of a finished pass, and appends them to
+ * the autoroute-stats file as one JSON object per line.
+ */
+static void
+report_pass (FILE * stats, int pass, struct routeall_status *ras,
+	     cost_t cost, gint64 start)
+{
+  const char *kind = pass == 0 ? "route" : pass <= passes ? "refine" : "smooth";
+  double ms = (g_get_monotonic_time () - start) / 1000.0;
+
+  Message (_("Autoroute pass %d (%s): %d of %d subnets routed, "
+	     "%d with conflicts, %d failed, %d ripped, cost %.0f, %.1f s\n"),
+	   pass, kind, ras->routed_subnets, ras->total_subnets,
+	   ras->conflict_subnets, ras->failed, ras->ripped, cost, ms / 1000);
+  if (stats == NULL)
+    return;
+  fprintf (stats, "{\"pass\": %d, \"kind\": \"%s\", \"nets\": %d, "
+	   "\"subnets\": %d, \"routed\": %d, \"conflicts\": %d, "
+	   "\"failed\": %d, \"ripped\": %d, \"cost\": %.0f, \"ms\": %.1f, "
+	   "\"edges\": %ld, \"mtspace_queries\": %ld}\n",
+	   pass, kind, ras->nets, ras->total_subnets, ras->routed_subnets,
+	   ras->conflict_subnets, ras->failed, ras->ripped, cost, ms,
+	   route_work.edges, route_work.mtspace_queries);
+  fflush (stats);
+}
+
+struct net_rank
+{
+  routebox_t *net;
+  int rank;
+};
+
+static int
+net_rank_cmp (const void *a, const void *b)
+{
+  const struct net_rank *x = (const struct net_rank *) a;
+  const struct net_rank *y = (const struct net_rank *) b;
+
+  return x->net < y->net ? -1 : x->net > y->net;
+}
+
+static int
+count_fixed (routebox_t * net)
+{
+  routebox_t *p;
+  int n = 0;
+
+  LIST_LOOP (net, same_net, p);
+  if (p->flags.fixed)
+    n++;
+  END_LOOP;
+  return n;
+}
+
+/*!
+ * \brief Saves one box of a subnet.
+ *
+ * The style is saved as its index in rd->styles, where the last one is
+ * the default style.
+ *
+ * \return false if the box has a style that isn't in rd->styles, which
+ * couldn't be read back.
+ */
+static bool
+write_box (FILE * f, routedata_t * rd, routebox_t * rb)
+{
+  int style;
+
+  if (rb->flags.fixed)
+    fprintf (f, "fixed %d", rb->group);
+  else if (rb->type == LINE || rb->type == VIA || rb->type == THERMAL)
+    {
+      for (style = 0; style <= NUM_STYLES; style++)
+	if (rd->styles[style] == rb->style)
+	  break;
+      if (style > NUM_STYLES)
+	return false;
+      fprintf (f, "%s %d %d %d %d %d %d %d %d",
+	       rb->type == LINE ? "line" : rb->type == VIA ? "via" : "thermal",
+	       rb->group, rb->layer, style, rb->pass, rb->flags.is_bad,
+	       rb->flags.is_odd, rb->flags.nonstraight, rb->flags.bl_to_ur);
+    }
+  else
+    return true;		/* via shadows are made again with their via */
+  fprintf (f, " %lld %lld %lld %lld\n",
+	   (long long) rb->sbox.X1, (long long) rb->sbox.Y1,
+	   (long long) rb->sbox.X2, (long long) rb->sbox.Y2);
+  return true;
+}
+
+/*!
+ * \brief Saves the routes of all nets and the order of the next pass.
+ *
+ * The nets are numbered in the order of rd->first_net, which is the
+ * same for the same layout and selection.  Fixed boxes are saved by
+ * their position, so a resumed route can tell the subnets apart; the
+ * routes are made again from their boxes.  The file is replaced only
+ * once it has been written completely, and not at all if a route has a
+ * style the checkpoint can't name.
+ */
+static void
+write_checkpoint (routedata_t * rd, const char *filename, bool selected,
+		  int pass, cost_t last_cost, int total_nets_routed,
+		  heap_t * order)
+{
+  struct net_rank *ranks, key, *found;
+  routebox_t *net, *p, *q;
+  char *tmp;
+  FILE *f;
+  bool good = true;
+  int n, i;
+
+  n = heap_size (order);
+  ranks = (struct net_rank *) malloc (MAX (n, 1) * sizeof (struct net_rank));
+  for (i = 0; i < n; i++)
+    {
+      ranks[i].net = (routebox_t *) heap_remove_smallest (order);
+      ranks[i].rank = i;
+    }
+  /* the ranks keep the order the heap had */
+  for (i = 0; i < n; i++)
+    heap_insert (order, i, ranks[i].net);
+  qsort (ranks, n, sizeof (struct net_rank), net_rank_cmp);
+
+  tmp = (char *) malloc (strlen (filename) + 5);
+  sprintf (tmp, "%s.tmp", filename);
+  f = fopen (tmp, "w");
+  if (f == NULL)
+    {
+      Message (_("Can't write the autoroute checkpoint %s: %s\n"), tmp,
+	       strerror (errno));
+      free (tmp);
+      free (ranks);
+      return;
+    }
+  fprintf (f, "%s\nversion %d\nselected %d\npass %d\ncost %.17g\n"
+	   "routed %d\nnets %d\n", CHECKPOINT_MAGIC, CHECKPOINT_VERSION,
+	   selected, pass, last_cost, total_nets_routed, n);
+  LIST_LOOP (rd->first_net, different_net, net);
+  {
+    key.net = net;
+    found = (struct net_rank *) bsearch (&key, ranks, n,
+					 sizeof (struct net_rank),
+					 net_rank_cmp);
+    fprintf (f, "net %d %d\n", found ? found->rank : -1, count_fixed (net));
+    FOREACH_SUBNET (net, p);
+    {
+      fprintf (f, "subnet\n");
+      /* the fixed boxes first, to anchor the routes */
+      LIST_LOOP (p, same_subnet, q);
+      if (q->flags.fixed)
+	good = write_box (f, rd, q) && good;
+      END_LOOP;
+      LIST_LOOP (p, same_subnet, q);
+      if (!q->flags.fixed)
+	good = write_box (f, rd, q) && good;
+      END_LOOP;
+    }
+    END_FOREACH (net, p);
+    fprintf (f, "end\n");
+  }
+  END_LOOP;
+  free (ranks);
+
+  if (!good)
+    {
+      Message (_("Can't write the autoroute checkpoint %s: a route has "
+		 "an unknown route style\n"), filename);
+      fclose (f);
+      remove (tmp);
+    }
+  else if (fclose (f) != 0 || rename (tmp, filename) != 0)
+    {
+      Message (_("Can't write the autoroute checkpoint %s: %s\n"), filename,
+	       strerror (errno));
+      remove (tmp);
+    }
+  free (tmp);
+}
+
+static void
+mark_subnet (routebox_t * rb, bool touched)
+{
+  routebox_t *p;
+
+  LIST_LOOP (rb, same_subnet, p);
+  p->flags.touched = touched;
+  END_LOOP;
+}
+
+/*!
+ * \brief Makes a route box of a checkpoint again, like the RD_Draw*()
+ * functions do.
+ */
+static void
+restore_box (routedata_t * rd, etype type, Cardinal group, Cardinal layer,
+	     RouteStyleType * style, int pass, int flags[4],
+	     const BoxType * b, routebox_t * subnet)
+{
+  routebox_t *rb, *first_via = NULL;
+  int i;
+
+  for (i = 0; i < max_group; i++)
+    {
+      /* a via cuts through every layer group */
+      if (type == VIA ? !is_layer_group_active[i] : i != group)
+	continue;
+      rb = (routebox_t *) route_pool_get0 (&rd->boxes);
+      init_const_box (rb, b->X1, b->Y1, b->X2, b->Y2,
+		      type == THERMAL ? 0 : style->Keepaway);
+      rb->group = i;
+      rb->layer = layer;
+      rb->type = type;
+      rb->style = style;
+      rb->pass = pass;
+      rb->flags.is_bad = flags[0];
+      rb->flags.is_odd = flags[1];
+      rb->flags.nonstraight = flags[2];
+      rb->flags.bl_to_ur = flags[3];
+      if (type != THERMAL)
+	rb->came_from = ALL;
+      if (type == VIA)
+	{
+	  rb->flags.circular = 1;
+	  if (first_via == NULL)
+	    first_via = rb;
+	  else
+	    {
+	      rb->type = VIA_SHADOW;
+	      rb->parent.via_shadow = first_via;
+	    }
+	}
+      InitLists (rb);
+      MergeNets (rb, subnet, NET);
+      MergeNets (rb, subnet, SUBNET);
+      assert (__routebox_is_good (rb));
+      r_insert_entry (rd->layergrouptree[i], &rb->box, 0);
+      if (type == LINE)
+	usedGroup[i] = true;
+      if (AutoRouteParameters.use_vias && rb->type != VIA_SHADOW
+	  && type != THERMAL)
+	mtspace_add (rd->mtspace, &rb->box, rb->flags.is_odd ? ODD : EVEN,
+		     rb->style->Keepaway);
+    }
+}
+
+static routebox_t *
+find_fixed (routebox_t * net, Cardinal group, const BoxType * b)
+{
+  routebox_t *p;
+
+  LIST_LOOP (net, same_net, p);
+  if (p->flags.fixed && p->group == group
+      && p->sbox.X1 == b->X1 && p->sbox.Y1 == b->Y1
+      && p->sbox.X2 == b->X2 && p->sbox.Y2 == b->Y2)
+    return p;
+  END_LOOP;
+  return NULL;
+}
+
+/*!
+ * \brief Reads the subnets and routes of one net of a checkpoint.
+ */
+static bool
+read_net (routedata_t * rd, FILE * f, routebox_t * net, heap_t * order)
+{
+  routebox_t *anchor = NULL, *p;
+  char word[16];
+  long long c[4];
+  int rank, n, group, layer, style, pass, flags[4];
+  BoxType b;
+  bool good = true;
+
+  if (fscanf (f, " net %d %d", &rank, &n) != 2 || rank < 0
+      || n != count_fixed (net))
+    return false;
+  heap_insert (order, rank, net);
+  while (good && fscanf (f, " %15s", word) == 1)
+    {
+      if (strcmp (word, "end") == 0)
+	break;
+      if (strcmp (word, "subnet") == 0)
+	{
+	  if (anchor)
+	    mark_subnet (anchor, false);
+	  anchor = NULL;
+	  continue;
+	}
+      if (strcmp (word, "fixed") == 0)
+	{
+	  if (fscanf (f, "%d %lld %lld %lld %lld", &group,
+		      &c[0], &c[1], &c[2], &c[3]) != 5)
+	    return false;
+	  b.X1 = c[0];
+	  b.Y1 = c[1];
+	  b.X2 = c[2];
+	  b.Y2 = c[3];
+	  p = find_fixed (net, group, &b);
+	  if (p == NULL)
+	    good = false;
+	  else if (anchor == NULL)
+	    {
+	      anchor = p;
+	      mark_subnet (anchor, true);
+	    }
+	  else if (!p->flags.touched)
+	    {
+	      /* joined to the anchor by a route */
+	      mark_subnet (p, true);
+	      MergeNets (anchor, p, SUBNET);
+	    }
+	  continue;
+	}
+      if (fscanf (f, "%d %d %d %d %d %d %d %d %lld %lld %lld %lld",
+		  &group, &layer, &style, &pass, &flags[0], &flags[1],
+		  &flags[2], &flags[3], &c[0], &c[1], &c[2], &c[3]) != 12
+	  || anchor == NULL || group < 0 || group >= max_group
+	  || style < 0 || style > NUM_STYLES
+	  || c[0] > c[2] || c[1] > c[3])
+	good = false;
+      else
+	{
+	  b.X1 = c[0];
+	  b.Y1 = c[1];
+	  b.X2 = c[2];
+	  b.Y2 = c[3];
+	  if (strcmp (word, "line") == 0)
+	    restore_box (rd, LINE, group, layer, rd->styles[style], pass,
+			 flags, &b, anchor);
+	  else if (strcmp (word, "via") == 0)
+	    restore_box (rd, VIA, group, layer, rd->styles[style], pass,
+			 flags, &b, anchor);
+	  else if (strcmp (word, "thermal") == 0)
+	    restore_box (rd, THERMAL, group, layer, rd->styles[style], pass,
+			 flags, &b, anchor);
+	  else
+	    good = false;
+	}
+    }
+  if (anchor)
+    mark_subnet (anchor, false);
+  return good;
+}
+
+/*!
+ * \brief Puts the routes of a checkpoint back, after its header.
+ *
+ * \return false if the checkpoint doesn't match the layout.
+ */
+static bool
+read_checkpoint (routedata_t * rd, FILE * f, int *pass, cost_t * last_cost,
+		 heap_t * order, struct routeall_status *ras)
+{
+  routebox_t *net;
+  int n = 0, nets;
+  bool good = true;
+
+  if (fscanf (f, " pass %d cost %lf routed %d nets %d", pass, last_cost,
+	      &ras->total_nets_routed, &nets) != 4
+      || *pass < 1 || *pass > passes + smoothes)
+    return false;
+  LIST_LOOP (rd->first_net, different_net, net);
+  n++;
+  END_LOOP;
+  if (n != nets)
+    return false;
+  LIST_LOOP (rd->first_net, different_net, net);
+  {
+    if (!read_net (rd, f, net, order))
+      {
+	good = false;
+	break;
+      }
+  }
+  END_LOOP;
+  return good;
+}
+
+/*!
+ * \brief Routes all nets over a number of passes.
+ *
+ * With the autoroute-jobs setting above one, nets far enough apart are
+ * routed in batches, see RouteBatch().  The statistics of each pass
+ * are logged, and the state after it is saved to the autoroute-
+ * checkpoint file if there is one.  With resume, the passes go on
+ * from such a checkpoint, whose header has been read already.
+ */
+struct routeall_status
+RouteAll (routedata_t * rd, bool selected, FILE * resume)
+{
+  struct routeall_status ras;
+  heap_t *this_pass, *next_pass, *tmp;
+  routebox_t *net, *p;
+  cost_t total_net_cost, last_cost = 0, this_cost = 0;
+  FILE *stats = NULL;
+  gint64 start;
+  int i, first = 0;
+  int this_heap_size;
+  int this_heap_item;
+#ifdef PARALLEL_ROUTE
+  struct batch_net *batch = NULL;
+  int batch_size = 0;
+
+  if (Settings.AutorouteJobs > 1)
+    batch = (struct batch_net *) malloc (Settings.AutorouteJobs
+					 * sizeof (struct batch_net));
+#endif
+
+  memset (&ras, 0, sizeof (ras));
+  this_pass = heap_create ();
+  next_pass = heap_create ();
+  if (resume)
+    {
+      if (!read_checkpoint (rd, resume, &first, &last_cost, this_pass, &ras))
+	{
+	  Message (_("The autoroute checkpoint doesn't match the layout.\n"));
+	  ras.total_nets_routed = 0;
+	  goto out;
+	}
+    }
+  else
+    {
+      /* initialize heap for first pass; 
+       * do smallest area first; that makes
+       * the subsequent costs more representative */
+      LIST_LOOP (rd->first_net, different_net, net);
+      {
+	double area;
+	BoxType bb = shrink_routebox (net);
+	LIST_LOOP (net, same_net, p);
+	{
+	  MAKEMIN (bb.X1, p->sbox.X1);
+	  MAKEMIN (bb.Y1, p->sbox.Y1);
+	  MAKEMAX (bb.X2, p->sbox.X2);
+	  MAKEMAX (bb.Y2, p->sbox.Y2);
+	}
+	END_LOOP;
+	area = (double) (bb.X2 - bb.X1) * (bb.Y2 - bb.Y1);
+	heap_insert (this_pass, area, net);
+      }
+      END_LOOP;
+    }
+
+  if (Settings.AutorouteStats && *Settings.AutorouteStats)
+    {
+      stats = fopen (Settings.AutorouteStats, "a");
+      if (stats == NULL)
+	Message (_("Can't open %s: %s\n"), Settings.AutorouteStats,
+		 strerror (errno));
+    }
+  /* refinement/finishing passes */
+  for (i = first; i <= passes + smoothes; i++)
+    {
+      start = g_get_monotonic_time ();
+      memset (&route_work, 0, sizeof (route_work));
+#ifdef ROUTE_VERBOSE
+      if (i > 0 && i <= passes)
+	printf ("--------- STARTING REFINEMENT PASS %d ------------\n", i);
+      else if (i > passes)
+	printf ("--------- STARTING SMOOTHING PASS %d -------------\n",
+		i - passes);
+#endif
+      ras.total_subnets = ras.routed_subnets = ras.conflict_subnets =
+	ras.failed = ras.ripped = ras.nets = 0;
+      assert (heap_is_empty (next_pass));
+
+      this_heap_size = heap_size (this_pass);
+      for (this_heap_item = 0; !heap_is_empty (this_pass); this_heap_item++)
+	{
+#ifdef ROUTE_DEBUG
+	  if (aabort)
+	    break;
+#endif
+	  net = (routebox_t *) heap_remove_smallest (this_pass);
+	  InitAutoRouteParameters (i, net->style, i < passes, i > passes,
+				   i == passes + smoothes);
+	  if (i > 0 && !RipNet (rd, net, &ras))
+	    {
+	      heap_insert (next_pass, 0, net);
+	      continue;
 	    }
 	  /* count number of subnets */
 	  FOREACH_SUBNET (net, p);
@@ -4879,7 +6047,6 @@ RouteAll (routedata_t * rd)
 	  /* the first subnet doesn't require routing. */
 	  ras.total_subnets--;
 	  /* and re-route! */
-	  total_net_cost = 0;
 	  /* only route that which isn't fully routed */
 #ifdef ROUTE_DEBUG
 	  if (ras.total_subnets == 0 || aabort)
@@ -4890,89 +6057,31 @@ RouteAll (routedata_t * rd)
 	      heap_insert (next_pass, 0, net);
 	      continue;
 	    }
+	  ras.nets++;
 
-	  /* the loop here ensures that we get to all subnets even if
-	   * some of them are unreachable from the first subnet. */
-	  LIST_LOOP (net, same_net, p);
-	  {
-#ifdef NET_HEAP
-	    BoxType b = shrink_routebox (p);
-	    /* using a heap allows us to start from smaller objects and
-	     * end at bigger ones. also prefer to start at planes, then pads */
-	    heap_insert (net_heap, (float) (b.X2 - b.X1) *
-#if defined(ROUTE_RANDOMIZED)
-			 (0.3 + rand () / (RAND_MAX + 1.0)) *
-#endif
-			 (b.Y2 - b.Y1) * (p->type == PLANE ?
-					  -1 : (p->type ==
-						PAD ? 1 : 10)), p);
-	  }
-	  END_LOOP;
-	  ros.net_completely_routed = 0;
-	  while (!heap_is_empty (net_heap))
+#ifdef PARALLEL_ROUTE
+	  if (batch)
 	    {
-	      p = (routebox_t *) heap_remove_smallest (net_heap);
-#endif
-	      if (!p->flags.fixed || p->flags.subnet_processed ||
-		  p->type == OTHER)
-		continue;
+	      BoxType region = net_region (net);
 
-	      while (!ros.net_completely_routed)
+	      if (batch_size == Settings.AutorouteJobs
+		  || batch_overlaps (batch, batch_size, &region))
 		{
-		  double percent;
-
-		  assert (no_expansion_boxes (rd));
-		  /* FIX ME: the number of edges to examine should be in autoroute parameters
-		   * i.e. the 2000 and 800 hard-coded below should be controllable by the user
-		   */
-		  ros =
-		    RouteOne (rd, p, NULL,
-			      ((AutoRouteParameters.
-				is_smoothing ? 2000 : 800) * (i +
-							      1)) *
-			      routing_layers);
-		  total_net_cost += ros.best_route_cost;
-		  if (ros.found_route)
-		    {
-		      if (ros.route_had_conflicts)
-			ras.conflict_subnets++;
-		      else
-			{
-			  ras.routed_subnets++;
-			  ras.total_nets_routed++;
-			}
-		    }
-		  else
-		    {
-		      if (!ros.net_completely_routed)
-			ras.failed++;
-		      /* don't bother trying any other source in this subnet */
-		      LIST_LOOP (p, same_subnet, pp);
-		      pp->flags.subnet_processed = 1;
-		      END_LOOP;
-		      break;
-		    }
-		  /* note that we can infer nothing about ras.total_subnets based
-		   * on the number of calls to RouteOne, because we may be unable
-		   * to route a net from a particular starting point, but perfectly
-		   * able to route it from some other. */
-		  percent = calculate_progress (this_heap_item, this_heap_size, &ras);
-		  request_cancel = gui->progress (percent * 100., 100,
-						  _("Autorouting tracks"));
-		  if (request_cancel)
-		    {
-		      ras.total_nets_routed = 0;
-		      ras.conflict_subnets = 0;
-		      Message ("Autorouting cancelled\n");
-		      goto out;
-		    }
+		  if (!RouteBatch (rd, batch, batch_size, i, &ras, next_pass,
+				   &this_cost, this_heap_size))
+		    goto out;
+		  batch_size = 0;
 		}
+	      batch[batch_size].net = net;
+	      batch[batch_size].region = region;
+	      batch[batch_size].heap_item = this_heap_item;
+	      batch_size++;
+	      continue;
 	    }
-#ifndef NET_HEAP
-	  END_LOOP;
 #endif
-	  if (!ros.net_completely_routed)
-	    net->flags.is_bad = 1;	/* don't skip this the next round */
+	  if (!RouteNet (rd, net, i, &ras, &total_net_cost, this_heap_item,
+			 this_heap_size))
+	    goto out;
 
 	  /* Route easiest nets from this pass first on next pass.
 	   * This works best because it's likely that the hardest
@@ -4983,13 +6092,14 @@ RouteAll (routedata_t * rd)
 	  heap_insert (next_pass, total_net_cost, net);
 	  if (total_net_cost < EXPENSIVE)
 	    this_cost += total_net_cost;
-	  /* reset subnet_processed flags */
-	  LIST_LOOP (net, same_net, p);
-	  {
-	    p->flags.subnet_processed = 0;
-	  }
-	  END_LOOP;
 	}
+#ifdef PARALLEL_ROUTE
+      if (batch_size > 0
+	  && !RouteBatch (rd, batch, batch_size, i, &ras, next_pass,
+			  &this_cost, this_heap_size))
+	goto out;
+      batch_size = 0;
+#endif
       /* swap this_pass and next_pass and do it all over again! */
       ro = 0;
       assert (heap_is_empty (this_pass));
@@ -5002,6 +6112,7 @@ RouteAll (routedata_t * rd)
 	 i, ras.routed_subnets, ras.total_subnets, this_cost,
 	 ras.conflict_subnets, ras.failed, ras.ripped);
 #endif
+      report_pass (stats, i, &ras, this_cost, start);
 #ifdef ROUTE_DEBUG
       if (aabort)
 	break;
@@ -5015,16 +6126,22 @@ RouteAll (routedata_t * rd)
 	i = passes + smoothes - 1;
       last_cost = this_cost;
       this_cost = 0;
+      if (i < passes + smoothes && Settings.AutorouteCheckpoint
+	  && *Settings.AutorouteCheckpoint)
+	write_checkpoint (rd, Settings.AutorouteCheckpoint, selected, i + 1,
+			  last_cost, ras.total_nets_routed, this_pass);
     }
 
   Message ("%d of %d nets successfully routed.\n",
 	   ras.routed_subnets, ras.total_subnets);
 
 out:
+  if (stats)
+    fclose (stats);
   heap_destroy (&this_pass);
   heap_destroy (&next_pass);
-#ifdef NET_HEAP
-  heap_destroy (&net_heap);
+#ifdef PARALLEL_ROUTE
+  free (batch);
 #endif
 
   /* no conflicts should be left at the end of the process. */
@@ -5225,8 +6342,12 @@ IronDownAllUnfixedPaths (routedata_t * rd)
   return changed;
 }
 
-bool
-AutoRoute (bool selected)
+/*!
+ * \brief Routes all or the selected rats, going on from a checkpoint if
+ * resume is given.
+ */
+static bool
+DoAutoRoute (bool selected, FILE * resume)
 {
   bool changed = false;
   routedata_t *rd;
@@ -5276,7 +6397,7 @@ AutoRoute (bool selected)
       if (i == 0)
 	goto donerouting;	/* nothing to do here */
       /* if only one rat selected, do things the quick way. =) */
-      if (i == 1)
+      if (i == 1 && !resume)
 	{
 	  RAT_LOOP (PCB->Data);
 	  if (!selected || TEST_FLAG (SELECTEDFLAG, line))
@@ -5391,7 +6512,8 @@ AutoRoute (bool selected)
     }
   /* okay, rd's idea of netlist now corresponds to what we want routed */
   /* auto-route all nets */
-  changed = (RouteAll (rd).total_nets_routed > 0) || changed;
+  changed = (RouteAll (rd, selected, resume).total_nets_routed > 0)
+    || changed;
 donerouting:
   gui->progress (0, 0, NULL);
   if (TEST_FLAG (LIVEROUTEFLAG, PCB))
@@ -5435,3 +6557,43 @@ donerouting:
 #endif
   return (changed);
 }
+
+bool
+AutoRoute (bool selected)
+{
+  return DoAutoRoute (selected, NULL);
+}
+
+/*!
+ * \brief Goes on with the autoroute run saved in a checkpoint.
+ */
+bool
+AutoRouteResume (const char *Filename)
+{
+  FILE *f;
+  int version, selected;
+  bool changed;
+
+  if (Filename == NULL || *Filename == '\0')
+    {
+      Message (_("No autoroute checkpoint to resume from.\n"));
+      return false;
+    }
+  f = fopen (Filename, "r");
+  if (f == NULL)
+    {
+      Message (_("Can't open the autoroute checkpoint %s: %s\n"), Filename,
+	       strerror (errno));
+      return false;
+    }
+  if (fscanf (f, CHECKPOINT_MAGIC " version %d selected %d",
+	      &version, &selected) != 2 || version != CHECKPOINT_VERSION)
+    {
+      Message (_("%s is not an autoroute checkpoint.\n"), Filename);
+      fclose (f);
+      return false;
+    }
+  changed = DoAutoRoute (selected != 0, f);
+  fclose (f);
+  return changed;
+}
@@ -40,5 +40,6 @@
 #include "global.h"
 
 bool AutoRoute (bool);
+bool AutoRouteResume (const char *);
 
 #endif
@@ -38,6 +38,7 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <math.h>
+#include <sys/stat.h>
 
 #include "global.h"
 
@@ -47,6 +48,7 @@
 #include "crosshair.h"
 #include "data.h"
 #include "error.h"
+#include "file.h"
 #include "flags.h"
 #include "mymem.h"
 #include "mirror.h"
@@ -372,6 +374,8 @@ MoveElementToBuffer (ElementType *element)
    * restore to polygons)
    */
   r_delete_element (Source, element);
+  if (Source == PCB->Data || Dest == PCB->Data)
+    InvalidateNetlist ();
 
   Source->Element = g_list_remove (Source->Element, element);
   Source->ElementN --;
@@ -466,10 +470,144 @@ AddSelectedToBuffer (BufferType *Buffer, Coord X, Coord Y, bool LeaveSelected)
   ExtraFlag = 0;
 }
 
+/* ---------------------------------------------------------------------------
+ * cache of parsed footprints
+ */
+#define FOOTPRINT_CACHE_SIZE 256
+
+/*!
+ * \brief A parsed footprint and the file it was parsed from.
+ */
+typedef struct
+{
+  DataType *Data; /*!< The footprint as parsed. */
+  time_t mtime; /*!< Of the footprint file. */
+  off_t size;
+} FootprintCacheType;
+
+static GHashTable *footprint_cache = NULL;
+
+static void
+FreeFootprintCacheEntry (FootprintCacheType *entry)
+{
+  FreeDataMemory (entry->Data);
+  free (entry->Data);
+  free (entry);
+}
+
+/*!
+ * \brief Returns the parsed contents of a footprint file or of an m4
+ * library entry, parsing it only if it is not cached.
+ *
+ * Files are parsed again when their mtime or size changed.  Library
+ * entries are cached for the session, so placing the same m4
+ * footprint again does not run the library command.
+ *
+ * \return NULL if the footprint cannot be parsed.
+ */
+static DataType *
+GetFootprintData (char *Name, bool FromFile)
+{
+  FootprintCacheType *entry;
+  struct stat st;
+  DataType *data;
+  char *key;
+  int result;
+
+  if (FromFile && stat (Name, &st) != 0)
+    memset (&st, 0, sizeof (st));
+
+  if (footprint_cache == NULL)
+    footprint_cache =
+      g_hash_table_new_full (g_str_hash, g_str_equal, free,
+			     (GDestroyNotify) FreeFootprintCacheEntry);
+  key = Concat (FromFile ? "file:" : "m4:", Name, NULL);
+  entry = (FootprintCacheType *) g_hash_table_lookup (footprint_cache, key);
+  if (entry != NULL && (!FromFile || (entry->mtime == st.st_mtime
+				      && entry->size == st.st_size
+				      && st.st_mtime != 0)))
+    {
+      free (key);
+      return entry->Data;
+    }
+
+  data = CreateNewBuffer ();
+  if (FromFile)
+    result = ParseElementFile (data, Name);
+  else
+    result = ParseLibraryEntry (data, Name);
+  if (result != 0)
+    {
+      FreeDataMemory (data);
+      free (data);
+      free (key);
+      return NULL;
+    }
+
+  if (g_hash_table_size (footprint_cache) >= FOOTPRINT_CACHE_SIZE)
+    g_hash_table_remove_all (footprint_cache);
+  entry = (FootprintCacheType *) malloc (sizeof (*entry));
+  entry->Data = data;
+  entry->mtime = FromFile ? st.st_mtime : 0;
+  entry->size = FromFile ? st.st_size : 0;
+  g_hash_table_replace (footprint_cache, key, entry);
+  return data;
+}
+
+/*!
+ * \brief Copies everything in a parsed footprint into a buffer.
+ *
+ * Besides elements, a footprint file can hold vias, rat lines and
+ * layer objects, which are loaded along with them.
+ */
+static void
+CopyFootprintToBuffer (BufferType *Buffer, DataType *Footprint)
+{
+  Source = Footprint;
+  Dest = Buffer->Data;
+  VIA_LOOP (Footprint);
+  {
+    AddViaToBuffer (via);
+  }
+  END_LOOP;
+  ELEMENT_LOOP (Footprint);
+  {
+    CopyElementLowLevel (Dest, element, false, 0, 0, 0);
+  }
+  END_LOOP;
+  RAT_LOOP (Footprint);
+  {
+    AddRatToBuffer (line);
+  }
+  END_LOOP;
+  ALLLINE_LOOP (Footprint);
+  {
+    AddLineToBuffer (layer, line);
+  }
+  ENDALL_LOOP;
+  ALLARC_LOOP (Footprint);
+  {
+    AddArcToBuffer (layer, arc);
+  }
+  ENDALL_LOOP;
+  ALLTEXT_LOOP (Footprint);
+  {
+    AddTextToBuffer (layer, text);
+  }
+  ENDALL_LOOP;
+  ALLPOLYGON_LOOP (Footprint);
+  {
+    AddPolygonToBuffer (layer, polygon);
+  }
+  ENDALL_LOOP;
+}
+
 /*!
  * \brief Loads element data from file/library into buffer.
  *
- * Parse the file with disabled 'PCB mode' (see parser).
+ * Parse the file with disabled 'PCB mode' (see parser).  The parsed
+ * footprints are cached, so loading the same footprint again only
+ * copies it.
  *
  * \return false on error, if successful, update some other stuff and
  * reposition the pastebuffer.
@@ -478,11 +616,16 @@ bool
 LoadElementToBuffer (BufferType *Buffer, char *Name, bool FromFile)
 {
   ElementType *element;
+  DataType *footprint;
 
   ClearBuffer (Buffer);
+  footprint = GetFootprintData (Name, FromFile);
+  if (footprint != NULL)
+    CopyFootprintToBuffer (Buffer, footprint);
+
   if (FromFile)
     {
-      if (!ParseElementFile (Buffer->Data, Name))
+      if (footprint != NULL)
 	{
 	  if (Settings.ShowBottomSide)
 	    SwapBuffer (Buffer);
@@ -503,8 +646,7 @@ LoadElementToBuffer (BufferType *Buffer, char *Name, bool FromFile)
     }
   else
     {
-      if (!ParseLibraryEntry (Buffer->Data, Name)
-	  && Buffer->Data->ElementN != 0)
+      if (footprint != NULL && Buffer->Data->ElementN != 0)
 	{
 	  element = Buffer->Data->Element->data;
 
@@ -717,17 +859,26 @@ LoadFootprintByName (BufferType *Buffer, char *Footprint)
   LibraryEntryType *entry;
   char *with_fp = NULL;
 
-  if (!footprint_hash)
-    make_footprint_hash ();
-
-  fpe = search_footprint_hash (Footprint);
-  if (!fpe)
+  /* Search what is loaded so far, and only wait for the background
+     scan of newlib if that misses, so a lookup does not block on the
+     whole scan.  A name that is also in the m4 library is found there
+     until the scan is merged. */
+  do
     {
-      with_fp = Concat (Footprint, ".fp", NULL);
-      fpe = search_footprint_hash (with_fp);
-      if (fpe)
-	Footprint = with_fp;
+      if (!footprint_hash)
+	make_footprint_hash ();
+
+      fpe = search_footprint_hash (Footprint);
+      if (!fpe)
+	{
+	  free (with_fp);
+	  with_fp = Concat (Footprint, ".fp", NULL);
+	  fpe = search_footprint_hash (with_fp);
+	  if (fpe)
+	    Footprint = with_fp;
+	}
     }
+  while (!fpe && WaitForLibrary ());
   if (!fpe)
     {
       Message(_("Unable to load footprint %s\n"), Footprint);
@@ -1414,6 +1565,9 @@ UninitBuffers (void)
       ClearBuffer (Buffers+i);
       free (Buffers[i].Data);
     }
+  if (footprint_cache != NULL)
+    g_hash_table_destroy (footprint_cache);
+  footprint_cache = NULL;
 }
 
 void
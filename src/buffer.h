@@ -56,5 +56,6 @@ void *CopyObjectToBuffer (DataType *, DataType *, int,
 			  void *, void *, void *);
 
 int LoadFootprint (int argc, char **argv, Coord x, Coord y);
+void clear_footprint_hash (void);
 
 #endif
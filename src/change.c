@@ -45,6 +45,7 @@
 #include "data.h"
 #include "draw.h"
 #include "error.h"
+#include "journal.h"
 #include "mymem.h"
 #include "misc.h"
 #include "mirror.h"
@@ -978,17 +979,22 @@ static void *
 ChangePinName (ElementType *Element, PinType *Pin)
 {
   char *old = Pin->Name;
+  char *result = STRDUP (old);
 
   (void) Element;		/* get rid of 'unused...' warnings */
   if (TEST_FLAG (DISPLAYNAMEFLAG, Pin))
     {
       ErasePinName (Pin);
-      Pin->Name = NewName;
+      Pin->Name = InternString (NewName);
       DrawPinName (Pin);
     }
   else
-    Pin->Name = NewName;
-  return (old);
+    Pin->Name = InternString (NewName);
+  /* ownership of NewName passes to this function, and the pin keeps
+   * an interned copy of it; the caller owns the result */
+  free (NewName);
+  ReleaseString (old);
+  return (result);
 }
 
 /*!
@@ -998,17 +1004,22 @@ static void *
 ChangePadName (ElementType *Element, PadType *Pad)
 {
   char *old = Pad->Name;
+  char *result = STRDUP (old);
 
   (void) Element;		/* get rid of 'unused...' warnings */
   if (TEST_FLAG (DISPLAYNAMEFLAG, Pad))
     {
       ErasePadName (Pad);
-      Pad->Name = NewName;
+      Pad->Name = InternString (NewName);
       DrawPadName (Pad);
     }
   else
-    Pad->Name = NewName;
-  return (old);
+    Pad->Name = InternString (NewName);
+  /* ownership of NewName passes to this function, and the pad keeps
+   * an interned copy of it; the caller owns the result */
+  free (NewName);
+  ReleaseString (old);
+  return (result);
 }
 
 /*!
@@ -1053,6 +1064,9 @@ ChangeElementText (PCBType *pcb, DataType *data, ElementType *Element, int which
 
   r_insert_entry (data->name_tree[which],
 		  & Element->Name[which].BoundingBox, 0);
+  /* the netlist refers to the elements by this name */
+  if (data == PCB->Data && which == NAMEONPCB_INDEX)
+    InvalidateNetlist ();
 
   if (pcb && which == NAME_INDEX (pcb))
     DrawElementName (Element);
@@ -1133,6 +1147,8 @@ ChangeElementSide (ElementType *Element, Coord yoff)
   AddObjectToMirrorUndoList (ELEMENT_TYPE, Element, Element, Element, yoff);
   MirrorElementCoordinates (PCB->Data, Element, yoff);
   DrawElement (Element);
+  if (Settings.LiveRats)
+    UpdateElementRats (Element);
   return (true);
 }
 
@@ -2500,8 +2516,14 @@ QueryInputAndChangeObjectName (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
     }
   if (name)
     {
+      char *old;
+
+      /* the undo entry needs the old name, so the journal is told
+       * before the change
+       */
+      JournalTouch (UNDO_CHANGENAME, Type, Ptr1, Ptr2, Ptr3);
       /* NB: ChangeObjectName takes ownership of the passed memory */
-      char *old = (char *)ChangeObjectName (Type, Ptr1, Ptr2, Ptr3, name);
+      old = (char *)ChangeObjectName (Type, Ptr1, Ptr2, Ptr3, name);
       if (old != (char *) -1)
 	{
 	  AddObjectToChangeNameUndoList (Type, Ptr1, Ptr2, Ptr3, old);
@@ -324,6 +324,7 @@ CopyPastebufferToLayout (Coord X, Coord Y)
 {
   Cardinal i;
   bool changed = false;
+  GSList *pasted = NULL;
 
 #ifdef DEBUG
   printf("Entering CopyPastebufferToLayout.....\n");
@@ -378,7 +379,7 @@ CopyPastebufferToLayout (Coord X, Coord Y)
 #endif
 	if (FRONT (element) || PCB->InvisibleObjectsOn)
 	  {
-	    CopyElement (element);
+	    pasted = g_slist_prepend (pasted, CopyElement (element));
 	    changed = true;
 	  }
       }
@@ -396,6 +397,16 @@ CopyPastebufferToLayout (Coord X, Coord Y)
       END_LOOP;
     }
 
+  /* connect the new elements once the vias are in place too */
+  if (Settings.LiveRats)
+    {
+      GSList *iter;
+
+      for (iter = pasted; iter; iter = g_slist_next (iter))
+	UpdateElementRats ((ElementType *) iter->data);
+    }
+  g_slist_free (pasted);
+
   if (changed)
     {
       Draw ();
@@ -427,6 +438,8 @@ CopyObject (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 
   /* the subroutines add the objects to the undo-list */
   ptr = ObjectOperation (&CopyFunctions, Type, Ptr1, Ptr2, Ptr3);
+  if (Type == ELEMENT_TYPE && ptr && Settings.LiveRats)
+    UpdateElementRats ((ElementType *) ptr);
   IncrementUndoSerialNumber ();
   return (ptr);
 }
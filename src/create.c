@@ -51,6 +51,8 @@
 #include "parse_l.h"
 #include "pcb-printf.h"
 #include "polygon.h"
+#include "profile.h"
+#include "rats.h"
 #include "rtree.h"
 #include "search.h"
 #include "set.h"
@@ -231,13 +233,18 @@ CreateNewPCB (void)
 int
 CreateNewPCBPost (PCBType *pcb, int use_defaults)
 {
+  PROFILE_PUSH (PROFILE_LAYOUT);
+
   /* copy default settings */
   pcb_colors_from_settings (pcb);
 
   if (use_defaults)
     {
       if (ParseGroupString (Settings.Groups, &pcb->LayerGroups, &pcb->Data->LayerN))
-	return 1;
+	{
+	  PROFILE_POP ();
+	  return 1;
+	}
     }
 
   pcb->Data->Layer[top_silk_layer].Name = strdup ("top silk");
@@ -245,6 +252,7 @@ CreateNewPCBPost (PCBType *pcb, int use_defaults)
   pcb->Data->Layer[bottom_silk_layer].Name = strdup ("bottom silk");
   pcb->Data->Layer[bottom_silk_layer].Type = LT_SILK;
 
+  PROFILE_POP ();
   return 0;
 }
 
@@ -692,6 +700,7 @@ CreateNewPolygon (LayerType *Layer, FlagType Flags)
   polygon->Clipped = NULL;
   polygon->NoHoles = NULL;
   polygon->NoHolesValid = 0;
+  polygon->NoHolesDirty.X1 = polygon->NoHolesDirty.X2 = 0;
   return (polygon);
 }
 
@@ -755,6 +764,8 @@ CreateNewElement (DataType *Data, FontType *PCBFont, FlagType Flags,
   VALUE_TEXT (Element).Element = Element;
   Element->Flags = Flags;
   Element->ID = ID++;
+  if (PCB && Data == PCB->Data)
+    InvalidateNetlist ();
 
 #ifdef DEBUG_CREATE_C
   printf("  .... Leaving CreateNewElement.\n");
@@ -848,8 +859,8 @@ CreateNewPin (ElementType *Element,
   pin->Thickness = Thickness;
   pin->Clearance = Clearance;
   pin->Mask = Mask;
-  pin->Name = STRDUP (Name);
-  pin->Number = STRDUP (Number);
+  pin->Name = InternString (Name);
+  pin->Number = InternString (Number);
   pin->Flags = Flags;
   CLEAR_FLAG (WARNFLAG, pin);
   SET_FLAG (PINFLAG, pin);
@@ -928,8 +939,8 @@ CreateNewPad (ElementType *Element,
   pad->Thickness = Thickness;
   pad->Clearance = Clearance;
   pad->Mask = Mask;
-  pad->Name = STRDUP (Name);
-  pad->Number = STRDUP (Number);
+  pad->Name = InternString (Name);
+  pad->Number = InternString (Number);
   pad->Flags = Flags;
   CLEAR_FLAG (WARNFLAG, pad);
   pad->ID = ID++;
@@ -1067,8 +1078,8 @@ CreateNewAttribute (AttributeListType *list, char *name, char *value)
       list->Max += 10;
       list->List = (AttributeType *)realloc (list->List, list->Max * sizeof (AttributeType));
     }
-  list->List[list->Number].name = STRDUP (name);
-  list->List[list->Number].value = STRDUP (value);
+  list->List[list->Number].name = InternString (name);
+  list->List[list->Number].value = InternString (value);
   list->Number++;
   return &list->List[list->Number - 1];
 }
@@ -77,6 +77,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
 
 #include "buffer.h"
 #include "change.h"
@@ -87,17 +91,26 @@
 #include "error.h"
 #include "file.h"
 #include "hid.h"
+#include "journal.h"
 #include "layerflags.h"
 #include "misc.h"
 #include "mymem.h"
 #include "parse_l.h"
 #include "pcb-printf.h"
 #include "polygon.h"
+#include "profile.h"
 #include "rats.h"
 #include "remove.h"
 #include "set.h"
+#include "snapshot.h"
 #include "strflags.h"
 
+#if defined (HAVE_LIBZ) && defined (HAVE_ZLIB_H)
+#define COMPRESSED_FILES
+#include <errno.h>
+#include <zlib.h>
+#endif
+
 #ifdef HAVE_LIBDMALLOC
 #include <dmalloc.h>
 #endif
@@ -121,17 +134,88 @@ static void WriteViaData (FILE *, DataType *);
 static void WritePCBRatData (FILE *);
 static void WriteElementData (FILE *, DataType *);
 static void WriteLayerData (FILE *, Cardinal, LayerType *);
+static void WritePCBNetlistData (FILE *);
 static int WritePCB (FILE *);
 static int WritePCBFile (char *);
 static int WritePipe (char *, bool);
 static int ParseLibraryTree (void);
-static int LoadNewlibFootprintsFromDir(char *path, char *toppath, bool recursive);
 
 /* ---------------------------------------------------------------------------
  * Flag helper functions
  */
 
+/* Sections of a layout are formatted on worker threads into memory
+ * buffers, and then written in order, when the system can do that.
+ */
+#if defined (HAVE_OPEN_MEMSTREAM) && GLIB_CHECK_VERSION (2, 36, 0)
+#define PARALLEL_SAVE
+#endif
+
+/* Compressed layouts are saved through a pipe to a compressor thread,
+ * so the compression runs next to the formatting.
+ */
+#if defined (COMPRESSED_FILES) && defined (HAVE_PIPE) \
+    && GLIB_CHECK_VERSION (2, 32, 0)
+#define COMPRESSOR_THREAD
+#endif
+
+/* The newlib library is scanned in the background by a pool of threads,
+ * through directory file descriptors instead of the working directory.
+ */
+#if defined (HAVE_OPENAT) && defined (HAVE_FDOPENDIR) \
+    && defined (HAVE_FSTATAT) && defined (HAVE_REALPATH) \
+    && GLIB_CHECK_VERSION (2, 32, 0)
+#define LIBRARY_THREADS
+#include <errno.h>
+#include <fcntl.h>
+#endif
+
+/* Autosave backups are written by a child process when we can fork. */
+#if defined (HAVE_FORK) && defined (HAVE_SYS_WAIT_H)
+#define BACKGROUND_BACKUP
+#endif
+
+#ifdef PARALLEL_SAVE
+/* Cleared in a backup child, which must not start threads. */
+static bool save_in_threads = true;
+
+static GMutex flags_lock;
+
+static void
+free_flags_buffer (gpointer buffer)
+{
+  g_string_free (buffer, TRUE);
+}
+
+static GPrivate flags_buffer = G_PRIVATE_INIT (free_flags_buffer);
+
+/*!
+ * \brief flags_to_string() for the save threads.
+ *
+ * flags_to_string() returns static buffers, so copy its result into a
+ * buffer of the calling thread, which stays valid until the next call
+ * from the same thread.
+ */
+static char *
+thread_flags_to_string (FlagType flags, int type)
+{
+  GString *buffer = g_private_get (&flags_buffer);
+
+  if (buffer == NULL)
+    {
+      buffer = g_string_new (NULL);
+      g_private_set (&flags_buffer, buffer);
+    }
+  g_mutex_lock (&flags_lock);
+  g_string_assign (buffer, flags_to_string (flags, type));
+  g_mutex_unlock (&flags_lock);
+  return buffer->str;
+}
+
+#define F2S(OBJ, TYPE) thread_flags_to_string ((OBJ)->Flags, TYPE)
+#else
 #define F2S(OBJ, TYPE) flags_to_string ((OBJ)->Flags, TYPE)
+#endif
 
 /* --------------------------------------------------------------------------- */
 
@@ -373,11 +457,16 @@ SavePCB (char *file)
   int retcode;
 
   if (gui->notify_save_pcb == NULL)
-    return WritePipe (file, true);
+    retcode = WritePipe (file, true);
+  else
+    {
+      gui->notify_save_pcb (file, false);
+      retcode = WritePipe (file, true);
+      gui->notify_save_pcb (file, true);
+    }
 
-  gui->notify_save_pcb (file, false);
-  retcode = WritePipe (file, true);
-  gui->notify_save_pcb (file, true);
+  if (retcode == STATUS_OK)
+    JournalSaved (file);
 
   return retcode;
 }
@@ -413,14 +502,16 @@ real_load_pcb (char *Filename, bool revert)
 {
   const char *unit_suffix, *grid_size;
   char *new_filename;
-  PCBType *newPCB = CreateNewPCB ();
+  PCBType *newPCB;
   PCBType *oldPCB;
-#ifdef DEBUG
-  double elapsed;
-  clock_t start, end;
+  int failed;
 
-  start = clock ();
-#endif
+  if (Settings.ProfileLoad)
+    ProfileStart ();
+
+  PROFILE_PUSH (PROFILE_FONT);
+  newPCB = CreateNewPCB ();
+  PROFILE_POP ();
 
   new_filename = strdup (Filename);
 
@@ -431,7 +522,11 @@ real_load_pcb (char *Filename, bool revert)
   newPCB->Font.Valid = false;
 
   /* new data isn't added to the undo list */
-  if (!ParsePCB (PCB, new_filename))
+  PROFILE_PUSH (PROFILE_PARSE);
+  failed = IsSnapshotFile (new_filename) ? LoadSnapshot (PCB, new_filename)
+    : ParsePCB (PCB, new_filename);
+  PROFILE_POP ();
+  if (!failed)
     {
       RemovePCB (oldPCB);
 
@@ -478,7 +573,9 @@ real_load_pcb (char *Filename, bool revert)
           PCB->Grid = GetValue (grid_size, NULL, NULL);
         }
  
+      PROFILE_PUSH (PROFILE_NETLIST);
       sort_netlist ();
+      PROFILE_POP ();
 
       set_some_route_style ();
 
@@ -487,13 +584,9 @@ real_load_pcb (char *Filename, bool revert)
       else
         hid_action ("PCBChanged");
 
-#ifdef DEBUG
-      end = clock ();
-      elapsed = ((double) (end - start)) / CLOCKS_PER_SEC;
-      gui->log ("Loading file %s took %f seconds of CPU time\n",
-		new_filename, elapsed);
-#endif
+      JournalStart ();
 
+      ProfileReport (new_filename);
       return (0);
     }
   PCB = oldPCB;
@@ -501,6 +594,7 @@ real_load_pcb (char *Filename, bool revert)
 
   /* release unused memory */
   RemovePCB (newPCB);
+  ProfileReport (Filename);
   return (1);
 }
 
@@ -528,10 +622,21 @@ RevertPCB (void)
 static void
 PrintQuotedString (FILE * FP, char *S)
 {
-  static DynamicStringType ds;
+  char *p;
 
-  CreateQuotedString (&ds, S);
-  fputs (ds.Data, FP);
+  /* Same quoting as CreateQuotedString(), but without a static buffer,
+   * so the save threads can use this.
+   */
+  putc ('"', FP);
+  for (p = S; *p; p++)
+    if (*p == '"' || *p == '\\')
+      {
+	fwrite (S, 1, p - S, FP);
+	putc ('\\', FP);
+	S = p;
+      }
+  fputs (S, FP);
+  putc ('"', FP);
 }
 
 /*!
@@ -638,6 +743,20 @@ WritePCBFontData (FILE * FP)
     }
 }
 
+/*!
+ * \brief Writes one via.
+ */
+static void
+WriteVia (FILE * FP, PinType *via)
+{
+  pcb_fprintf (FP, "Via[%mr %mr %mr %mr %mr %mr ", via->X, via->Y,
+               via->Thickness, via->Clearance, via->Mask, via->DrillingHole);
+  if ((via->BuriedFrom != 0) || (via->BuriedTo != 0))
+    fprintf (FP, "%d %d ", via->BuriedFrom, via->BuriedTo);
+  PrintQuotedString (FP, (char *)EMPTY (via->Name));
+  fprintf (FP, " %s]\n", F2S (via, VIA_TYPE));
+}
+
 /*!
  * \brief Writes via data.
  */
@@ -647,15 +766,19 @@ WriteViaData (FILE * FP, DataType *Data)
   GList *iter;
   /* write information about vias */
   for (iter = Data->Via; iter != NULL; iter = g_list_next (iter))
-    {
-      PinType *via = iter->data;
-      pcb_fprintf (FP, "Via[%mr %mr %mr %mr %mr %mr ", via->X, via->Y,
-                   via->Thickness, via->Clearance, via->Mask, via->DrillingHole);
-      if ((via->BuriedFrom != 0) || (via->BuriedTo != 0))
-        fprintf (FP, "%d %d ", via->BuriedFrom, via->BuriedTo);
-      PrintQuotedString (FP, (char *)EMPTY (via->Name));
-      fprintf (FP, " %s]\n", F2S (via, VIA_TYPE));
-    }
+    WriteVia (FP, iter->data);
+}
+
+/*!
+ * \brief Writes one rat-line.
+ */
+static void
+WriteRat (FILE * FP, RatType *line)
+{
+  pcb_fprintf (FP, "Rat[%mr %mr %d %mr %mr %d ",
+               line->Point1.X, line->Point1.Y, line->group1,
+               line->Point2.X, line->Point2.Y, line->group2);
+  fprintf (FP, " %s]\n", F2S (line, RATLINE_TYPE));
 }
 
 /*!
@@ -667,13 +790,7 @@ WritePCBRatData (FILE * FP)
   GList *iter;
   /* write information about rats */
   for (iter = PCB->Data->Rat; iter != NULL; iter = g_list_next (iter))
-    {
-      RatType *line = iter->data;
-      pcb_fprintf (FP, "Rat[%mr %mr %d %mr %mr %d ",
-                   line->Point1.X, line->Point1.Y, line->group1,
-                   line->Point2.X, line->Point2.Y, line->group2);
-      fprintf (FP, " %s]\n", F2S (line, RATLINE_TYPE));
-    }
+    WriteRat (FP, iter->data);
 }
 
 /*!
@@ -709,13 +826,88 @@ WritePCBNetlistData (FILE * FP)
     }
 }
 
+/*!
+ * \brief Writes one element.
+ */
+static void
+WriteElement (FILE * FP, ElementType *element)
+{
+  GList *p;
+
+  /* the coordinates and text-flags are the same for
+   * both names of an element
+   */
+  fprintf (FP, "\nElement[%s ", F2S (element, ELEMENT_TYPE));
+  PrintQuotedString (FP, (char *)EMPTY (DESCRIPTION_NAME (element)));
+  fputc (' ', FP);
+  PrintQuotedString (FP, (char *)EMPTY (NAMEONPCB_NAME (element)));
+  fputc (' ', FP);
+  PrintQuotedString (FP, (char *)EMPTY (VALUE_NAME (element)));
+  pcb_fprintf (FP, " %mr %mr %mr %mr %d %d %s]\n(\n",
+	       element->MarkX, element->MarkY,
+	       DESCRIPTION_TEXT (element).X - element->MarkX,
+	       DESCRIPTION_TEXT (element).Y - element->MarkY,
+	       DESCRIPTION_TEXT (element).Direction,
+	       DESCRIPTION_TEXT (element).Scale,
+	       F2S (&(DESCRIPTION_TEXT (element)), ELEMENTNAME_TYPE));
+  WriteAttributeList (FP, &element->Attributes, "\t");
+  for (p = element->Pin; p != NULL; p = g_list_next (p))
+    {
+      PinType *pin = p->data;
+      pcb_fprintf (FP, "\tPin[%mr %mr %mr %mr %mr %mr ",
+		   pin->X - element->MarkX,
+		   pin->Y - element->MarkY,
+		   pin->Thickness, pin->Clearance,
+		   pin->Mask, pin->DrillingHole);
+      PrintQuotedString (FP, (char *)EMPTY (pin->Name));
+      fprintf (FP, " ");
+      PrintQuotedString (FP, (char *)EMPTY (pin->Number));
+      fprintf (FP, " %s]\n", F2S (pin, PIN_TYPE));
+    }
+  for (p = element->Pad; p != NULL; p = g_list_next (p))
+    {
+      PadType *pad = p->data;
+      pcb_fprintf (FP, "\tPad[%mr %mr %mr %mr %mr %mr %mr ",
+		   pad->Point1.X - element->MarkX,
+		   pad->Point1.Y - element->MarkY,
+		   pad->Point2.X - element->MarkX,
+		   pad->Point2.Y - element->MarkY,
+		   pad->Thickness, pad->Clearance, pad->Mask);
+      PrintQuotedString (FP, (char *)EMPTY (pad->Name));
+      fprintf (FP, " ");
+      PrintQuotedString (FP, (char *)EMPTY (pad->Number));
+      fprintf (FP, " %s]\n", F2S (pad, PAD_TYPE));
+    }
+  for (p = element->Line; p != NULL; p = g_list_next (p))
+    {
+      LineType *line = p->data;
+      pcb_fprintf (FP, "\tElementLine [%mr %mr %mr %mr %mr]\n",
+		   line->Point1.X - element->MarkX,
+		   line->Point1.Y - element->MarkY,
+		   line->Point2.X - element->MarkX,
+		   line->Point2.Y - element->MarkY,
+		   line->Thickness);
+    }
+  for (p = element->Arc; p != NULL; p = g_list_next (p))
+    {
+      ArcType *arc = p->data;
+      pcb_fprintf (FP, "\tElementArc [%mr %mr %mr %mr %ma %ma %mr]\n",
+		   arc->X - element->MarkX,
+		   arc->Y - element->MarkY,
+		   arc->Width, arc->Height,
+		   arc->StartAngle, arc->Delta,
+		   arc->Thickness);
+    }
+  fputs ("\n\t)\n", FP);
+}
+
 /*!
  * \brief Writes element data.
  */
 static void
 WriteElementData (FILE * FP, DataType *Data)
 {
-  GList *n, *p;
+  GList *n;
   for (n = Data->Element; n != NULL; n = g_list_next (n))
     {
       ElementType *element = n->data;
@@ -724,72 +916,94 @@ WriteElementData (FILE * FP, DataType *Data)
       if (!element->LineN && !element->PinN && !element->ArcN
 	  && !element->PadN)
 	continue;
-      /* the coordinates and text-flags are the same for
-       * both names of an element
-       */
-      fprintf (FP, "\nElement[%s ", F2S (element, ELEMENT_TYPE));
-      PrintQuotedString (FP, (char *)EMPTY (DESCRIPTION_NAME (element)));
-      fputc (' ', FP);
-      PrintQuotedString (FP, (char *)EMPTY (NAMEONPCB_NAME (element)));
-      fputc (' ', FP);
-      PrintQuotedString (FP, (char *)EMPTY (VALUE_NAME (element)));
-      pcb_fprintf (FP, " %mr %mr %mr %mr %d %d %s]\n(\n",
-                   element->MarkX, element->MarkY,
-                   DESCRIPTION_TEXT (element).X - element->MarkX,
-                   DESCRIPTION_TEXT (element).Y - element->MarkY,
-                   DESCRIPTION_TEXT (element).Direction,
-                   DESCRIPTION_TEXT (element).Scale,
-                   F2S (&(DESCRIPTION_TEXT (element)), ELEMENTNAME_TYPE));
-      WriteAttributeList (FP, &element->Attributes, "\t");
-      for (p = element->Pin; p != NULL; p = g_list_next (p))
-	{
-	  PinType *pin = p->data;
-          pcb_fprintf (FP, "\tPin[%mr %mr %mr %mr %mr %mr ",
-                       pin->X - element->MarkX,
-                       pin->Y - element->MarkY,
-                       pin->Thickness, pin->Clearance,
-                       pin->Mask, pin->DrillingHole);
-	  PrintQuotedString (FP, (char *)EMPTY (pin->Name));
-	  fprintf (FP, " ");
-	  PrintQuotedString (FP, (char *)EMPTY (pin->Number));
-	  fprintf (FP, " %s]\n", F2S (pin, PIN_TYPE));
-	}
-      for (p = element->Pad; p != NULL; p = g_list_next (p))
-	{
-	  PadType *pad = p->data;
-          pcb_fprintf (FP, "\tPad[%mr %mr %mr %mr %mr %mr %mr ",
-                       pad->Point1.X - element->MarkX,
-                       pad->Point1.Y - element->MarkY,
-                       pad->Point2.X - element->MarkX,
-                       pad->Point2.Y - element->MarkY,
-                       pad->Thickness, pad->Clearance, pad->Mask);
-	  PrintQuotedString (FP, (char *)EMPTY (pad->Name));
-	  fprintf (FP, " ");
-	  PrintQuotedString (FP, (char *)EMPTY (pad->Number));
-	  fprintf (FP, " %s]\n", F2S (pad, PAD_TYPE));
-	}
-      for (p = element->Line; p != NULL; p = g_list_next (p))
+      WriteElement (FP, element);
+    }
+}
+
+/*!
+ * \brief Writes the "Layer(...)" line of a layer.
+ */
+static void
+WriteLayerHeader (FILE * FP, Cardinal Number, LayerType *layer)
+{
+  fprintf (FP, "Layer(%i ", (int) Number + 1);
+  PrintQuotedString (FP, (char *)EMPTY (layer->Name));
+  fprintf (FP, " \"%s\")\n", layertype_to_string (layer->Type));
+}
+
+/*!
+ * \brief Writes one line of a layer.
+ */
+static void
+WriteLine (FILE * FP, LineType *line)
+{
+  pcb_fprintf (FP, "\tLine[%mr %mr %mr %mr %mr %mr %s]\n",
+               line->Point1.X, line->Point1.Y,
+               line->Point2.X, line->Point2.Y,
+               line->Thickness, line->Clearance,
+               F2S (line, LINE_TYPE));
+}
+
+/*!
+ * \brief Writes one arc of a layer.
+ */
+static void
+WriteArc (FILE * FP, ArcType *arc)
+{
+  pcb_fprintf (FP, "\tArc[%mr %mr %mr %mr %mr %mr %ma %ma %s]\n",
+               arc->X, arc->Y, arc->Width,
+               arc->Height, arc->Thickness,
+               arc->Clearance, arc->StartAngle,
+               arc->Delta, F2S (arc, ARC_TYPE));
+}
+
+/*!
+ * \brief Writes one text of a layer.
+ */
+static void
+WriteText (FILE * FP, TextType *text)
+{
+  pcb_fprintf (FP, "\tText[%mr %mr %d %d ",
+               text->X, text->Y,
+               text->Direction, text->Scale);
+  PrintQuotedString (FP, (char *)EMPTY (text->TextString));
+  fprintf (FP, " %s]\n", F2S (text, TEXT_TYPE));
+}
+
+/*!
+ * \brief Writes one polygon of a layer.
+ */
+static void
+WritePolygon (FILE * FP, PolygonType *polygon)
+{
+  int p, i = 0;
+  Cardinal hole = 0;
+  fprintf (FP, "\tPolygon(%s)\n\t(", F2S (polygon, POLYGON_TYPE));
+  for (p = 0; p < polygon->PointN; p++)
+    {
+      PointType *point = &polygon->Points[p];
+
+      if (hole < polygon->HoleIndexN &&
+	  p == polygon->HoleIndex[hole])
 	{
-	  LineType *line = p->data;
-          pcb_fprintf (FP, "\tElementLine [%mr %mr %mr %mr %mr]\n",
-                       line->Point1.X - element->MarkX,
-                       line->Point1.Y - element->MarkY,
-                       line->Point2.X - element->MarkX,
-                       line->Point2.Y - element->MarkY,
-                       line->Thickness);
+	  if (hole > 0)
+	    fputs ("\n\t\t)", FP);
+	  fputs ("\n\t\tHole (", FP);
+	  hole++;
+	  i = 0;
 	}
-      for (p = element->Arc; p != NULL; p = g_list_next (p))
+
+      if (i++ % 5 == 0)
 	{
-	  ArcType *arc = p->data;
-          pcb_fprintf (FP, "\tElementArc [%mr %mr %mr %mr %ma %ma %mr]\n",
-                       arc->X - element->MarkX,
-                       arc->Y - element->MarkY,
-                       arc->Width, arc->Height,
-                       arc->StartAngle, arc->Delta,
-                       arc->Thickness);
+	  fputs ("\n\t\t", FP);
+	  if (hole)
+	    fputs ("\t", FP);
 	}
-      fputs ("\n\t)\n", FP);
+      pcb_fprintf (FP, "[%mr %mr] ", point->X, point->Y);
     }
+  if (hole > 0)
+    fputs ("\n\t\t)", FP);
+  fputs ("\n\t)\n", FP);
 }
 
 /*!
@@ -803,72 +1017,192 @@ WriteLayerData (FILE * FP, Cardinal Number, LayerType *layer)
   if (layer->LineN || layer->ArcN || layer->TextN || layer->PolygonN ||
       (layer->Name && *layer->Name))
     {
-      fprintf (FP, "Layer(%i ", (int) Number + 1);
-      PrintQuotedString (FP, (char *)EMPTY (layer->Name));
-      fprintf (FP, " \"%s\")\n(\n", layertype_to_string (layer->Type));
+      WriteLayerHeader (FP, Number, layer);
+      fputs ("(\n", FP);
       WriteAttributeList (FP, &layer->Attributes, "\t");
 
       for (n = layer->Line; n != NULL; n = g_list_next (n))
-	{
-	  LineType *line = n->data;
-          pcb_fprintf (FP, "\tLine[%mr %mr %mr %mr %mr %mr %s]\n",
-                       line->Point1.X, line->Point1.Y,
-                       line->Point2.X, line->Point2.Y,
-                       line->Thickness, line->Clearance,
-                       F2S (line, LINE_TYPE));
-	}
+	WriteLine (FP, n->data);
       for (n = layer->Arc; n != NULL; n = g_list_next (n))
-	{
-	  ArcType *arc = n->data;
-          pcb_fprintf (FP, "\tArc[%mr %mr %mr %mr %mr %mr %ma %ma %s]\n",
-                       arc->X, arc->Y, arc->Width,
-                       arc->Height, arc->Thickness,
-                       arc->Clearance, arc->StartAngle,
-                       arc->Delta, F2S (arc, ARC_TYPE));
-	}
+	WriteArc (FP, n->data);
       for (n = layer->Text; n != NULL; n = g_list_next (n))
-	{
-	  TextType *text = n->data;
-          pcb_fprintf (FP, "\tText[%mr %mr %d %d ",
-                       text->X, text->Y,
-                       text->Direction, text->Scale);
-	  PrintQuotedString (FP, (char *)EMPTY (text->TextString));
-	  fprintf (FP, " %s]\n", F2S (text, TEXT_TYPE));
-	}
+	WriteText (FP, n->data);
       for (n = layer->Polygon; n != NULL; n = g_list_next (n))
-	{
-	  PolygonType *polygon = n->data;
-	  int p, i = 0;
-	  Cardinal hole = 0;
-	  fprintf (FP, "\tPolygon(%s)\n\t(", F2S (polygon, POLYGON_TYPE));
-	  for (p = 0; p < polygon->PointN; p++)
-	    {
-	      PointType *point = &polygon->Points[p];
+	WritePolygon (FP, n->data);
+      fputs (")\n", FP);
+    }
+}
 
-	      if (hole < polygon->HoleIndexN &&
-		  p == polygon->HoleIndex[hole])
-		{
-		  if (hole > 0)
-		    fputs ("\n\t\t)", FP);
-		  fputs ("\n\t\tHole (", FP);
-		  hole++;
-		  i = 0;
-		}
+/*!
+ * \brief Writes one object the way it appears in a layout file.
+ *
+ * Type is one of VIA_TYPE, ELEMENT_TYPE, RATLINE_TYPE, LINE_TYPE,
+ * ARC_TYPE, TEXT_TYPE and POLYGON_TYPE.  Layer objects are written
+ * without their layer; see WritePCBLayerHeader().
+ */
+void
+WritePCBObject (FILE * FP, int Type, void *Ptr)
+{
+  switch (Type)
+    {
+    case VIA_TYPE:
+      WriteVia (FP, Ptr);
+      break;
+    case ELEMENT_TYPE:
+      WriteElement (FP, Ptr);
+      break;
+    case RATLINE_TYPE:
+      WriteRat (FP, Ptr);
+      break;
+    case LINE_TYPE:
+      WriteLine (FP, Ptr);
+      break;
+    case ARC_TYPE:
+      WriteArc (FP, Ptr);
+      break;
+    case TEXT_TYPE:
+      WriteText (FP, Ptr);
+      break;
+    case POLYGON_TYPE:
+      WritePolygon (FP, Ptr);
+      break;
+    }
+}
 
-	      if (i++ % 5 == 0)
-		{
-		  fputs ("\n\t\t", FP);
-		  if (hole)
-		    fputs ("\t", FP);
-		}
-              pcb_fprintf (FP, "[%mr %mr] ", point->X, point->Y);
-	    }
-	  if (hole > 0)
-	    fputs ("\n\t\t)", FP);
-	  fputs ("\n\t)\n", FP);
-	}
-      fputs (")\n", FP);
+/*!
+ * \brief Writes the line which starts a layer in a layout file.
+ */
+void
+WritePCBLayerHeader (FILE * FP, Cardinal Number, LayerType *Layer)
+{
+  WriteLayerHeader (FP, Number, Layer);
+}
+
+/*!
+ * \brief The sections of a layout file after its header and font.
+ */
+enum
+{
+  SECTION_VIAS,
+  SECTION_ELEMENTS,
+  SECTION_RATS,
+  SECTION_LAYER,
+  SECTION_NETLIST
+};
+
+typedef struct
+{
+  int kind;
+  Cardinal layer;		/*!< Layer number of a SECTION_LAYER. */
+  char *text;			/*!< The formatted section, if any. */
+  size_t size;
+} SaveSectionType;
+
+/*!
+ * \brief Writes one section of the layout.
+ */
+static void
+WritePCBSection (FILE * FP, SaveSectionType *section)
+{
+  switch (section->kind)
+    {
+    case SECTION_VIAS:
+      WriteViaData (FP, PCB->Data);
+      break;
+    case SECTION_ELEMENTS:
+      WriteElementData (FP, PCB->Data);
+      break;
+    case SECTION_RATS:
+      WritePCBRatData (FP);
+      break;
+    case SECTION_LAYER:
+      WriteLayerData (FP, section->layer, &(PCB->Data->Layer[section->layer]));
+      break;
+    case SECTION_NETLIST:
+      WritePCBNetlistData (FP);
+      break;
+    }
+}
+
+#ifdef PARALLEL_SAVE
+/*!
+ * \brief Thread pool function: formats one section into memory.
+ *
+ * If that fails, the section's text is left NULL and WritePCBSections()
+ * writes the section itself.
+ */
+static void
+FormatPCBSection (gpointer data, gpointer user_data)
+{
+  SaveSectionType *section = data;
+  FILE *fp;
+  bool failed;
+
+  if ((fp = open_memstream (&section->text, &section->size)) == NULL)
+    {
+      section->text = NULL;
+      return;
+    }
+  WritePCBSection (fp, section);
+  failed = ferror (fp);
+  if (fclose (fp) != 0)
+    failed = true;
+  if (failed)
+    {
+      free (section->text);
+      section->text = NULL;
+    }
+}
+#endif
+
+/*!
+ * \brief Writes vias, elements, rats, layers and netlist.
+ *
+ * The sections don't depend on each other, so they are formatted in
+ * parallel when possible, and then written in the usual order.  The
+ * file is the same either way.
+ */
+static void
+WritePCBSections (FILE * FP)
+{
+  SaveSectionType sections[4 + MAX_ALL_LAYER];
+  Cardinal i, n = 0;
+#ifdef PARALLEL_SAVE
+  GThreadPool *pool;
+#endif
+
+  memset (sections, 0, sizeof (sections));
+  sections[n++].kind = SECTION_VIAS;
+  sections[n++].kind = SECTION_ELEMENTS;
+  sections[n++].kind = SECTION_RATS;
+  for (i = 0; i < max_copper_layer + SILK_LAYER; i++)
+    {
+      sections[n].kind = SECTION_LAYER;
+      sections[n++].layer = i;
     }
+  sections[n++].kind = SECTION_NETLIST;
+
+#ifdef PARALLEL_SAVE
+  pool = !save_in_threads ? NULL :
+    g_thread_pool_new (FormatPCBSection, NULL, g_get_num_processors (),
+			    FALSE, NULL);
+  if (pool != NULL)
+    {
+      for (i = 0; i < n; i++)
+	g_thread_pool_push (pool, &sections[i], NULL);
+      /* wait for all of them */
+      g_thread_pool_free (pool, FALSE, TRUE);
+    }
+#endif
+
+  for (i = 0; i < n; i++)
+    if (sections[i].text != NULL)
+      {
+	fwrite (sections[i].text, 1, sections[i].size, FP);
+	free (sections[i].text);
+      }
+    else
+      WritePCBSection (FP, &sections[i]);
 }
 
 /*!
@@ -887,12 +1221,11 @@ WriteBuffer (FILE * FP)
 }
 
 /*!
- * \brief Writes PCB to file.
+ * \brief Writes the layout, without any messages.
  */
-static int
-WritePCB (FILE * FP)
+void
+WritePCBData (FILE * FP)
 {
-  Cardinal i;
   if (Settings.SaveMetricOnly)
     set_allow_readable (ALLOW_MM);
   else
@@ -902,18 +1235,22 @@ WritePCB (FILE * FP)
   WritePCBDataHeader (FP);
   WritePCBFontData (FP);
   WriteAttributeList (FP, &PCB->Attributes, "");
-  WriteViaData (FP, PCB->Data);
-  WriteElementData (FP, PCB->Data);
-  WritePCBRatData (FP);
-  for (i = 0; i < max_copper_layer + SILK_LAYER; i++)
-    WriteLayerData (FP, i, &(PCB->Data->Layer[i]));
-  WritePCBNetlistData (FP);
+  WritePCBSections (FP);
+}
 
-  if (ferror (FP))
-    Message (_("Error writing PCB file\n"));
-  else
-    Message (_("PCB file saved\n"));
+/*!
+ * \brief Writes PCB to file.
+ */
+static int
+WritePCB (FILE * FP)
+{
+  WritePCBData (FP);
 
+  if (ferror (FP))
+    {
+      Message (_("Error writing PCB file\n"));
+      return (STATUS_ERROR);
+    }
   return (STATUS_OK);
 }
 
@@ -942,38 +1279,286 @@ WritePCBFile (char *Filename)
 }
 
 /*!
- * \brief Writes to pipe using the command defined by Settings.SaveCommand
- * %f are replaced by the passed filename.
+ * \brief Tells whether a file is gzip compressed.
  */
-static int
-WritePipe (char *Filename, bool thePcb)
+bool
+IsCompressedFile (const char *Filename)
 {
+#ifdef COMPRESSED_FILES
+  unsigned char magic[2];
   FILE *fp;
-  int result;
-  char *p;
-  static DynamicStringType command;
-  int used_popen = 0;
+  bool result;
 
-  if (EMPTY_STRING_P (Settings.SaveCommand))
+  if ((fp = fopen (Filename, "rb")) == NULL)
+    return false;
+  result = fread (magic, 1, 2, fp) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+  fclose (fp);
+  return result;
+#else
+  return false;
+#endif
+}
+
+/*!
+ * \brief Reads a gzip compressed file into memory.
+ *
+ * \return The uncompressed data, to be released with free(), or NULL.
+ */
+char *
+ReadCompressedFile (const char *Filename, size_t *Size)
+{
+#ifdef COMPRESSED_FILES
+  gzFile gz;
+  char *data;
+  size_t size = 0, alloc = 1 << 20;
+  unsigned char trailer[4];
+  FILE *fp;
+  int n;
+
+  /* The last four bytes hold the uncompressed size modulo 4 GB, which
+   * is a good guess for the buffer size.
+   */
+  if ((fp = fopen (Filename, "rb")) != NULL)
     {
-      fp = fopen (Filename, "w");
-      if (fp == 0)
+      if (fseek (fp, -4, SEEK_END) == 0 && fread (trailer, 1, 4, fp) == 4)
 	{
-	  Message ("Unable to write to file %s\n", Filename);
-	  return STATUS_ERROR;
+	  size_t isize = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16)
+	    | ((size_t) trailer[3] << 24);
+	  if (isize + 1 > alloc)
+	    alloc = isize + 1;
 	}
+      fclose (fp);
     }
-  else
+
+  if ((gz = gzopen (Filename, "rb")) == NULL)
+    return NULL;
+#if ZLIB_VERNUM >= 0x1240
+  gzbuffer (gz, 1 << 17);
+#endif
+  /* a corrupt trailer can ask for far too much, so fall back to the
+   * default size before giving up
+   */
+  if ((data = (char *)malloc (alloc)) == NULL && alloc > 1 << 20)
+    data = (char *)malloc (alloc = 1 << 20);
+  if (data == NULL)
     {
-      used_popen = 1;
-      /* setup commandline */
-      DSClearString (&command);
-      for (p = Settings.SaveCommand; *p; p++)
+      Message (_("Out of memory reading %s\n"), Filename);
+      gzclose (gz);
+      return NULL;
+    }
+  for (;;)
+    {
+      if (size + 1 == alloc)
 	{
-	  /* copy character if not special or add string to command */
-	  if (!(*p == '%' && *(p + 1) == 'f'))
-	    DSAddCharacter (&command, *p);
-	  else
+	  /* the buffer is full; only grow it if there is more to read,
+	   * which does not happen when the size in the trailer was right
+	   */
+	  char more[1 << 12], *grown;
+
+	  if ((n = gzread (gz, more, sizeof (more))) <= 0)
+	    break;
+	  alloc = MAX (alloc * 2, size + n + 1);
+	  if ((grown = (char *)realloc (data, alloc)) == NULL)
+	    {
+	      Message (_("Out of memory reading %s\n"), Filename);
+	      gzclose (gz);
+	      free (data);
+	      return NULL;
+	    }
+	  data = grown;
+	  memcpy (data + size, more, n);
+	  size += n;
+	  continue;
+	}
+      n = gzread (gz, data + size, MIN (alloc - size - 1, 1 << 30));
+      if (n <= 0)
+	break;
+      size += n;
+    }
+  if (gzclose (gz) != Z_OK || n < 0)
+    {
+      Message (_("Error uncompressing %s\n"), Filename);
+      free (data);
+      return NULL;
+    }
+  data[size] = '\0';
+  *Size = size;
+  return data;
+#else
+  return NULL;
+#endif
+}
+
+#ifdef COMPRESSED_FILES
+/*!
+ * \brief The compressor of the layout being saved.
+ */
+static struct
+{
+  gzFile gz;
+#ifdef COMPRESSOR_THREAD
+  int fd;			/*!< The read end of the pipe. */
+  GThread *thread;
+#else
+  FILE *tmp;			/*!< The uncompressed layout. */
+#endif
+  bool failed;
+} compressor;
+
+#ifdef COMPRESSOR_THREAD
+static gpointer
+compress_thread (gpointer data)
+{
+  char buffer[1 << 16];
+  ssize_t n;
+
+  while ((n = read (compressor.fd, buffer, sizeof (buffer))) != 0)
+    {
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  compressor.failed = true;
+	  break;
+	}
+      /* keep draining the pipe after an error, the writer would
+       * block otherwise
+       */
+      if (!compressor.failed && gzwrite (compressor.gz, buffer, n) != n)
+	compressor.failed = true;
+    }
+  close (compressor.fd);
+  return NULL;
+}
+#endif
+
+/*!
+ * \brief Opens a stream which writes gzip compressed data to Filename.
+ *
+ * Close it with CloseCompressed().
+ */
+static FILE *
+OpenCompressed (char *Filename)
+{
+  FILE *fp;
+#ifdef COMPRESSOR_THREAD
+  int fds[2];
+#endif
+
+  if ((compressor.gz = gzopen (Filename, "wb")) == NULL)
+    return NULL;
+#if ZLIB_VERNUM >= 0x1240
+  gzbuffer (compressor.gz, 1 << 17);
+#endif
+  compressor.failed = false;
+
+#ifdef COMPRESSOR_THREAD
+  if (pipe (fds) != 0)
+    {
+      gzclose (compressor.gz);
+      return NULL;
+    }
+  if ((fp = fdopen (fds[1], "w")) == NULL)
+    {
+      close (fds[0]);
+      close (fds[1]);
+      gzclose (compressor.gz);
+      return NULL;
+    }
+  compressor.fd = fds[0];
+  compressor.thread = g_thread_new ("compress", compress_thread, NULL);
+#else
+  if ((fp = compressor.tmp = tmpfile ()) == NULL)
+    {
+      gzclose (compressor.gz);
+      return NULL;
+    }
+#endif
+  return fp;
+}
+
+/*!
+ * \brief Finishes a stream from OpenCompressed().
+ *
+ * \return 0 on success, EOF on errors.
+ */
+static int
+CloseCompressed (FILE *FP)
+{
+  int result;
+
+#ifdef COMPRESSOR_THREAD
+  /* closing the pipe ends the compressor thread */
+  result = fclose (FP);
+  g_thread_join (compressor.thread);
+#else
+  char buffer[1 << 16];
+  size_t n;
+
+  result = fflush (FP);
+  rewind (FP);
+  while ((n = fread (buffer, 1, sizeof (buffer), FP)) > 0)
+    if (gzwrite (compressor.gz, buffer, n) != (int) n)
+      compressor.failed = true;
+  if (ferror (FP))
+    compressor.failed = true;
+  fclose (FP);
+#endif
+  if (gzclose (compressor.gz) != Z_OK)
+    compressor.failed = true;
+  return result != 0 || compressor.failed ? EOF : 0;
+}
+#endif
+
+/*!
+ * \brief Writes to pipe using the command defined by Settings.SaveCommand
+ * %f are replaced by the passed filename.
+ */
+static int
+WritePipe (char *Filename, bool thePcb)
+{
+  FILE *fp;
+  int result, closed;
+  char *p;
+  static DynamicStringType command;
+  int used_popen = 0;
+#ifdef COMPRESSED_FILES
+  bool compressed = false;
+#endif
+
+#ifdef COMPRESSED_FILES
+  if (EMPTY_STRING_P (Settings.SaveCommand) && thePcb
+      && g_str_has_suffix (Filename, ".gz"))
+    {
+      compressed = true;
+      if ((fp = OpenCompressed (Filename)) == NULL)
+	{
+	  Message ("Unable to write to file %s\n", Filename);
+	  return STATUS_ERROR;
+	}
+    }
+  else
+#endif
+  if (EMPTY_STRING_P (Settings.SaveCommand))
+    {
+      fp = fopen (Filename, "w");
+      if (fp == 0)
+	{
+	  Message ("Unable to write to file %s\n", Filename);
+	  return STATUS_ERROR;
+	}
+    }
+  else
+    {
+      used_popen = 1;
+      /* setup commandline */
+      DSClearString (&command);
+      for (p = Settings.SaveCommand; *p; p++)
+	{
+	  /* copy character if not special or add string to command */
+	  if (!(*p == '%' && *(p + 1) == 'f'))
+	    DSAddCharacter (&command, *p);
+	  else
 	    {
 	      DSAddString (&command, Filename);
 
@@ -1002,9 +1587,22 @@ WritePipe (char *Filename, bool thePcb)
   else
     result = WriteBuffer (fp);
 
+#ifdef COMPRESSED_FILES
+  if (compressed)
+    closed = CloseCompressed (fp);
+  else
+#endif
   if (used_popen)
-    return (pclose (fp) ? STATUS_ERROR : result);
-  return (fclose (fp) ? STATUS_ERROR : result);
+    closed = pclose (fp);
+  else
+    closed = fclose (fp);
+  if (closed != 0)
+    result = STATUS_ERROR;
+
+  /* a compressed layout is only written once the compressor is done */
+  if (thePcb && !PCB->is_footprint && result == STATUS_OK)
+    Message (_("PCB file saved\n"));
+  return (result);
 }
 
 /*!
@@ -1089,12 +1687,92 @@ EnableAutosave (void)
 				   x);
 }
 
+#ifdef BACKGROUND_BACKUP
+static pid_t backup_pid = 0;
+static char *backup_filename = NULL;
+
+/*!
+ * \brief Checks on the last background backup.
+ *
+ * Reaps the backup child if it has finished, and reports if it failed.
+ *
+ * \return true if the child is still writing.
+ */
+static bool
+BackupRunning (void)
+{
+  int status;
+  pid_t pid;
+
+  if (backup_pid <= 0)
+    return false;
+  pid = waitpid (backup_pid, &status, WNOHANG);
+  if (pid == 0)
+    return true;
+  if (pid < 0 || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    Message (_("Error writing PCB backup file %s\n"), backup_filename);
+  backup_pid = 0;
+  return false;
+}
+
+/*!
+ * \brief Writes a backup file from a child process.
+ *
+ * The child gets a copy-on-write image of the board as it is now, so
+ * the user can go on editing while the file is written.  The child must
+ * not talk to the GUI, so it doesn't call Message(), and it leaves with
+ * _exit() so it doesn't run our atexit() handlers.
+ *
+ * If the previous backup is still being written, this one is skipped.
+ *
+ * \return false if no child could be started.
+ */
+static bool
+BackgroundBackup (char *filename)
+{
+  pid_t pid;
+
+  if (BackupRunning ())
+    return true;
+
+  pid = fork ();
+  if (pid < 0)
+    return false;
+  if (pid == 0)
+    {
+      FILE *fp;
+      int status = 1;
+
+#ifdef PARALLEL_SAVE
+      save_in_threads = false;
+#endif
+      if ((fp = fopen (filename, "w")) != NULL)
+	{
+	  WritePCBData (fp);
+	  status = ferror (fp) ? 1 : 0;
+	  if (fclose (fp) != 0)
+	    status = 1;
+	}
+      _exit (status);
+    }
+
+  backup_pid = pid;
+  free (backup_filename);
+  backup_filename = strdup (filename);
+  return true;
+}
+#endif
+
 /*!
  * \brief Creates a backup file.
  *
  * The default is to use the pcb file name with a "~" appended (like
  * "foo.pcb~") and if we don't have a pcb file name then use the
  * template in BACKUP_NAME.
+ *
+ * Where possible the file is written in the background, see
+ * BackgroundBackup().  EmergencySave() doesn't come here, and always
+ * saves right away.
  */
 void
 Backup (void)
@@ -1123,7 +1801,10 @@ Backup (void)
       sprintf (filename, BACKUP_NAME, (int) getpid ());
     }
 
-  WritePCBFile (filename);
+#ifdef BACKGROUND_BACKUP
+  if (!BackgroundBackup (filename))
+#endif
+    WritePCBFile (filename);
   free (filename);
 }
 
@@ -1153,6 +1834,534 @@ RemoveTMPData (void)
 }
 #endif
 
+/*!
+ * \brief One directory of the newlib library index.
+ *
+ * A directory's mtime changes whenever an entry is added, removed or
+ * renamed in it, so a record whose mtime still matches lists the same
+ * footprints and subdirectories and saves the readdir() and the stat()
+ * of every file.
+ */
+typedef struct
+{
+  time_t mtime; /*!< 0 if the record must be rebuilt. */
+  bool recursive; /*!< The subdirectories were scanned. */
+  bool used; /*!< Seen in this scan; unused records are dropped. */
+  int error; /*!< errno if the directory could not be read. */
+  GPtrArray *files; /*!< Footprint file names. */
+  GPtrArray *subdirs; /*!< Paths of the subdirectories. */
+} LibraryIndexDir;
+
+#define LIBRARY_INDEX_MAGIC "# PCB newlib library index 1"
+
+static GHashTable *library_index = NULL; /*!< Directory path to record. */
+static char *library_index_file = NULL;
+static bool library_index_changed;
+static time_t library_index_time;
+
+static void
+FreeLibraryIndexDir (LibraryIndexDir *dir)
+{
+  g_ptr_array_free (dir->files, TRUE);
+  g_ptr_array_free (dir->subdirs, TRUE);
+  free (dir);
+}
+
+static LibraryIndexDir *
+NewLibraryIndexDir (const char *path, time_t mtime, bool recursive)
+{
+  LibraryIndexDir *dir = (LibraryIndexDir *) calloc (1, sizeof (*dir));
+
+  dir->mtime = mtime;
+  dir->recursive = recursive;
+  dir->used = true;
+  dir->files = g_ptr_array_new_with_free_func (free);
+  dir->subdirs = g_ptr_array_new_with_free_func (free);
+  g_hash_table_replace (library_index, strdup (path), dir);
+  return dir;
+}
+
+/*!
+ * \brief Reads the index named by Settings.LibraryIndex, if any.
+ *
+ * The file holds a "D mtime recursive path" line per directory,
+ * followed by an "F name" line per footprint and an "S path" line per
+ * subdirectory.
+ */
+static void
+ReadLibraryIndex (void)
+{
+  char line[MAXPATHLEN + 64];
+  LibraryIndexDir *dir = NULL;
+  FILE *fp;
+  size_t len;
+
+  library_index = g_hash_table_new_full (g_str_hash, g_str_equal, free,
+					 (GDestroyNotify) FreeLibraryIndexDir);
+  library_index_changed = false;
+  library_index_time = time (NULL);
+
+  /* a copy, the index may be written after the settings are freed */
+  free (library_index_file);
+  library_index_file = NULL;
+  if (Settings.LibraryIndex == NULL || *Settings.LibraryIndex == '\0')
+    return;
+  library_index_file = strdup (Settings.LibraryIndex);
+  if ((fp = fopen (library_index_file, "r")) == NULL)
+    return;
+
+  if (fgets (line, sizeof (line), fp) == NULL
+      || strncmp (line, LIBRARY_INDEX_MAGIC, strlen (LIBRARY_INDEX_MAGIC)))
+    {
+      library_index_changed = true;
+      fclose (fp);
+      return;
+    }
+  while (fgets (line, sizeof (line), fp) != NULL)
+    {
+      long mtime;
+      int recursive, n;
+
+      len = strlen (line);
+      if (len == 0 || line[len - 1] != '\n')
+	break;
+      line[--len] = '\0';
+      if (line[0] == 'D'
+	  && sscanf (line, "D %ld %d %n", &mtime, &recursive, &n) == 2)
+	{
+	  dir = NewLibraryIndexDir (line + n, (time_t) mtime, recursive);
+	  dir->used = false;
+	}
+      else if (dir != NULL && line[0] == 'F' && line[1] == ' ')
+	g_ptr_array_add (dir->files, strdup (line + 2));
+      else if (dir != NULL && line[0] == 'S' && line[1] == ' ')
+	g_ptr_array_add (dir->subdirs, strdup (line + 2));
+      else
+	break;
+    }
+  fclose (fp);
+}
+
+/*!
+ * \brief Writes the directories seen in this scan back to the index
+ * if any of them changed.
+ */
+static void
+WriteLibraryIndex (void)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  char *tmpname, *dirname;
+  FILE *fp;
+  guint i;
+
+  if (library_index == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, library_index);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (!((LibraryIndexDir *) value)->used)
+      library_index_changed = true;
+
+  if (!library_index_changed || library_index_file == NULL)
+    return;
+  library_index_changed = false;
+
+  /* the index normally lives in ~/.pcb, which may not exist yet */
+  dirname = g_path_get_dirname (library_index_file);
+  MKDIR (dirname, 0755);
+  g_free (dirname);
+
+  /* write a new file and rename it, other instances may read the index */
+  tmpname = Concat (library_index_file, ".tmp", NULL);
+  if ((fp = fopen (tmpname, "w")) == NULL)
+    {
+      free (tmpname);
+      return;
+    }
+  fprintf (fp, "%s\n", LIBRARY_INDEX_MAGIC);
+  g_hash_table_iter_init (&iter, library_index);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      LibraryIndexDir *dir = (LibraryIndexDir *) value;
+
+      if (!dir->used || strchr ((char *) key, '\n') != NULL)
+	continue;
+      fprintf (fp, "D %ld %d %s\n", (long) dir->mtime, dir->recursive,
+	       (char *) key);
+      for (i = 0; i < dir->files->len; i++)
+	fprintf (fp, "F %s\n", (char *) g_ptr_array_index (dir->files, i));
+      for (i = 0; i < dir->subdirs->len; i++)
+	fprintf (fp, "S %s\n", (char *) g_ptr_array_index (dir->subdirs, i));
+    }
+  if (fclose (fp) != 0 || rename (tmpname, library_index_file) != 0)
+    unlink (tmpname);
+  free (tmpname);
+}
+
+static void
+FreeLibraryIndex (void)
+{
+  if (library_index != NULL)
+    g_hash_table_destroy (library_index);
+  library_index = NULL;
+}
+
+/*!
+ * \brief Returns the index record of a directory if it is still up to
+ * date.
+ */
+static LibraryIndexDir *
+LookupLibraryIndex (const char *path, time_t mtime, bool recursive)
+{
+  LibraryIndexDir *dir;
+
+  dir = (LibraryIndexDir *) g_hash_table_lookup (library_index, path);
+  if (dir == NULL || dir->mtime == 0 || dir->mtime != mtime
+      || (recursive && !dir->recursive))
+    return NULL;
+  dir->used = true;
+  return dir;
+}
+
+/*!
+ * \brief Adds the newlib footprint Name in directory Dir to a library
+ * menu.
+ */
+static void
+AddNewlibEntry (LibraryMenuType *menu, const char *Dir, const char *Name)
+{
+  LibraryEntryType *entry = GetLibraryEntryMemory (menu);
+  size_t len;
+
+  /* 
+   * entry->AllocatedMemory points to abs path to the footprint.
+   * entry->ListEntry points to fp name itself.
+   */
+  len = strlen(Dir) + strlen("/") + strlen(Name) + 1;
+  entry->AllocatedMemory = (char *)calloc (1, len);
+  strcat (entry->AllocatedMemory, Dir);
+  strcat (entry->AllocatedMemory, PCB_DIR_SEPARATOR_S);
+
+  /* store pointer to start of footprint name */
+  entry->ListEntry = entry->AllocatedMemory
+      + strlen (entry->AllocatedMemory);
+
+  /* Now place footprint name into AllocatedMemory */
+  strcat (entry->AllocatedMemory, Name);
+
+  /* mark as directory tree (newlib) library */
+  entry->Template = (char *) -1;
+}
+
+/*!
+ * \brief Tells if a regular file in a newlib directory is a footprint.
+ *
+ * We're skipping .png and .html because those may exist in a library
+ * tree to provide an html browsable index of the library.
+ */
+static bool
+IsNewlibFootprint (const char *Name)
+{
+  size_t l = strlen (Name);
+
+  return Name[0] != '.'
+    && NSTRCMP (Name, "CVS") != 0
+    && NSTRCMP (Name, "Makefile") != 0
+    && NSTRCMP (Name, "Makefile.am") != 0
+    && NSTRCMP (Name, "Makefile.in") != 0
+    && (l < 4 || NSTRCMP (Name + (l - 4), ".png") != 0)
+    && (l < 5 || NSTRCMP (Name + (l - 5), ".html") != 0)
+    && (l < 4 || NSTRCMP (Name + (l - 4), ".pcb") != 0);
+}
+
+#ifdef LIBRARY_THREADS
+
+#define LIBRARY_SCAN_THREADS 8
+
+/*!
+ * \brief A directory of the library tree to scan.
+ */
+typedef struct
+{
+  char *path; /*!< Resolved absolute path. */
+  bool recursive;
+} LibraryScanType;
+
+static GThreadPool *library_pool = NULL;
+static GPtrArray *library_tops = NULL;
+static GMutex library_lock; /*!< Guards the index and the count below. */
+static GCond library_done;
+static int library_pending; /*!< Directories queued or being scanned. */
+
+/*!
+ * \brief Queues the scan of a directory; the caller holds library_lock.
+ */
+static void
+QueueLibraryDir (const char *Path, bool Recursive)
+{
+  LibraryScanType *job = (LibraryScanType *) malloc (sizeof (*job));
+
+  job->path = strdup (Path);
+  job->recursive = Recursive;
+  library_pending++;
+  g_thread_pool_push (library_pool, job, NULL);
+}
+
+/*!
+ * \brief Scans one directory of the library in a pool thread.
+ *
+ * Up to date directories are taken from the index.  Others are read
+ * through their file descriptor, so the scan never changes the working
+ * directory of the process.  Subdirectories are queued as new tasks.
+ * Errors are kept in the index record and reported by the main thread
+ * in WaitForLibrary(), as Message() is not thread safe.
+ */
+static void
+ScanLibraryDir (gpointer Data, gpointer UserData)
+{
+  LibraryScanType *job = (LibraryScanType *) Data;
+  GPtrArray *files = g_ptr_array_new_with_free_func (free);
+  GPtrArray *subdirs = g_ptr_array_new_with_free_func (free);
+  LibraryIndexDir *dir;
+  struct dirent *entry;
+  struct stat buffer;
+  time_t mtime;
+  DIR *dirobj = NULL;
+  int fd, error = 0;
+  guint i;
+
+  if ((fd = open (job->path, O_RDONLY)) < 0)
+    error = errno;
+  mtime = (fd < 0 || fstat (fd, &buffer)) ? 0 : buffer.st_mtime;
+
+  g_mutex_lock (&library_lock);
+  dir = LookupLibraryIndex (job->path, mtime, job->recursive);
+  for (i = 0; dir != NULL && job->recursive && i < dir->subdirs->len; i++)
+    QueueLibraryDir (g_ptr_array_index (dir->subdirs, i), true);
+  g_mutex_unlock (&library_lock);
+
+  if (dir != NULL)
+    {
+      if (fd >= 0)
+	close (fd);
+      goto done;
+    }
+
+  if (fd >= 0 && (dirobj = fdopendir (fd)) == NULL)
+    error = errno;
+  while (dirobj != NULL && (entry = readdir (dirobj)) != NULL)
+    {
+      char *path;
+
+      if (entry->d_name[0] == '.' || NSTRCMP (entry->d_name, "CVS") == 0
+	  || fstatat (fd, entry->d_name, &buffer, 0))
+	continue;
+      /* the index has a line per name */
+      if (strchr (entry->d_name, '\n') != NULL)
+	mtime = 0;
+
+      if (S_ISREG (buffer.st_mode) && IsNewlibFootprint (entry->d_name))
+	g_ptr_array_add (files, strdup (entry->d_name));
+      else if (S_ISDIR (buffer.st_mode) && job->recursive)
+	{
+	  path = Concat (job->path, PCB_DIR_SEPARATOR_S, entry->d_name, NULL);
+	  /* the records are keyed by the resolved path */
+	  if (!fstatat (fd, entry->d_name, &buffer, AT_SYMLINK_NOFOLLOW)
+	      && S_ISLNK (buffer.st_mode))
+	    {
+	      char *real = realpath (path, NULL);
+
+	      free (path);
+	      if ((path = real) == NULL)
+		continue;
+	    }
+	  g_ptr_array_add (subdirs, path);
+	}
+    }
+  if (dirobj != NULL)
+    closedir (dirobj);
+  else if (fd >= 0)
+    close (fd);
+
+  /* A directory changed in the same second as the scan may change
+     again without a new mtime, so it is rescanned next time. */
+  if (error != 0 || mtime >= library_index_time - 1)
+    mtime = 0;
+
+  g_mutex_lock (&library_lock);
+  dir = NewLibraryIndexDir (job->path, mtime, job->recursive);
+  dir->error = error;
+  g_ptr_array_free (dir->files, TRUE);
+  g_ptr_array_free (dir->subdirs, TRUE);
+  dir->files = files;
+  dir->subdirs = subdirs;
+  files = subdirs = NULL;
+  library_index_changed = true;
+  for (i = 0; i < dir->subdirs->len; i++)
+    QueueLibraryDir (g_ptr_array_index (dir->subdirs, i), true);
+  g_mutex_unlock (&library_lock);
+
+done:
+  if (files != NULL)
+    {
+      g_ptr_array_free (files, TRUE);
+      g_ptr_array_free (subdirs, TRUE);
+    }
+  free (job->path);
+  free (job);
+
+  g_mutex_lock (&library_lock);
+  if (--library_pending == 0)
+    {
+      /* nothing else touches the index now */
+      WriteLibraryIndex ();
+      g_cond_broadcast (&library_done);
+    }
+  g_mutex_unlock (&library_lock);
+}
+
+/*!
+ * \brief Adds an indexed directory and its subdirectories to the
+ * library.
+ */
+static int
+AddLibraryDir (const char *Path, const char *TopPath, bool Recursive)
+{
+  LibraryIndexDir *dir;
+  LibraryMenuType *menu;
+  int n_footprints;
+  guint i;
+
+  dir = (LibraryIndexDir *) g_hash_table_lookup (library_index, Path);
+  if (dir == NULL)
+    return 0;
+  if (dir->error != 0)
+    {
+      errno = dir->error;
+      OpendirErrorMessage ((char *) Path);
+      return 0;
+    }
+
+  menu = GetLibraryMenuMemory (&Library);
+  menu->Name = strdup (Path);
+  menu->directory = strdup (TopPath);
+  for (i = 0; i < dir->files->len; i++)
+    AddNewlibEntry (menu, Path, g_ptr_array_index (dir->files, i));
+  n_footprints = dir->files->len;
+  for (i = 0; Recursive && i < dir->subdirs->len; i++)
+    n_footprints += AddLibraryDir (g_ptr_array_index (dir->subdirs, i),
+				   TopPath, true);
+  return n_footprints;
+}
+
+/*!
+ * \brief Starts scanning the directories in Settings.LibraryTree in the
+ * background.
+ *
+ * The footprints are added to the library by WaitForLibrary(), when
+ * something needs them.
+ *
+ * \return 0, no footprints are loaded yet.
+ */
+static int
+ParseLibraryTree (void)
+{
+  char *libpaths;                  /* String holding list of library paths to search */
+  char *p;                         /* Helper string used in iteration */
+  bool is_abs;                     /* If we are processing an absolute path */
+
+  WaitForLibrary ();
+  ReadLibraryIndex ();
+  library_tops = g_ptr_array_new ();
+  library_pool = g_thread_pool_new (ScanLibraryDir, NULL,
+				    LIBRARY_SCAN_THREADS, FALSE, NULL);
+
+  libpaths = strdup (Settings.LibraryTree);
+  g_mutex_lock (&library_lock);
+  for (p = strtok (libpaths, PCB_PATH_DELIMETER); p && *p; p = strtok (NULL, PCB_PATH_DELIMETER))
+    {
+      LibraryScanType *top;
+      char *toppath = realpath (p, NULL);
+
+      if (toppath == NULL)
+	{
+	  ChdirErrorMessage (p);
+	  continue;
+	}
+
+      /* Don't recurse into relatively-specified directories--we might
+         be in the user's working directory, and the path might be "." */
+      is_abs = (*p == PCB_DIR_SEPARATOR_C);
+
+      top = (LibraryScanType *) malloc (sizeof (*top));
+      top->path = toppath;
+      top->recursive = is_abs;
+      g_ptr_array_add (library_tops, top);
+      QueueLibraryDir (toppath, is_abs);
+    }
+  if (library_pending == 0)
+    WriteLibraryIndex ();
+  g_mutex_unlock (&library_lock);
+
+  free (libpaths);
+  return 0;
+}
+
+#endif /* LIBRARY_THREADS */
+
+/*!
+ * \brief Waits for the background scan of the newlib library and adds
+ * its footprints to the library.
+ *
+ * Call it before looking at the library.  It returns at once if no
+ * scan is running.
+ *
+ * \return true if footprints were added.
+ */
+bool
+WaitForLibrary (void)
+{
+#ifdef LIBRARY_THREADS
+  int n_footprints = 0;
+  guint i;
+
+  if (library_pool == NULL)
+    return false;
+
+  g_mutex_lock (&library_lock);
+  while (library_pending > 0)
+    g_cond_wait (&library_done, &library_lock);
+  g_mutex_unlock (&library_lock);
+  g_thread_pool_free (library_pool, FALSE, TRUE);
+  library_pool = NULL;
+
+  for (i = 0; i < library_tops->len; i++)
+    {
+      LibraryScanType *top =
+	(LibraryScanType *) g_ptr_array_index (library_tops, i);
+
+      n_footprints += AddLibraryDir (top->path, top->path, top->recursive);
+      free (top->path);
+      free (top);
+    }
+  g_ptr_array_free (library_tops, TRUE);
+  library_tops = NULL;
+  FreeLibraryIndex ();
+
+  if (n_footprints == 0)
+    return false;
+  sort_library (&Library);
+  clear_footprint_hash ();
+  hid_action ("LibraryChanged");
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifndef LIBRARY_THREADS
+
 /*!
  * \brief Parse the directory tree where newlib footprints are found.
  *
@@ -1170,9 +2379,9 @@ LoadNewlibFootprintsFromDir(char *libpath, char *toppath, bool recursive)
   struct dirent *subdirentry;     /* Individual subdir entry */
   struct stat buffer;             /* Buffer used in stat */
   LibraryMenuType *menu = NULL; /* Pointer to PCB's library menu structure */
-  LibraryEntryType *entry;      /* Pointer to individual menu entry */
-  size_t l;
-  size_t len;
+  LibraryIndexDir *dir;           /* Index record of this subdir */
+  time_t mtime;
+  guint i;
   int n_footprints = 0;           /* Running count of footprints found in this subdir */
 
   /* Cache old dir, then cd into subdir because stat is given relative file names. */
@@ -1204,10 +2413,37 @@ LoadNewlibFootprintsFromDir(char *libpath, char *toppath, bool recursive)
       return 0;
     }
 
+  /* If the index is up to date, take the directory contents from it */
+  mtime = stat (subdir, &buffer) ? 0 : buffer.st_mtime;
+  if ((dir = LookupLibraryIndex (subdir, mtime, recursive)) != NULL)
+    {
+      menu = GetLibraryMenuMemory (&Library);
+      menu->Name = strdup (subdir);
+      menu->directory = strdup (toppath);
+      for (i = 0; i < dir->files->len; i++)
+	AddNewlibEntry (menu, subdir, g_ptr_array_index (dir->files, i));
+      n_footprints = dir->files->len;
+      for (i = 0; recursive && i < dir->subdirs->len; i++)
+	n_footprints +=
+	  LoadNewlibFootprintsFromDir (g_ptr_array_index (dir->subdirs, i),
+				       toppath, true);
+      if (chdir (olddir))
+	ChdirErrorMessage (olddir);
+      return n_footprints;
+    }
+
+  /* A directory changed in the same second as the scan may change
+     again without a new mtime, so it is rescanned next time. */
+  if (mtime >= library_index_time - 1)
+    mtime = 0;
+  dir = NewLibraryIndexDir (subdir, mtime, recursive);
+  library_index_changed = true;
+
   /* First try opening the directory specified by path */
   if ( (subdirobj = opendir (subdir)) == NULL )
     {
       OpendirErrorMessage (subdir);
+      dir->mtime = 0;
       if (chdir (olddir))
         ChdirErrorMessage (olddir);
       return 0;
@@ -1228,46 +2464,19 @@ LoadNewlibFootprintsFromDir(char *libpath, char *toppath, bool recursive)
 /*    printf("...  Examining file %s ... \n", subdirentry->d_name); */
 #endif
 
-    /* Ignore non-footprint files found in this directory
-     * We're skipping .png and .html because those
-     * may exist in a library tree to provide an html browsable
-     * index of the library.
-     */
-    l = strlen (subdirentry->d_name);
-    if (!stat (subdirentry->d_name, &buffer) && S_ISREG (buffer.st_mode)
-      && subdirentry->d_name[0] != '.'
-      && NSTRCMP (subdirentry->d_name, "CVS") != 0
-      && NSTRCMP (subdirentry->d_name, "Makefile") != 0
-      && NSTRCMP (subdirentry->d_name, "Makefile.am") != 0
-      && NSTRCMP (subdirentry->d_name, "Makefile.in") != 0
-      && (l < 4 || NSTRCMP(subdirentry->d_name + (l - 4), ".png") != 0) 
-      && (l < 5 || NSTRCMP(subdirentry->d_name + (l - 5), ".html") != 0)
-      && (l < 4 || NSTRCMP(subdirentry->d_name + (l - 4), ".pcb") != 0) )
+    /* Ignore non-footprint files found in this directory */
+    if (IsNewlibFootprint (subdirentry->d_name)
+      && !stat (subdirentry->d_name, &buffer) && S_ISREG (buffer.st_mode))
       {
 #ifdef DEBUG_FILE_C
 /*	printf("...  Found a footprint %s ... \n", subdirentry->d_name); */
 #endif
 	n_footprints++;
-	entry = GetLibraryEntryMemory (menu);
-
-	/* 
-	 * entry->AllocatedMemory points to abs path to the footprint.
-	 * entry->ListEntry points to fp name itself.
-	 */
-	len = strlen(subdir) + strlen("/") + strlen(subdirentry->d_name) + 1;
-	entry->AllocatedMemory = (char *)calloc (1, len);
-	strcat (entry->AllocatedMemory, subdir);
-	strcat (entry->AllocatedMemory, PCB_DIR_SEPARATOR_S);
-
-	/* store pointer to start of footprint name */
-	entry->ListEntry = entry->AllocatedMemory
-	    + strlen (entry->AllocatedMemory);
-
-	/* Now place footprint name into AllocatedMemory */
-	strcat (entry->AllocatedMemory, subdirentry->d_name);
-
-	/* mark as directory tree (newlib) library */
-	entry->Template = (char *) -1;
+	AddNewlibEntry (menu, subdir, subdirentry->d_name);
+	/* the index has a line per name */
+	if (strchr (subdirentry->d_name, '\n') != NULL)
+	  dir->mtime = 0;
+	g_ptr_array_add (dir->files, strdup (subdirentry->d_name));
       }
   }
   closedir (subdirobj);
@@ -1284,6 +2493,7 @@ LoadNewlibFootprintsFromDir(char *libpath, char *toppath, bool recursive)
   if ((subdirobj = opendir (subdir)) == NULL)
     {
       OpendirErrorMessage (subdir);
+      dir->mtime = 0;
       if (chdir (olddir))
         ChdirErrorMessage (olddir);
       return 0;
@@ -1314,6 +2524,7 @@ LoadNewlibFootprintsFromDir(char *libpath, char *toppath, bool recursive)
 	    {
 	      fprintf (stderr, "LoadNewlibFootprintsFromDir():  "
 			       "malloc failed\n");
+	      dir->mtime = 0;
 	      closedir (subdirobj);
 	      if (chdir (olddir))
 		ChdirErrorMessage (olddir);
@@ -1323,6 +2534,9 @@ LoadNewlibFootprintsFromDir(char *libpath, char *toppath, bool recursive)
 	  strcat (subdir_path, PCB_DIR_SEPARATOR_S);
 	  strcat (subdir_path, subdirentry->d_name);
 
+	  if (strchr (subdirentry->d_name, '\n') != NULL)
+	    dir->mtime = 0;
+	  g_ptr_array_add (dir->subdirs, strdup (subdir_path));
 	  n_footprints += LoadNewlibFootprintsFromDir(subdir_path, toppath, true);
 	  free(subdir_path);
 	}
@@ -1365,6 +2579,8 @@ ParseLibraryTree (void)
       return 0;
     }
 
+  ReadLibraryIndex ();
+
   /* Additional loop to allow for multiple 'newlib' style library directories 
    * called out in Settings.LibraryTree
    */
@@ -1381,6 +2597,8 @@ ParseLibraryTree (void)
         {
           ChdirErrorMessage (working);
           free (libpaths);
+          WriteLibraryIndex ();
+          FreeLibraryIndex ();
           return 0;
         }
 
@@ -1427,10 +2645,14 @@ ParseLibraryTree (void)
   printf("Leaving ParseLibraryTree, found %d footprints.\n", n_footprints);
 #endif
 
+  WriteLibraryIndex ();
+  FreeLibraryIndex ();
   free (libpaths);
   return n_footprints;
 }
 
+#endif /* !LIBRARY_THREADS */
+
 /*!
  * \brief Read contents of the library description file (for M4)
  * and then read in M4 libs.
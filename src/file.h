@@ -47,9 +47,15 @@ void SaveInTMP (void);
 void EmergencySave (void);
 void DisableEmergencySave (void);
 int ReadLibraryContents (void);
+bool WaitForLibrary (void);
 int ImportNetlist (char *);
 int SaveBufferElements (char *);
 void sort_netlist (void);
+void WritePCBData (FILE *);
+bool IsCompressedFile (const char *);
+char *ReadCompressedFile (const char *, size_t *);
+void WritePCBObject (FILE *, int, void *);
+void WritePCBLayerHeader (FILE *, Cardinal, LayerType *);
 
 int PCBFileVersionNeeded (void);
         /*!< This is the version needed by the file we're saving. */
@@ -3216,6 +3216,42 @@ RatFindHook (int type, void *ptr1, void *ptr2, void *ptr3,
   UnlockUndo();
 }
 
+/*!
+ * \brief Calls Func with the type and pointers of each object found by
+ * the last lookup.
+ *
+ * The lists are valid until the next lookup starts.
+ */
+void
+ForEachFoundObject (void (*Func) (int, void *, void *, void *), void *Data)
+{
+  Cardinal i, layer;
+
+  for (i = 0; i < PVList.Number; i++)
+    {
+      PinType *pv = PVLIST_ENTRY (i);
+
+      Func (pv->Element ? PIN_TYPE : VIA_TYPE,
+            pv->Element ? pv->Element : pv, pv, Data);
+    }
+  for (layer = 0; layer < 2; layer++)
+    for (i = 0; i < PadList[layer].Number; i++)
+      Func (PAD_TYPE, PADLIST_ENTRY (layer, i)->Element,
+            PADLIST_ENTRY (layer, i), Data);
+  for (layer = 0; layer < max_copper_layer; layer++)
+    {
+      for (i = 0; i < LineList[layer].Number; i++)
+        Func (LINE_TYPE, LAYER_PTR (layer), LINELIST_ENTRY (layer, i), Data);
+      for (i = 0; i < ArcList[layer].Number; i++)
+        Func (ARC_TYPE, LAYER_PTR (layer), ARCLIST_ENTRY (layer, i), Data);
+      for (i = 0; i < PolygonList[layer].Number; i++)
+        Func (POLYGON_TYPE, LAYER_PTR (layer),
+              POLYGONLIST_ENTRY (layer, i), Data);
+    }
+  for (i = 0; i < RatList.Number; i++)
+    Func (RATLINE_TYPE, RATLIST_ENTRY (i), RATLIST_ENTRY (i), Data);
+}
+
 /*!
  * \brief Prints all unused pins of an element to file FP.
  */
@@ -56,6 +56,7 @@ void LookupUnusedPins (FILE *);
 void InitConnectionLookup (void);
 void FreeConnectionLookupMemory (void);
 void RatFindHook (int, void *, void *, void *, bool, int flag, bool);
+void ForEachFoundObject (void (*) (int, void *, void *, void *), void *);
 void LookupConnectionByPin (int , void *);
 
 /* remove these prototypes later */
@@ -292,6 +292,7 @@ struct polygon_st
   POLYAREA *Clipped; /*!< The clipped region of this polygon. */
   PLINE *NoHoles; /*!< The polygon broken into hole-less regions */
   int NoHolesValid; /*!< Is the NoHoles polygon up to date? */
+  BoxType NoHolesDirty; /*!< Region where NoHoles is out of date. */
   PointType *Points; /*!< Data. */
   Cardinal *HoleIndex; /*!< Index of hole data within the Points array. */
   Cardinal HoleIndexN; /*!< Number of holes in polygon. */
@@ -774,6 +775,7 @@ typedef struct
   int TextScale; /*!< Text scaling in %. */
   Coord Grid; /*!< Grid in pcb-units. */
   double IsleArea; /*!< Polygon min area. */
+  Coord PolyTolerance; /*!< Max deviation of round shapes in polygons. */
   Coord PasteAdjust; /*!< Paste adjustment. */
   int PinoutNameLength, /*!< Max displayed length of a pinname. */
     Volume, /*!< The speakers volume -100 .. 100. */
@@ -781,6 +783,8 @@ typedef struct
     Mode, /*!< Currently active mode. */
     BufferNumber; /*!< Number of the current buffer. */
   int BackupInterval; /*!< Time between two backups in seconds. */
+  int JournalLimit; /*!< Journal size for a checkpoint in kB. */
+  int AutorouteJobs; /*!< Nets the autorouter routes at once. */
   char *DefaultLayerName[MAX_LAYER],
    *FontCommand, /*!< Command for font file loading. */
    *FileCommand, /*!< Command for file loading. */
@@ -790,6 +794,7 @@ typedef struct
    *LibraryCommand,
    *LibraryContentsCommand,
    *LibraryTree, /*!< Path to library tree. */
+   *LibraryIndex, /*!< Index of the library tree. */
    *SaveCommand,
    *LibraryFilename,
    *FontFile, /*!< Name of default font file. */
@@ -809,7 +814,9 @@ typedef struct
    *FabAuthor, /*!< Full name of author for FAB drawings. */
    *GnetlistProgram, /*!< gnetlist program name. */
    *MakeProgram, /*!< make program name. */
-   *InitialLayerStack; /*!< If set, the initial layer stack is set to this. */
+   *InitialLayerStack, /*!< If set, the initial layer stack is set to this. */
+   *AutorouteStats, /*!< File for the statistics of each autoroute pass. */
+   *AutorouteCheckpoint; /*!< File for the autoroute state after each pass. */
   Coord PinoutOffsetX; /*!< Offset of origin (X value). */
   Coord PinoutOffsetY; /*!< Offset of origin (Y value). */
   Coord PinoutTextOffsetX; /*!< Offset of text from pin center (X value). */
@@ -823,7 +830,10 @@ typedef struct
     ShowBottomSide, /*!< Mirror output. */
     SaveLastCommand, /*!< Save the last command entered by user. */
     SaveInTMP, /*!< Always save data in /tmp. */
+    Journal, /*!< Append changes to a journal. */
     SaveMetricOnly, /*!< Save with mm suffix only, not mil/mm hybrid. */
+    ProfileLoad, /*!< Report the phases of each load. */
+    LiveRats, /*!< Update the rats of moved elements. */
     DrawGrid, /*!< Draw grid points. */
     RatWarn, /*!< Rats nest has set warnings. */
     StipplePolygons, /*!< Draw polygons with stipple. */
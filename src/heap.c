@@ -3,6 +3,13 @@
  *
  * \brief Operations on heaps.
  *
+ * Elements inserted with heap_insert_indexed() are addressable: the
+ * heap keeps their position up to date in an int supplied by the
+ * caller, usually a field of the data itself, so that their cost can
+ * be changed with heap_change() and they can be taken out with
+ * heap_delete().  The position is 0 while the element is not in the
+ * heap.
+ *
  * This file, heap.c, was written and is
  *
  * Copyright (c) 2001 C. Scott Ananian
@@ -64,6 +71,7 @@ struct heap_element
 {
   cost_t cost;
   void *data;
+  int *index;			/* position of an addressable element */
 };
 struct heap_struct
 {
@@ -93,6 +101,9 @@ __heap_is_good_slow (heap_t * heap)
   for (i = 2; i < heap->size; i++)
     if (heap->element[i].cost < heap->element[i / 2].cost)
       return 0;
+  for (i = 1; i <= heap->size; i++)
+    if (heap->element[i].index && *heap->element[i].index != i)
+      return 0;
   return 1;
 }
 #endif /* SLOW_ASSERTIONS */
@@ -150,6 +161,8 @@ void heap_free (heap_t *heap, void (*freefunc) (void *))
   assert (__heap_is_good (heap));
   for ( ; heap->size; heap->size--)  
    {
+     if (heap->element[heap->size].index)
+       *heap->element[heap->size].index = 0;
      if (heap->element[heap->size].data)
        freefunc (heap->element[heap->size].data);
    }
@@ -157,6 +170,17 @@ void heap_free (heap_t *heap, void (*freefunc) (void *))
 
 /* -- mutation -- */
 
+/*!
+ * \brief Puts an element at position k, and tells it so.
+ */
+static inline void
+__place (heap_t * heap, int k, struct heap_element v)
+{
+  heap->element[k] = v;
+  if (v.index)
+    *v.index = k;
+}
+
 static void
 __upheap (heap_t * heap, int k)
 {
@@ -167,12 +191,24 @@ __upheap (heap_t * heap, int k)
 
   heap->element[0].cost = MIN_COST;
   for (v = heap->element[k]; heap->element[k / 2].cost > v.cost; k = k / 2)
-    heap->element[k] = heap->element[k / 2];
-  heap->element[k] = v;
+    __place (heap, k, heap->element[k / 2]);
+  __place (heap, k, v);
 }
 
 void
 heap_insert (heap_t * heap, cost_t cost, void *data)
+{
+  heap_insert_indexed (heap, cost, data, NULL);
+}
+
+/*!
+ * \brief Insert an addressable element.
+ *
+ * *index holds the position of the element until it leaves the heap,
+ * when it is set to 0.
+ */
+void
+heap_insert_indexed (heap_t * heap, cost_t cost, void *data, int *index)
 {
   assert (heap && __heap_is_good (heap));
   assert (cost >= MIN_COST);
@@ -190,6 +226,7 @@ heap_insert (heap_t * heap, cost_t cost, void *data)
   assert (heap->size < heap->max);
   heap->element[heap->size].cost = cost;
   heap->element[heap->size].data = data;
+  heap->element[heap->size].index = index;
   __upheap (heap, heap->size);	/* fix heap condition violation */
   assert (__heap_is_good (heap));
   return;
@@ -218,10 +255,10 @@ __downheap (heap_t * heap, int k)
 	j++;
       if (v.cost < heap->element[j].cost)
 	break;
-      heap->element[k] = heap->element[j];
+      __place (heap, k, heap->element[j]);
       k = j;
     }
-  heap->element[k] = v;
+  __place (heap, k, v);
 }
 
 /*!
@@ -236,6 +273,8 @@ heap_remove_smallest (heap_t * heap)
   assert (heap->max > 1);
 
   v = heap->element[1];
+  if (v.index)
+    *v.index = 0;
   heap->element[1] = heap->element[heap->size--];
   if (heap->size > 0)
     __downheap (heap, 1);
@@ -244,6 +283,95 @@ heap_remove_smallest (heap_t * heap)
   return v.data;
 }
 
+/*!
+ * \brief Change the cost of the addressable element at index.
+ */
+void
+heap_change (heap_t * heap, int index, cost_t cost)
+{
+  cost_t old;
+
+  assert (heap && __heap_is_good (heap));
+  assert (index > 0 && index <= heap->size);
+  assert (cost >= MIN_COST);
+
+  old = heap->element[index].cost;
+  heap->element[index].cost = cost;
+  if (cost < old)
+    __upheap (heap, index);
+  else
+    __downheap (heap, index);
+  assert (__heap_is_good (heap));
+}
+
+/*!
+ * \brief Remove the addressable element at index from the heap.
+ */
+void *
+heap_delete (heap_t * heap, int index)
+{
+  struct heap_element v;
+
+  assert (heap && __heap_is_good (heap));
+  assert (index > 0 && index <= heap->size);
+
+  v = heap->element[index];
+  if (v.index)
+    *v.index = 0;
+  if (index < heap->size)
+    {
+      cost_t cost = heap->element[heap->size].cost;
+
+      heap->element[index] = heap->element[heap->size--];
+      if (cost < v.cost)
+	__upheap (heap, index);
+      else
+	__downheap (heap, index);
+    }
+  else
+    heap->size--;
+
+  assert (__heap_is_good (heap));
+  return v.data;
+}
+
+/*!
+ * \brief Free all elements costing at least cost.
+ *
+ * This is done in one pass over the heap, which is then rebuilt from
+ * the bottom up.
+ */
+void
+heap_prune (heap_t * heap, cost_t cost, void (*freefunc) (void *))
+{
+  int i, size = 0;
+
+  assert (heap && __heap_is_good (heap));
+
+  for (i = 1; i <= heap->size; i++)
+    {
+      struct heap_element v = heap->element[i];
+
+      if (v.cost < cost)
+	heap->element[++size] = v;
+      else
+	{
+	  if (v.index)
+	    *v.index = 0;
+	  if (v.data)
+	    freefunc (v.data);
+	}
+    }
+  heap->size = size;
+  for (i = size / 2; i > 0; i--)
+    __downheap (heap, i);
+  for (i = 1; i <= size; i++)
+    if (heap->element[i].index)
+      *heap->element[i].index = i;
+
+  assert (__heap_is_good (heap));
+}
+
 /*!
  * \brief Replace the smallest item with a new item and return the
  * smallest item.
@@ -263,6 +391,7 @@ heap_replace (heap_t * heap, cost_t cost, void *data)
 
   heap->element[0].cost = cost;
   heap->element[0].data = data;
+  heap->element[0].index = NULL;
   __downheap (heap, 0);		/* ooh, tricky! */
 
   assert (__heap_is_good (heap));
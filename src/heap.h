@@ -58,6 +58,13 @@ void heap_free (heap_t * heap, void (*funcfree) (void *));
 void heap_insert (heap_t * heap, cost_t cost, void *data);
 void *heap_remove_smallest (heap_t * heap);
 void *heap_replace (heap_t * heap, cost_t cost, void *data);
+void heap_prune (heap_t * heap, cost_t cost, void (*freefunc) (void *));
+
+/* -- addressable elements -- */
+void heap_insert_indexed (heap_t * heap, cost_t cost, void *data,
+			  int *index);
+void heap_change (heap_t * heap, int index, cost_t cost);
+void *heap_delete (heap_t * heap, int index);
 
 /* -- interrogation -- */
 int heap_is_empty (heap_t * heap);
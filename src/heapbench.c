@@ -0,0 +1,299 @@
+/*!
+ * \file src/heapbench.c
+ *
+ * \brief Micro-benchmarks for the heap.
+ *
+ * Three workloads are timed:
+ *
+ * - filling the heap with random costs and draining it again;
+ *
+ * - a shortest path search on a grid with random edge costs, the way
+ *   the autorouter's best-first search uses its work heap: once with the
+ *   plain heap, pushing an element again whenever a node gets cheaper
+ *   and skipping the stale ones when they come out, and once with the
+ *   addressable elements and heap_change();
+ *
+ * - deleting random addressable elements with heap_delete() before
+ *   draining the rest.
+ *
+ * Each workload checks its results: the heap must come out in order,
+ * and both searches must find the same distances.  The program is built
+ * by "make check" as "heapbench":
+ *
+ * \code
+ * ./heapbench [-n grid size] [-s seed]
+ * \endcode
+ *
+ * "make check" also runs it as a test, on the small grid given by the
+ * HEAPBENCH_GRID environment variable so that it stays quick.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "global.h"
+#include "heap.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+/* Default width and height of the search grid. */
+#define BENCH_DEFAULT_GRID 400
+
+typedef struct
+{
+  cost_t dist;
+  int heap_index;
+  bool done;
+} BenchNode;
+
+static unsigned long long bench_seed;
+
+/*!
+ * \brief Pseudo random number in [0, range), see polybench.c.
+ */
+static unsigned
+bench_random (unsigned range)
+{
+  bench_seed = bench_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return range ? (unsigned) ((bench_seed >> 33) % range) : 0;
+}
+
+static void
+bench_line (const char *what, double seconds, long pushes, int max_size)
+{
+  printf ("%-28s %9.1f ms %10ld pushes %9d max size\n",
+	  what, seconds * 1000, pushes, max_size);
+}
+
+/*!
+ * \brief Fill the heap with n random costs and drain it.
+ *
+ * \return false if the costs came out of order.
+ */
+static bool
+bench_fill (int n)
+{
+  heap_t *heap = heap_create ();
+  GTimer *timer = g_timer_new ();
+  cost_t last = -1;
+  bool good = true;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      cost_t *cost = (cost_t *) malloc (sizeof (cost_t));
+
+      *cost = bench_random (1000000);
+      heap_insert (heap, *cost, cost);
+    }
+  while (!heap_is_empty (heap))
+    {
+      cost_t *cost = (cost_t *) heap_remove_smallest (heap);
+
+      if (*cost < last)
+	good = false;
+      last = *cost;
+      free (cost);
+    }
+  bench_line ("fill and drain", g_timer_elapsed (timer, NULL), n, n);
+  g_timer_destroy (timer);
+  heap_destroy (&heap);
+  return good;
+}
+
+/*!
+ * \brief Shortest paths from a corner of a size by size grid.
+ *
+ * Each node has a random cost for the step to each of its neighbours,
+ * derived from the seed, so both searches see the same grid.
+ */
+static void
+bench_search (int size, unsigned long long seed, bool indexed,
+	      BenchNode * node)
+{
+  static const int dx[] = { 1, -1, 0, 0 }, dy[] = { 0, 0, 1, -1 };
+  heap_t *heap = heap_create ();
+  GTimer *timer = g_timer_new ();
+  unsigned *step;
+  long pushes = 1;
+  int max_size = 1;
+  int i;
+
+  bench_seed = seed;
+  step = (unsigned *) malloc (4 * size * size * sizeof (unsigned));
+  for (i = 0; i < 4 * size * size; i++)
+    step[i] = 1 + bench_random (100);
+  for (i = 0; i < size * size; i++)
+    {
+      node[i].dist = -1;
+      node[i].heap_index = 0;
+      node[i].done = false;
+    }
+
+  node[0].dist = 0;
+  g_timer_start (timer);
+  if (indexed)
+    heap_insert_indexed (heap, 0, &node[0], &node[0].heap_index);
+  else
+    heap_insert (heap, 0, &node[0]);
+  while (!heap_is_empty (heap))
+    {
+      BenchNode *n = (BenchNode *) heap_remove_smallest (heap);
+      int k = n - node, x = k % size, y = k / size, d;
+
+      /* a stale copy of a node which got cheaper since */
+      if (n->done)
+	continue;
+      n->done = true;
+      for (d = 0; d < 4; d++)
+	{
+	  int nx = x + dx[d], ny = y + dy[d];
+	  BenchNode *m;
+	  cost_t dist;
+
+	  if (nx < 0 || ny < 0 || nx >= size || ny >= size)
+	    continue;
+	  m = &node[ny * size + nx];
+	  dist = n->dist + step[4 * k + d];
+	  if (m->done || (m->dist >= 0 && m->dist <= dist))
+	    continue;
+	  if (indexed && m->heap_index)
+	    heap_change (heap, m->heap_index, dist);
+	  else
+	    {
+	      if (indexed)
+		heap_insert_indexed (heap, dist, m, &m->heap_index);
+	      else
+		heap_insert (heap, dist, m);
+	      pushes++;
+	    }
+	  m->dist = dist;
+	  max_size = MAX (max_size, heap_size (heap));
+	}
+    }
+  bench_line (indexed ? "search, decrease-key" : "search, plain heap",
+	      g_timer_elapsed (timer, NULL), pushes, max_size);
+  g_timer_destroy (timer);
+  free (step);
+  heap_destroy (&heap);
+}
+
+/*!
+ * \brief Insert n addressable elements, delete every third at random
+ * and drain the rest.
+ *
+ * \return false if the heap lost track of an element.
+ */
+static bool
+bench_delete (int n)
+{
+  heap_t *heap = heap_create ();
+  BenchNode *node = (BenchNode *) calloc (n, sizeof (BenchNode));
+  GTimer *timer = g_timer_new ();
+  cost_t last = -1;
+  bool good = true;
+  int i, left = n;
+
+  for (i = 0; i < n; i++)
+    {
+      node[i].dist = bench_random (1000000);
+      heap_insert_indexed (heap, node[i].dist, &node[i], &node[i].heap_index);
+    }
+  for (i = 0; i < n / 3; i++)
+    {
+      BenchNode *d = &node[bench_random (n)];
+
+      if (d->heap_index == 0)
+	continue;
+      if (heap_delete (heap, d->heap_index) != d || d->heap_index != 0)
+	good = false;
+      left--;
+    }
+  while (!heap_is_empty (heap))
+    {
+      BenchNode *d = (BenchNode *) heap_remove_smallest (heap);
+
+      if (d->dist < last || d->heap_index != 0)
+	good = false;
+      last = d->dist;
+      left--;
+    }
+  bench_line ("delete and drain", g_timer_elapsed (timer, NULL), n, n);
+  g_timer_destroy (timer);
+  heap_destroy (&heap);
+  free (node);
+  return good && left == 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int size = BENCH_DEFAULT_GRID;
+  unsigned long long seed = 1;
+  BenchNode *plain, *indexed;
+  bool good = true;
+  char *grid;
+  int i;
+
+  if ((grid = getenv ("HEAPBENCH_GRID")) != NULL && *grid)
+    size = atoi (grid);
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp (argv[i], "-n") == 0 && i + 1 < argc)
+	size = atoi (argv[++i]);
+      else if (strcmp (argv[i], "-s") == 0 && i + 1 < argc)
+	seed = strtoull (argv[++i], NULL, 10);
+      else
+	{
+	  fprintf (stderr, "usage: %s [-n grid size] [-s seed]\n", argv[0]);
+	  return 2;
+	}
+    }
+  if (size < 1)
+    size = 1;
+
+  bench_seed = seed;
+  good = bench_fill (size * size) && good;
+  plain = (BenchNode *) malloc (size * size * sizeof (BenchNode));
+  indexed = (BenchNode *) malloc (size * size * sizeof (BenchNode));
+  bench_search (size, seed, false, plain);
+  bench_search (size, seed, true, indexed);
+  for (i = 0; i < size * size; i++)
+    if (plain[i].dist != indexed[i].dist)
+      good = false;
+  free (plain);
+  free (indexed);
+  bench_seed = seed;
+  good = bench_delete (size * size) && good;
+
+  if (!good)
+    fprintf (stderr, "%s: wrong results\n", argv[0]);
+  return good ? 0 : 1;
+}
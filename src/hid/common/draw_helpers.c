@@ -200,6 +200,19 @@ fill_clipped_contour (hidGC gc, PLINE *pl, const BoxType *clip_box)
   POLYAREA *draw_piece;
   int x;
 
+  /* Pieces entirely inside or outside the clip box, which is all of
+   * them when exporting, don't need the boolean operation.
+   */
+  if (pl->xmin >= clip_box->X1 && pl->xmax <= clip_box->X2 &&
+      pl->ymin >= clip_box->Y1 && pl->ymax <= clip_box->Y2)
+    {
+      fill_contour (gc, pl);
+      return;
+    }
+  if (pl->xmin >= clip_box->X2 || pl->xmax <= clip_box->X1 ||
+      pl->ymin >= clip_box->Y2 || pl->ymax <= clip_box->Y1)
+    return;
+
   clip_poly = RectPoly (clip_box->X1, clip_box->X2,
                         clip_box->Y1, clip_box->Y2);
   poly_CopyContour (&pl_copy, pl);
@@ -285,6 +298,9 @@ common_fill_pcb_polygon (hidGC gc, PolygonType *poly, const BoxType *clip_box)
   if (poly->Clipped == NULL)
     return;
 
+  /* Only the pieces near recent changes need dicing again */
+  if (poly->NoHolesValid && NOHOLES_DIRTY (poly))
+    ComputeNoHoles (poly);
   if (!poly->NoHolesValid)
     {
       /* If enough of the polygon is on-screen, compute the entire
@@ -14,6 +14,7 @@
 #include "action.h"
 #include "crosshair.h"
 #include "error.h"
+#include "mymem.h"
 #include "../hidint.h"
 #include "gui.h"
 #include "hid/common/hidnogui.h"
@@ -1038,9 +1039,9 @@ ghid_attributes (char *owner, AttributeListType *attrs)
 	  for (i=0; i<attributes_list->Number; i++)
 	    {
 	      if (attributes_list->List[i].name)
-		free (attributes_list->List[i].name);
+		ReleaseString (attributes_list->List[i].name);
 	      if (attributes_list->List[i].value)
-		free (attributes_list->List[i].value);
+		ReleaseString (attributes_list->List[i].value);
 	    }
 	  if (attributes_list->Max < attr_num_rows)
 	    {
@@ -1053,8 +1054,8 @@ ghid_attributes (char *owner, AttributeListType *attrs)
 	    }
 	  for (i=0; i<attr_num_rows; i++)
 	    {
-	      attributes_list->List[i].name = strdup (gtk_entry_get_text (GTK_ENTRY (attr_row[i].w_name)));
-	      attributes_list->List[i].value = strdup (gtk_entry_get_text (GTK_ENTRY (attr_row[i].w_value)));
+	      attributes_list->List[i].name = InternString (gtk_entry_get_text (GTK_ENTRY (attr_row[i].w_name)));
+	      attributes_list->List[i].value = InternString (gtk_entry_get_text (GTK_ENTRY (attr_row[i].w_value)));
 	      attributes_list->Number = attr_num_rows;
 	    }
 
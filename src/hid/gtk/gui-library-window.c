@@ -60,6 +60,7 @@
 #include "global.h"
 #include "buffer.h"
 #include "data.h"
+#include "file.h"
 #include "set.h"
 
 #include <gdk/gdkkeysyms.h>
@@ -204,6 +205,8 @@ ghid_library_window_create (GHidPort * out)
 void
 ghid_library_window_show (GHidPort * out, gboolean raise)
 {
+  /* the window is built once, from the whole library */
+  WaitForLibrary ();
   ghid_library_window_create (out);
   gtk_widget_show_all (library_window);
   if (raise)
@@ -14,6 +14,7 @@
 #include "data.h"
 #include "crosshair.h"
 #include "misc.h"
+#include "mymem.h"
 #include "pcb-printf.h"
 
 #include "hid.h"
@@ -1994,9 +1995,9 @@ lesstif_attributes_dialog (char *owner, AttributeListType *attrs_list)
       for (i=0; i<attributes_list->Number; i++)
 	{
 	  if (attributes_list->List[i].name)
-	    free (attributes_list->List[i].name);
+	    ReleaseString (attributes_list->List[i].name);
 	  if (attributes_list->List[i].value)
-	    free (attributes_list->List[i].value);
+	    ReleaseString (attributes_list->List[i].value);
 	}
       if (attributes_list->Max < attr_num_rows)
 	{
@@ -2009,8 +2010,8 @@ lesstif_attributes_dialog (char *owner, AttributeListType *attrs_list)
 	}
       for (i=0; i<attr_num_rows; i++)
 	{
-	  attributes_list->List[i].name = strdup (XmTextFieldGetString (attr_row[i].w_name));
-	  attributes_list->List[i].value = strdup (XmTextFieldGetString (attr_row[i].w_value));
+	  attributes_list->List[i].name = InternString (XmTextFieldGetString (attr_row[i].w_name));
+	  attributes_list->List[i].value = InternString (XmTextFieldGetString (attr_row[i].w_value));
 	  attributes_list->Number = attr_num_rows;
 	}
     }
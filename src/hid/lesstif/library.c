@@ -12,6 +12,7 @@
 #include "compat.h"
 #include "global.h"
 #include "data.h"
+#include "file.h"
 #include "misc.h"
 #include "set.h"
 #include "buffer.h"
@@ -163,6 +164,7 @@ static const char libraryshow_help[] =
 static int
 LibraryShow (int argc, char **argv, Coord x, Coord y)
 {
+  WaitForLibrary ();
   if (build_library_dialog ())
     return 0;
   return 0;
@@ -173,6 +175,7 @@ lesstif_show_library ()
 {
   if (mainwind)
     {
+      WaitForLibrary ();
       if (!library_dialog)
 	LibraryChanged (0, 0, 0, 0);
       XtManageChild (library_dialog);
@@ -42,6 +42,7 @@
 #include "data.h"
 #include "draw.h"
 #include "insert.h"
+#include "journal.h"
 #include "line.h"
 #include "misc.h"
 #include "move.h"
@@ -178,8 +179,10 @@ InsertPointIntoPolygon (LayerType *Layer, PolygonType *Polygon)
 	return (NULL);
     }
   /*
-   * second, shift the points up to make room for the new point
+   * second, shift the points up to make room for the new point; the
+   * undo entry needs the new point, so the journal is told first
    */
+  JournalTouch (UNDO_INSERT_POINT, POLYGON_TYPE, Layer, Polygon, Polygon);
   ErasePolygon (Polygon);
   r_delete_entry (Layer->polygon_tree, (BoxType *) Polygon);
   save = *CreateNewPointInPolygon (Polygon, InsertX, InsertY);
@@ -0,0 +1,974 @@
+/*!
+ * \file src/journal.c
+ *
+ * \brief Append-only change journal.
+ *
+ * With the journal setting on, every change which goes through the
+ * undo system is appended to \<layout\>.journal as soon as it is
+ * finished.  Each record is the complete text of one object, as
+ * WritePCB() would write it, before ("-") or after ("+") the change;
+ * a record for a layer object carries the Layer() line of its layer.
+ * The records of one undo serial number are followed by a "Commit"
+ * line:
+ *
+ * <pre>
+ * # PCB change journal
+ * Journal[1 \<size\> \<mtime\>]
+ * -Layer(1 "top" "copper")
+ * 	Line[1000 1000 2000 1000 1000 2000 "clearline"]
+ * .
+ * +Layer(1 "top" "copper")
+ * 	Line[1000 1000 3000 1000 1000 2000 "clearline"]
+ * .
+ * Commit
+ * </pre>
+ *
+ * The numbers in the header are the size and modification time of the
+ * layout file the journal applies to.  Once the journal grows past the
+ * journal-limit, or after a change to the layer stack or the netlist,
+ * the whole layout is written into a fresh journal as a "Checkpoint",
+ * and the following records apply to that.  Saving the layout deletes
+ * the journal.
+ *
+ * Changes are found through the undo system: each object handed to it
+ * is noted together with its text from before the change, and at the
+ * end of the operation only those objects are formatted again and
+ * compared.  So a journal write costs as much as the change, not as
+ * much as the board, and nothing is kept for the objects which did not
+ * change.  A record which replaces an object is put back where the old
+ * one was, so a replayed layout keeps the order of its objects.
+ *
+ * If a journal is found when a layout is loaded, it was left behind by
+ * a session which did not save.  Journal(Replay) applies its complete
+ * commits to the layout and loads the result; Journal(Discard) deletes
+ * it.
+ *
+ * Changes which bypass the undo system, like renaming a layer or
+ * editing attributes, are not journaled.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "global.h"
+
+#include "data.h"
+#include "error.h"
+#include "file.h"
+#include "journal.h"
+#include "misc.h"
+#include "pcb-printf.h"
+#include "set.h"
+#include "rtree.h"
+#include "snapshot.h"
+#include "undo.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#define JOURNAL_VERSION 1
+
+/*!
+ * \brief Element parts which are changed through their own IDs.
+ */
+#define ELEMENT_PART_TYPES (PIN_TYPE | PAD_TYPE | ELEMENTNAME_TYPE | \
+			    ELEMENTLINE_TYPE | ELEMENTARC_TYPE)
+
+/*!
+ * \brief Elements without parts are not written to the layout file.
+ */
+#define EMPTY_ELEMENT(e) (!(e)->LineN && !(e)->PinN && !(e)->ArcN && !(e)->PadN)
+
+/*!
+ * \brief An object changed by the current operation.
+ */
+typedef struct
+{
+  int type;			/*!< VIA_TYPE, ELEMENT_TYPE, LINE_TYPE, ... */
+  void *ptr;			/*!< The object. */
+  int layer;			/*!< Its layer number before, or -1. */
+  char *text;			/*!< Its text before, or NULL if it was not
+				   on the board. */
+} JournalObjectType;
+
+static struct
+{
+  bool active;			/*!< Changes are being journaled. */
+  bool suspended;		/*!< An old journal waits for replay. */
+  bool checkpoint;		/*!< The next commit writes a checkpoint. */
+  PCBType *pcb;			/*!< The board the journal belongs to. */
+  char *board;			/*!< Its file name. */
+  char *filename;		/*!< The journal. */
+  FILE *fp;			/*!< The journal, opened for appending. */
+  long size;			/*!< Size of the layout file. */
+  long mtime;			/*!< Its modification time. */
+  long written;			/*!< Bytes since the last checkpoint. */
+  GHashTable *touched;		/*!< Objects changed since the last commit. */
+  GPtrArray *order;		/*!< The same, in the order of the changes. */
+} journal;
+
+static bool replaying = false;
+
+static void
+free_object (gpointer data)
+{
+  JournalObjectType *object = data;
+
+  free (object->text);
+  free (object);
+}
+
+/*!
+ * \brief Returns the text WritePCBObject() writes for an object.
+ *
+ * With Type NO_TYPE, this is the text of the whole layout; with a
+ * negative Type, the Layer() line of layer Number.
+ */
+static char *
+format_text (int Type, void *Ptr, int Number)
+{
+  int old_mask = set_allow_readable (0);
+  char *text = NULL;
+  FILE *fp;
+#ifdef HAVE_OPEN_MEMSTREAM
+  size_t size;
+
+  fp = open_memstream (&text, &size);
+#else
+  long size;
+
+  fp = tmpfile ();
+#endif
+  if (fp == NULL)
+    return strdup ("");
+
+  if (Settings.SaveMetricOnly)
+    set_allow_readable (ALLOW_MM);
+  else
+    set_allow_readable (ALLOW_READABLE);
+  if (Type == NO_TYPE)
+    WritePCBData (fp);
+  else if (Type < 0)
+    WritePCBLayerHeader (fp, Number, &PCB->Data->Layer[Number]);
+  else
+    WritePCBObject (fp, Type, Ptr);
+  set_allow_readable (old_mask);
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  fclose (fp);
+#else
+  size = ftell (fp);
+  text = (char *)malloc (size + 1);
+  rewind (fp);
+  size = fread (text, 1, size, fp);
+  text[size] = '\0';
+  fclose (fp);
+#endif
+  return text;
+}
+
+/*!
+ * \brief Forgets the objects changed since the last commit.
+ */
+static void
+forget_touched (void)
+{
+  if (journal.touched == NULL)
+    {
+      journal.touched = g_hash_table_new (NULL, NULL);
+      journal.order = g_ptr_array_new ();
+    }
+  g_hash_table_remove_all (journal.touched);
+  g_ptr_array_foreach (journal.order, (GFunc) free_object, NULL);
+  g_ptr_array_set_size (journal.order, 0);
+  journal.checkpoint = false;
+}
+
+static int
+same_object_cb (const BoxType *b, void *cl)
+{
+  return (void *) b == cl;
+}
+
+/*!
+ * \brief Tells whether an object is in Tree.
+ *
+ * Looking it up over its own bounding box costs a tree search, so a
+ * commit does not have to walk the board.
+ */
+static bool
+in_tree (rtree_t *Tree, void *Ptr)
+{
+  return Tree != NULL
+    && r_search (Tree, (BoxType *) Ptr, NULL, same_object_cb, Ptr) > 0;
+}
+
+/*!
+ * \brief Tells whether an object is on the board, and on which layer.
+ *
+ * Removed objects are kept in the remove list of the undo system, so
+ * the object itself is still valid when it is not on the board.
+ */
+static bool
+on_board (int Type, void *Ptr, int *Layer)
+{
+  int i;
+
+  *Layer = -1;
+  switch (Type)
+    {
+    case VIA_TYPE:
+      return in_tree (PCB->Data->via_tree, Ptr);
+    case ELEMENT_TYPE:
+      return !EMPTY_ELEMENT ((ElementType *) Ptr)
+	&& in_tree (PCB->Data->element_tree, Ptr);
+    case RATLINE_TYPE:
+      return in_tree (PCB->Data->rat_tree, Ptr);
+    }
+
+  for (i = 0; i < max_copper_layer + SILK_LAYER; i++)
+    {
+      LayerType *layer = &PCB->Data->Layer[i];
+      rtree_t *tree;
+
+      switch (Type)
+	{
+	case LINE_TYPE:
+	  tree = layer->line_tree;
+	  break;
+	case ARC_TYPE:
+	  tree = layer->arc_tree;
+	  break;
+	case TEXT_TYPE:
+	  tree = layer->text_tree;
+	  break;
+	default:
+	  tree = layer->polygon_tree;
+	  break;
+	}
+      if (in_tree (tree, Ptr))
+	{
+	  *Layer = i;
+	  return true;
+	}
+    }
+  return false;
+}
+
+static void
+write_header (FILE *fp)
+{
+  fprintf (fp, "# PCB change journal\n");
+  fprintf (fp, "Journal[%d %ld %ld]\n", JOURNAL_VERSION,
+	   journal.size, journal.mtime);
+}
+
+/*!
+ * \brief Replaces the journal by a checkpoint of the whole layout.
+ */
+static void
+write_checkpoint (void)
+{
+  char *tmpname = g_strconcat (journal.filename, ".new", NULL);
+  char *text = format_text (NO_TYPE, NULL, 0);
+  FILE *fp;
+
+  if (journal.fp != NULL)
+    {
+      fclose (journal.fp);
+      journal.fp = NULL;
+    }
+
+  if ((fp = fopen (tmpname, "w")) == NULL)
+    {
+      OpenErrorMessage (tmpname);
+      journal.active = false;
+    }
+  else
+    {
+      write_header (fp);
+      fprintf (fp, "Checkpoint %lu\n", (unsigned long) strlen (text));
+      fputs (text, fp);
+      if (fclose (fp) != 0 || rename (tmpname, journal.filename) != 0)
+	{
+	  Message (_("Can't write the change journal %s; journaling is "
+		     "off for this layout\n"), journal.filename);
+	  unlink (tmpname);
+	  journal.active = false;
+	}
+      else
+	journal.fp = fopen (journal.filename, "a");
+    }
+
+  free (text);
+  g_free (tmpname);
+  journal.written = 0;
+  forget_touched ();
+}
+
+static bool
+journal_active (void)
+{
+  return journal.active && !journal.suspended && journal.pcb == PCB
+    && PCB->Filename != NULL && strcmp (PCB->Filename, journal.board) == 0;
+}
+
+/*!
+ * \brief Stops journaling and forgets the board.
+ */
+static void
+journal_stop (void)
+{
+  if (journal.fp != NULL)
+    fclose (journal.fp);
+  journal.fp = NULL;
+  if (journal.touched != NULL)
+    forget_touched ();
+  free (journal.board);
+  journal.board = NULL;
+  g_free (journal.filename);
+  journal.filename = NULL;
+  journal.active = journal.suspended = false;
+  journal.pcb = NULL;
+}
+
+/*!
+ * \brief Sets up journaling for the layout in file Board.
+ */
+static bool
+journal_setup (char *Board)
+{
+  journal_stop ();
+  if (!Settings.Journal || !gui->gui || Board == NULL
+      || IsSnapshotFile (Board))
+    return false;
+  journal.pcb = PCB;
+  journal.board = strdup (Board);
+  journal.filename = g_strconcat (Board, ".journal", NULL);
+  return true;
+}
+
+/*!
+ * \brief Starts a new journal against the layout file as it is now.
+ */
+static void
+journal_begin (void)
+{
+  struct stat st;
+
+  if (stat (journal.board, &st) == 0)
+    {
+      journal.size = st.st_size;
+      journal.mtime = st.st_mtime;
+    }
+  else
+    journal.size = journal.mtime = 0;
+  journal.written = 0;
+  journal.active = true;
+  forget_touched ();
+}
+
+/*!
+ * \brief Called after a layout has been loaded.
+ */
+void
+JournalStart (void)
+{
+  if (replaying)
+    return;
+  /* the board of our own journal was replaced or reverted without
+   * saving, so its changes were given up
+   */
+  if (journal.active && !journal.suspended)
+    unlink (journal.filename);
+  if (!journal_setup (PCB->Filename))
+    return;
+
+  if (g_file_test (journal.filename, G_FILE_TEST_EXISTS))
+    {
+      journal.suspended = true;
+      Message (_("Found the change journal %s of a session which did not "
+		 "save.\nUse Journal(Replay) to recover its changes, or "
+		 "Journal(Discard) to delete it.\n"), journal.filename);
+      return;
+    }
+  journal_begin ();
+}
+
+/*!
+ * \brief Called after the layout has been saved to Filename.
+ */
+void
+JournalSaved (char *Filename)
+{
+  if (replaying)
+    return;
+  /* the saved file holds the changes of the old journal, too */
+  if (journal.filename != NULL && !journal.suspended)
+    unlink (journal.filename);
+  if (!journal_setup (Filename))
+    return;
+  unlink (journal.filename);
+  journal_begin ();
+}
+
+/*!
+ * \brief Tells whether changes are being journaled.
+ */
+bool
+JournalActive (void)
+{
+  return journal_active ();
+}
+
+/*!
+ * \brief Notes that an undoable operation is about to change an object.
+ *
+ * Parts of elements, lines and polygons are journaled as the object
+ * they belong to.  The first call for an object in an operation keeps
+ * its text, to be written as its "-" record; an object handed over
+ * when it is created had none.
+ */
+void
+JournalTouch (int CommandType, int Type, void *Ptr1, void *Ptr2, void *Ptr3)
+{
+  JournalObjectType *object;
+  void *ptr;
+
+  if (!journal_active ())
+    return;
+  if (CommandType == UNDO_LAYERCHANGE || CommandType == UNDO_NETLISTCHANGE)
+    {
+      journal.checkpoint = true;
+      return;
+    }
+
+  if (Type & (VIA_TYPE | ELEMENT_TYPE | RATLINE_TYPE))
+    ptr = Ptr3;
+  else if (Type & (LINE_TYPE | ARC_TYPE | TEXT_TYPE | POLYGON_TYPE))
+    ptr = Ptr2;
+  else if (Type & ELEMENT_PART_TYPES)
+    {
+      Type = ELEMENT_TYPE;
+      ptr = Ptr1;
+    }
+  else if (Type == LINEPOINT_TYPE)
+    {
+      /* rubberband rat lines have no layer */
+      Type = Ptr1 == NULL ? RATLINE_TYPE : LINE_TYPE;
+      ptr = Ptr2;
+    }
+  else if (Type == POLYGONPOINT_TYPE)
+    {
+      Type = POLYGON_TYPE;
+      ptr = Ptr2;
+    }
+  else
+    return;
+  if (ptr == NULL || g_hash_table_lookup (journal.touched, ptr) != NULL)
+    return;
+
+  object = (JournalObjectType *)malloc (sizeof *object);
+  object->type = Type;
+  object->ptr = ptr;
+  object->text = NULL;
+  if (CommandType == UNDO_CREATE && !Undoing () && ptr == Ptr3)
+    object->layer = -1;
+  else if (on_board (Type, ptr, &object->layer))
+    object->text = format_text (Type, ptr, 0);
+  g_hash_table_insert (journal.touched, ptr, object);
+  g_ptr_array_add (journal.order, object);
+}
+
+/*!
+ * \brief Appends one record to the journal.
+ */
+static void
+write_record (char Sign, int Layer, const char *Text)
+{
+  if (Layer >= 0)
+    {
+      char *header = format_text (-1, NULL, Layer);
+
+      fprintf (journal.fp, "%c%s", Sign, header);
+      journal.written += strlen (header) + 1;
+      free (header);
+    }
+  else
+    {
+      /* the section of the object is in the first word of its text */
+      const char *p = Text;
+      int n;
+
+      while (*p == '\n')
+	p++;
+      n = strcspn (p, "[(");
+      fprintf (journal.fp, "%c%.*s\n", Sign, n, p);
+      journal.written += n + 2;
+    }
+  fprintf (journal.fp, "%s.\n", Text);
+  journal.written += strlen (Text) + 2;
+}
+
+/*!
+ * \brief Writes what the last operation changed to the journal.
+ */
+void
+JournalCommit (void)
+{
+  guint i;
+
+  if (!journal_active ())
+    return;
+  if (journal.checkpoint)
+    {
+      write_checkpoint ();
+      return;
+    }
+  if (journal.order->len == 0)
+    return;
+
+  if (journal.fp == NULL)
+    {
+      if (g_file_test (journal.filename, G_FILE_TEST_EXISTS))
+	journal.fp = fopen (journal.filename, "a");
+      else if ((journal.fp = fopen (journal.filename, "w")) != NULL)
+	write_header (journal.fp);
+      if (journal.fp == NULL)
+	{
+	  OpenErrorMessage (journal.filename);
+	  journal.active = false;
+	  return;
+	}
+    }
+
+  for (i = 0; i < journal.order->len; i++)
+    {
+      JournalObjectType *old = g_ptr_array_index (journal.order, i);
+      char *text = NULL;
+      int layer;
+
+      if (on_board (old->type, old->ptr, &layer))
+	text = format_text (old->type, old->ptr, 0);
+      if (old->text != NULL && text != NULL && old->layer == layer
+	  && strcmp (old->text, text) == 0)
+	{
+	  free (text);
+	  continue;
+	}
+      if (old->text != NULL)
+	write_record ('-', old->layer, old->text);
+      if (text != NULL)
+	write_record ('+', layer, text);
+      free (text);
+    }
+  forget_touched ();
+
+  fputs ("Commit\n", journal.fp);
+  journal.written += 7;
+  fflush (journal.fp);
+
+  if (journal.written > (long) Settings.JournalLimit * 1024)
+    write_checkpoint ();
+}
+
+/* ---------------------------------------------------------------------------
+ * Replay.
+ */
+
+/*!
+ * \brief Finds Needle in Text between From and To, as whole lines.
+ *
+ * Returns the offset of the match, or -1.
+ */
+static long
+find_lines (GString *Text, gsize From, gsize To, const char *Needle)
+{
+  gsize len = strlen (Needle);
+  gsize pos = From;
+
+  while (pos + len <= To)
+    {
+      char *hit = g_strstr_len (Text->str + pos, To - pos, Needle);
+
+      if (hit == NULL)
+	return -1;
+      pos = hit - Text->str;
+      if (pos == 0 || Text->str[pos - 1] == '\n' || Needle[0] == '\n')
+	return pos;
+      pos++;
+    }
+  return -1;
+}
+
+/*!
+ * \brief Where new objects go: in front of the netlist.
+ */
+static gsize
+insert_position (GString *Text)
+{
+  long pos = find_lines (Text, 0, Text->len, "NetList()\n");
+
+  return pos < 0 ? Text->len : pos;
+}
+
+/*!
+ * \brief Finds the objects of layer Number in Text.
+ *
+ * On success, From and To delimit the lines between the opening and
+ * closing parentheses of the layer.
+ */
+static bool
+find_layer (GString *Text, int Number, gsize *From, gsize *To)
+{
+  char start[32];
+  long pos, end;
+
+  sprintf (start, "Layer(%d ", Number);
+  if ((pos = find_lines (Text, 0, Text->len, start)) < 0
+      || (end = find_lines (Text, pos, Text->len, ")\n")) < 0)
+    return false;
+  *From = pos;
+  *To = end;
+  return true;
+}
+
+/*!
+ * \brief Applies one record to the layout text.
+ *
+ * Hole and HoleSection remember where the last "-" record removed an
+ * object, so that a "+" record for the same section, which is the new
+ * text of that object, goes in its place.
+ */
+static bool
+apply_record (GString *Text, char Sign, const char *Section,
+	      const char *Body, long *Hole, const char **HoleSection)
+{
+  gsize from = 0, to = Text->len;
+  bool layer = strncmp (Section, "Layer(", 6) == 0;
+  bool found = layer && find_layer (Text, atoi (Section + 6), &from, &to);
+  long pos;
+
+  if (Sign == '-')
+    {
+      *Hole = -1;
+      if (layer && !found)
+	return false;
+      if ((pos = find_lines (Text, from, to, Body)) < 0)
+	return false;
+      g_string_erase (Text, pos, strlen (Body));
+      *Hole = pos;
+      *HoleSection = Section;
+      return true;
+    }
+
+  pos = *Hole;
+  *Hole = -1;
+  if (pos >= 0 && strcmp (Section, *HoleSection) == 0)
+    g_string_insert (Text, pos, Body);
+  else if (found)
+    g_string_insert (Text, to, Body);
+  else if (layer)
+    {
+      pos = insert_position (Text);
+      g_string_insert (Text, pos, ")\n");
+      g_string_insert (Text, pos, Body);
+      g_string_insert (Text, pos, "\n(\n");
+      g_string_insert (Text, pos, Section);
+    }
+  else
+    g_string_insert (Text, insert_position (Text), Body);
+  return true;
+}
+
+/*!
+ * \brief Reads the base layout of a journal and applies its records.
+ *
+ * Returns the text of the recovered layout, or NULL.
+ */
+static GString *
+replay (const char *Contents, gsize Length, int *Unmatched)
+{
+  const char *p = Contents, *end = Contents + Length;
+  GPtrArray *records = g_ptr_array_new ();
+  GString *text;
+  int version;
+  long size, mtime;
+
+  *Unmatched = 0;
+  while (p < end && *p == '#')
+    p = strchr (p, '\n') ? strchr (p, '\n') + 1 : end;
+  if (sscanf (p, "Journal[%d %ld %ld]", &version, &size, &mtime) != 3
+      || version != JOURNAL_VERSION)
+    {
+      Message (_("%s is not a change journal\n"), journal.filename);
+      return NULL;
+    }
+  p = strchr (p, '\n') ? strchr (p, '\n') + 1 : end;
+
+  if (strncmp (p, "Checkpoint ", 11) == 0)
+    {
+      unsigned long len = strtoul (p + 11, NULL, 10);
+
+      p = strchr (p, '\n') ? strchr (p, '\n') + 1 : end;
+      if (len > (unsigned long) (end - p))
+	{
+	  Message (_("The checkpoint in %s is truncated\n"), journal.filename);
+	  return NULL;
+	}
+      text = g_string_new_len (p, len);
+      p += len;
+    }
+  else
+    {
+      gchar *contents;
+      gsize length;
+      struct stat st;
+
+      if (stat (journal.board, &st) != 0 || st.st_size != size
+	  || (long) st.st_mtime != mtime)
+	{
+	  Message (_("%s changed after the journal %s was started\n"),
+		   journal.board, journal.filename);
+	  return NULL;
+	}
+      if (IsCompressedFile (journal.board))
+	{
+	  size_t size;
+	  char *data = ReadCompressedFile (journal.board, &size);
+
+	  if (data == NULL)
+	    return NULL;
+	  text = g_string_new_len (data, size);
+	  free (data);
+	}
+      else if (g_file_get_contents (journal.board, &contents, &length, NULL))
+	{
+	  text = g_string_new_len (contents, length);
+	  g_free (contents);
+	}
+      else
+	{
+	  OpenErrorMessage (journal.board);
+	  return NULL;
+	}
+    }
+
+  /* apply the records of each complete commit */
+  while (p < end)
+    {
+      const char *eol = memchr (p, '\n', end - p);
+      const char *body, *dot;
+
+      if (eol == NULL)
+	break;
+      if (eol - p == 6 && strncmp (p, "Commit", 6) == 0)
+	{
+	  const char *hole_section = NULL;
+	  long hole = -1;
+	  guint i;
+
+	  for (i = 0; i < records->len; i += 3)
+	    if (!apply_record (text, *(char *)records->pdata[i],
+			       records->pdata[i + 1], records->pdata[i + 2],
+			       &hole, &hole_section))
+	      (*Unmatched)++;
+	  g_ptr_array_foreach (records, (GFunc) g_free, NULL);
+	  g_ptr_array_set_size (records, 0);
+	  p = eol + 1;
+	  continue;
+	}
+      if (*p != '+' && *p != '-')
+	break;
+
+      /* the body ends with a line holding a single dot */
+      body = dot = eol + 1;
+      while (dot < end && !(end - dot >= 2 && dot[0] == '.' && dot[1] == '\n'))
+	{
+	  const char *nl = memchr (dot, '\n', end - dot);
+
+	  dot = nl ? nl + 1 : end;
+	}
+      if (dot >= end)
+	break;
+      g_ptr_array_add (records, g_strndup (p, 1));
+      g_ptr_array_add (records, g_strndup (p + 1, eol - p - 1));
+      g_ptr_array_add (records, g_strndup (body, dot - body));
+      p = dot + 2;
+    }
+
+  /* records after the last commit belong to an unfinished change */
+  g_ptr_array_foreach (records, (GFunc) g_free, NULL);
+  g_ptr_array_free (records, true);
+  return text;
+}
+
+static int
+journal_replay (void)
+{
+  gchar *contents;
+  gsize length;
+  GString *text;
+  char *recovered, *board;
+  int unmatched, result;
+
+  if (!journal.suspended)
+    {
+      Message (_("There is no change journal to replay\n"));
+      return 1;
+    }
+  if (PCB->Changed
+      && !gui->confirm_dialog (_("Replaying the journal reloads the layout "
+				 "and loses the changes made since it was "
+				 "loaded.  Continue?"), 0))
+    return 1;
+  if (!g_file_get_contents (journal.filename, &contents, &length, NULL))
+    {
+      OpenErrorMessage (journal.filename);
+      return 1;
+    }
+  text = replay (contents, length, &unmatched);
+  g_free (contents);
+  if (text == NULL)
+    return 1;
+
+  recovered = g_strconcat (journal.filename, ".pcb", NULL);
+  if (!g_file_set_contents (recovered, text->str, text->len, NULL))
+    {
+      OpenErrorMessage (recovered);
+      g_string_free (text, true);
+      g_free (recovered);
+      return 1;
+    }
+  g_string_free (text, true);
+
+  board = strdup (journal.board);
+  replaying = true;
+  result = LoadPCB (recovered);
+  replaying = false;
+  unlink (recovered);
+  g_free (recovered);
+  if (result != 0)
+    {
+      free (board);
+      return 1;
+    }
+
+  /* carry on with the recovered layout under its own name, and keep
+   * appending to the same journal
+   */
+  free (PCB->Filename);
+  PCB->Filename = board;
+  if (gui->notify_filename_changed != NULL)
+    gui->notify_filename_changed ();
+  SetChangedFlag (true);
+  journal.pcb = PCB;
+  journal.suspended = false;
+  journal.active = true;
+  forget_touched ();
+  if (unmatched)
+    Message (_("%d journal records did not match the layout and were "
+	       "skipped\n"), unmatched);
+  else
+    Message (_("Recovered the changes from %s\n"), journal.filename);
+  return 0;
+}
+
+static int
+journal_discard (void)
+{
+  if (!journal.suspended)
+    {
+      Message (_("There is no change journal to discard\n"));
+      return 1;
+    }
+  unlink (journal.filename);
+  journal.suspended = false;
+  journal_begin ();
+  /* changes made while the journal waited are not in the file */
+  if (PCB->Changed)
+    write_checkpoint ();
+  return 0;
+}
+
+static const char journal_syntax[] =
+  "Journal(Replay|Discard)";
+
+static const char journal_help[] =
+  "Recover or delete the change journal of an unsaved session.";
+
+/* %start-doc actions Journal
+
+When the @code{--journal} option is on, each change to a layout is
+appended to @file{<layout>.journal} as soon as it is made, and the
+journal is deleted when the layout is saved.  If a journal is found
+when a layout is loaded, the last session ended without saving, and
+journaling stays off until one of these is given:
+
+@table @code
+
+@item Replay
+Applies the complete changes in the journal to the layout and loads
+the result.  The recovered layout is marked as changed; save it to
+make the recovery permanent.
+
+@item Discard
+Deletes the journal.
+
+@end table
+
+%end-doc */
+
+static int
+ActionJournal (int argc, char **argv, Coord x, Coord y)
+{
+  char *function = ARG (0);
+
+  if (function == NULL)
+    AFAIL (journal);
+  if (strcasecmp (function, "Replay") == 0)
+    return journal_replay ();
+  if (strcasecmp (function, "Discard") == 0)
+    return journal_discard ();
+  AFAIL (journal);
+}
+
+HID_Action journal_action_list[] = {
+  {"Journal", 0, ActionJournal,
+   journal_help, journal_syntax}
+};
+
+REGISTER_ACTIONS (journal_action_list)
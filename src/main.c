@@ -65,6 +65,7 @@
 #include "polygon.h"
 #include "gettext.h"
 #include "pcb-printf.h"
+#include "profile.h"
 #include "strflags.h"
 
 #include "hid/common/actions.h"
@@ -1078,6 +1079,22 @@ Minimum polygon area.
 */
   RSET (IsleArea, MIL_TO_COORD(100) * MIL_TO_COORD(100), "minimum polygon area", 0),
 
+/* %start-doc options "5 Sizes"
+@ftable @code
+@item --poly-tolerance <num>
+How far the polygons approximating circles and arcs may deviate from
+the true shape. Smaller features get fewer vertices, larger ones up to
+40 per circle, which makes pours with many small clearances faster to
+compute, at the cost of coarser outlines. A value of @code{0.2mil}
+works well for most boards.
+Default value is @code{0}, which always uses 40 segments and gives the
+same output as older versions.
+@end ftable
+%end-doc
+*/
+  CSET (PolyTolerance, 0, "poly-tolerance",
+  "Maximum deviation of polygon approximations of arcs and circles"),
+
 
 /* %start-doc options "5 Sizes"
 @ftable @code
@@ -1106,6 +1123,67 @@ The default value is @code{60}.
   ISET (BackupInterval, 60, "backup-interval",
   "Time between automatic backups in seconds. Set to 0 to disable"),
 
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --journal
+If set, every change to a layout is appended to @file{<layout>.journal}
+as soon as it is made, and the journal is deleted when the layout is
+saved.  See the @code{Journal} action for recovering from a journal.
+@end ftable
+%end-doc
+*/
+  BSET (Journal, 0, "journal",
+       "Append every change to a journal next to the layout"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --journal-limit
+Size in kB at which the change journal is replaced by a full copy of the
+layout.  The default value is @code{1024}.
+@end ftable
+%end-doc
+*/
+  ISET (JournalLimit, 1024, "journal-limit",
+  "Size in kB at which the change journal is compacted"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --autoroute-jobs <num>
+Number of nets the autorouter routes at once, each in a child process.
+Only nets far enough apart are routed together, and the result doesn't
+depend on which of them finishes first.  The default value is @code{1},
+which routes one net after the other.
+@end ftable
+%end-doc
+*/
+  ISET (AutorouteJobs, 1, "autoroute-jobs",
+  "Number of nets the autorouter routes at once"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --autoroute-stats <filename>
+File the autorouter appends the statistics of each pass to, one JSON
+object per line: the nets and subnets routed, the conflicts, failures
+and rip-ups, the total cost, the wall time, the edges expanded and the
+via site queries.  A short summary of each pass is logged either way.
+@end ftable
+%end-doc
+*/
+  SSET (AutorouteStats, "", "autoroute-stats",
+  "File to append the statistics of each autoroute pass to"),
+
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --autoroute-checkpoint <filename>
+File the autorouter saves its state to after each pass.  A run that was
+cancelled, or that crashed, continues from the last finished pass with
+@code{AutoRoute(Resume)}, as long as the layout wasn't changed since.
+@end ftable
+%end-doc
+*/
+  SSET (AutorouteCheckpoint, "", "autoroute-checkpoint",
+  "File to save the autoroute state to after each pass"),
+
 /* %start-doc options "4 Layer Names"
 @ftable @code
 @item --layer-name-1 <string>
@@ -1284,6 +1362,19 @@ Top level directory for the newlib style library.
   SSET (LibraryTree, PCBTREEPATH, "lib-newlib",
 	"Top level directory for the newlib style library"),
 
+/* %start-doc options "5 Paths"
+@ftable @code
+@item --lib-index <string>
+File caching the contents of the newlib style library between runs.
+Only the directories whose modification time changed are read again.
+Defaults to @file{~/.pcb/library-index}; an empty string disables the
+index.
+@end ftable
+%end-doc
+*/
+  SSET (LibraryIndex, "", "lib-index",
+	"File caching the contents of the newlib style library"),
+
 /* %start-doc options "6 Commands"
 @ftable @code
 @item --save-command <string>
@@ -1545,6 +1636,18 @@ If set, save pcb files using only mm unit suffix rather than 'smart' mil/mm.
   BSET (SaveMetricOnly, 0, "save-metric-only",
         "If set, save pcb files using only mm unit suffix rather than 'smart' mil/mm."),
 
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --profile-load
+If set, log the time and heap growth of each phase of loading a layout,
+and of reading the footprint library at startup.  See also the
+@code{ProfileLoad} action.
+@end ftable
+%end-doc
+*/
+  BSET (ProfileLoad, 0, "profile-load",
+        "If set, report the time spent in each phase of loading a layout"),
+
 /* %start-doc options "2 General GUI Options"
 @ftable @code
 @item --all-direction-lines
@@ -1574,6 +1677,18 @@ If set, all found connections are reset before a new component is scanned.
   BSET (ResetAfterElement, 1, "reset-after-element",
        "If set, all found connections are reset before a new component is scanned"),
 
+/* %start-doc options "1 General Options"
+@ftable @code
+@item --live-rats
+If set, the rats of the nets connected to an element are made again
+whenever the element is moved, rotated, flipped, pasted or copied, as
+by @code{DeleteRats} and @code{AddRats} for these nets only.
+@end ftable
+%end-doc
+*/
+  BSET (LiveRats, 0, "live-rats",
+       "If set, the rats of an element are made again when it is placed"),
+
 /* %start-doc options "1 General Options"
 @ftable @code
 @item --auto-buried-vias
@@ -1696,6 +1811,7 @@ char *pcblibpath = NULL;
 char *pcbtreedir = NULL;
 char *pcbtreepath = NULL;
 char *homedir = NULL;
+static char *libraryindex = NULL;
 
 /*!
  * \brief See if argv0 has enough of a path to let lrealpath give the
@@ -1899,6 +2015,16 @@ InitPaths (char *argv0)
       }
 
     }
+
+  /* the library index is kept with the user's settings */
+  if (homedir != NULL)
+    {
+      libraryindex = Concat (homedir, PCB_DIR_SEPARATOR_S, ".pcb",
+			     PCB_DIR_SEPARATOR_S, "library-index", NULL);
+      for (i = 0; i < l; i++)
+	if (NSTRCMP (main_attribute_list[i].name, "lib-index") == 0)
+	  main_attribute_list[i].default_val.str_value = libraryindex;
+    }
 }
 
 /* ---------------------------------------------------------------------- 
@@ -1963,6 +2089,7 @@ pcb_main_uninit (void)
 
   free0 (pcblibdir);
   free0 (homedir);
+  free0 (libraryindex);
   free0 (bindir);
   free0 (exec_prefix);
   free0 (program_directory);
@@ -2147,8 +2274,13 @@ main (int argc, char *argv[])
 
   /* read the library file and display it if it's not empty
    */
+  if (Settings.ProfileLoad)
+    ProfileStart ();
+  PROFILE_PUSH (PROFILE_LIBRARY);
   if (!ReadLibraryContents () && Library.MenuN)
     hid_action ("LibraryChanged");
+  PROFILE_POP ();
+  ProfileReport (_("the library"));
 
 #ifdef HAVE_LIBSTROKE
   stroke_init ();
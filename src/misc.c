@@ -276,7 +276,7 @@ SetPinBoundingBox (PinType *Pin)
   width = MAX (Pin->Clearance + PIN_SIZE (Pin), Pin->Mask) / 2;
 
   /* Adjust for our discrete polygon approximation */
-  width = (double)width * POLY_CIRC_RADIUS_ADJ + 0.5;
+  width = poly_circ_outline (width);
 
   Pin->BoundingBox.X1 = Pin->X - width;
   Pin->BoundingBox.Y1 = Pin->Y - width;
@@ -328,7 +328,7 @@ SetPadBoundingBox (PadType *Pad)
   else
     {
       /* Adjust for our discrete polygon approximation */
-      width = (double)width * POLY_CIRC_RADIUS_ADJ + 0.5;
+      width = poly_circ_outline (width);
 
       Pad->BoundingBox.X1 = MIN (Pad->Point1.X, Pad->Point2.X) - width;
       Pad->BoundingBox.X2 = MAX (Pad->Point1.X, Pad->Point2.X) + width;
@@ -347,7 +347,7 @@ SetLineBoundingBox (LineType *Line)
   Coord width = (Line->Thickness + Line->Clearance + 1) / 2;
 
   /* Adjust for our discrete polygon approximation */
-  width = (double)width * POLY_CIRC_RADIUS_ADJ + 0.5;
+  width = poly_circ_outline (width);
 
   Line->BoundingBox.X1 = MIN (Line->Point1.X, Line->Point2.X) - width;
   Line->BoundingBox.X2 = MAX (Line->Point1.X, Line->Point2.X) + width;
@@ -1734,7 +1734,8 @@ SetArcBoundingBox (ArcType *Arc)
   width = (Arc->Thickness + Arc->Clearance) / 2;
 
   /* Adjust for our discrete polygon approximation */
-  width = (double)width * MAX (POLY_CIRC_RADIUS_ADJ, (1.0 + POLY_ARC_MAX_DEVIATION)) + 0.5;
+  width = MAX (poly_circ_outline (width),
+               (double)width * (1.0 + POLY_ARC_MAX_DEVIATION) + 0.5);
 
   Arc->BoundingBox.X1 -= width;
   Arc->BoundingBox.X2 += width;
@@ -2525,8 +2526,8 @@ AttributePutToList (AttributeListType *list, const char *name, const char *value
       for (i=0; i<list->Number; i++)
 	if (strcmp (name, list->List[i].name) == 0)
 	  {
-	    free (list->List[i].value);
-	    list->List[i].value = STRDUP (value);
+	    ReleaseString (list->List[i].value);
+	    list->List[i].value = InternString (value);
 	    return 1;
 	  }
     }
@@ -2542,8 +2543,8 @@ AttributePutToList (AttributeListType *list, const char *name, const char *value
 
   /* Now add the new attribute.  */
   i = list->Number;
-  list->List[i].name = STRDUP (name);
-  list->List[i].value = STRDUP (value);
+  list->List[i].name = InternString (name);
+  list->List[i].value = InternString (value);
   list->Number ++;
   return 0;
 }
@@ -2558,8 +2559,8 @@ AttributeRemoveFromList(AttributeListType *list, char *name)
   for (i=0; i<list->Number; i++)
     if (strcmp (name, list->List[i].name) == 0)
       {
-	free (list->List[i].name);
-	free (list->List[i].value);
+	ReleaseString (list->List[i].name);
+	ReleaseString (list->List[i].value);
 	for (j=i; j<list->Number-1; j++)
 	  list->List[j] = list->List[j+1];
 	list->Number --;
@@ -50,6 +50,7 @@
 #include "move.h"
 #include "mymem.h"
 #include "polygon.h"
+#include "rats.h"
 #include "rtree.h"
 #include "search.h"
 #include "select.h"
@@ -833,6 +834,9 @@ MoveObjectAndRubberband (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 
   AddObjectToMoveUndoList (Type, Ptr1, Ptr2, Ptr3, DX, DY);
   ptr2 = ObjectOperation (&MoveFunctions, Type, Ptr1, Ptr2, Ptr3);
+  /* the rats are replaced in the same undo step as the move */
+  if (Type == ELEMENT_TYPE && Settings.LiveRats)
+    UpdateElementRats ((ElementType *) Ptr2);
   IncrementUndoSerialNumber ();
   return (ptr2);
 }
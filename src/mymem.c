@@ -39,6 +39,7 @@
 #include "global.h"
 
 #include <memory.h>
+#include <stddef.h>
 
 #include "data.h"
 #include "error.h"
@@ -662,8 +663,8 @@ FreeAttributeListMemory (AttributeListType *list)
 
   for (i = 0; i < list->Number; i++)
     {
-      free (list->List[i].name);
-      free (list->List[i].value);
+      ReleaseString (list->List[i].name);
+      ReleaseString (list->List[i].value);
     }
   free (list->List);
   list->List = NULL;
@@ -686,14 +687,14 @@ FreeElementMemory (ElementType *element)
   END_LOOP;
   PIN_LOOP (element);
   {
-    free (pin->Name);
-    free (pin->Number);
+    ReleaseString (pin->Name);
+    ReleaseString (pin->Number);
   }
   END_LOOP;
   PAD_LOOP (element);
   {
-    free (pad->Name);
-    free (pad->Number);
+    ReleaseString (pad->Name);
+    ReleaseString (pad->Number);
   }
   END_LOOP;
 
@@ -922,3 +923,95 @@ StripWhiteSpaceAndDup (const char *S)
   else
     return (NULL);
 }
+
+/*!
+ * \brief An interned string and the number of its users.
+ */
+typedef struct
+{
+  unsigned Refs;
+  char String[1];
+} InternType;
+
+#define INTERN_ENTRY(s) \
+  ((InternType *) ((char *) (s) - offsetof (InternType, String)))
+
+/*!
+ * \brief The interned strings, keyed by their text.
+ *
+ * There is one table for all boards, since elements move between the
+ * layout and the paste buffers without copying their pins.
+ */
+static GHashTable *intern_table = NULL;
+
+/*!
+ * \brief Returns the shared copy of a string, adding one user.
+ *
+ * Equal strings which are interned have the same address, so they
+ * compare with ==.  The copy is read only and is given back with
+ * ReleaseString() instead of free().
+ *
+ * \return NULL if String is NULL.
+ */
+char *
+InternString (const char *String)
+{
+  InternType *entry;
+  size_t length;
+
+  if (String == NULL)
+    return (NULL);
+  if (intern_table == NULL)
+    intern_table = g_hash_table_new (g_str_hash, g_str_equal);
+
+  entry = (InternType *) g_hash_table_lookup (intern_table, String);
+  if (entry == NULL)
+    {
+      length = strlen (String);
+      entry = (InternType *) malloc (offsetof (InternType, String)
+				     + length + 1);
+      entry->Refs = 0;
+      memcpy (entry->String, String, length + 1);
+      g_hash_table_insert (intern_table, entry->String, entry);
+    }
+  entry->Refs++;
+  return (entry->String);
+}
+
+/*!
+ * \brief Drops one user of an interned string, freeing it with the
+ * last one.
+ */
+void
+ReleaseString (char *String)
+{
+  InternType *entry;
+
+  if (String == NULL)
+    return;
+  entry = INTERN_ENTRY (String);
+  if (--entry->Refs == 0)
+    {
+      g_hash_table_remove (intern_table, entry->String);
+      free (entry);
+    }
+}
+
+/*!
+ * \brief Looks up a string without interning it.
+ *
+ * Use it to turn a search key into the pointer to compare against
+ * interned strings.
+ *
+ * \return the interned copy, or NULL if no object uses String.
+ */
+char *
+FindInternedString (const char *String)
+{
+  InternType *entry;
+
+  if (String == NULL || intern_table == NULL)
+    return (NULL);
+  entry = (InternType *) g_hash_table_lookup (intern_table, String);
+  return (entry != NULL ? entry->String : NULL);
+}
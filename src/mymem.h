@@ -105,6 +105,9 @@ void DSAddCharacter (DynamicStringType *, char);
 void DSAddString (DynamicStringType *, const char *);
 void DSClearString (DynamicStringType *);
 char *StripWhiteSpaceAndDup (const char *);
+char *InternString (const char *);
+void ReleaseString (char *);
+char *FindInternedString (const char *);
 
 #ifdef NEED_STRDUP
 char *strdup (const char *);
@@ -92,6 +92,7 @@ static int netlist_needs_update = 0;
 void
 NetlistChanged (int force_unfreeze)
 {
+  InvalidateNetlist ();
   if (force_unfreeze)
     netlist_frozen = 0;
   if (netlist_frozen)
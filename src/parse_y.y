@@ -52,6 +52,7 @@
 #include "misc.h"
 #include "parse_l.h"
 #include "polygon.h"
+#include "profile.h"
 #include "remove.h"
 #include "rtree.h"
 #include "strflags.h"
@@ -220,11 +221,13 @@ parsepcb
 			 * we didn't know the layer grouping before.
 			 */
 			PCB = yyPCB;
+			PROFILE_PUSH (PROFILE_CLIP);
 			ALLPOLYGON_LOOP (yyData);
 			{
 			  InitClip (yyData, layer, polygon);
 			}
 			ENDALL_LOOP;
+			PROFILE_POP ();
 			PCB = pcb_save;
 			}		   
 			;
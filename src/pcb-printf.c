@@ -44,6 +44,11 @@
 
 #include "pcb-printf.h"
 
+/*! Size of the on-stack output buffer of the pcb_*printf functions. */
+#define PCB_PRINTF_BUF_SIZE 512
+/*! Longest printf specifier (e.g. "%-12.4") passed on to printf. */
+#define PCB_PRINTF_SPEC_MAX 64
+
 /* Helper macros for tables */
 #define MM_TO_COORD3(a,b,c)		MM_TO_COORD (a), MM_TO_COORD (b), MM_TO_COORD (c)
 #define MIL_TO_COORD3(a,b,c)		MIL_TO_COORD (a), MIL_TO_COORD (b), MIL_TO_COORD (c)
@@ -314,6 +319,176 @@ static int min_sig_figs(double d)
   return rv;
 }
 
+/*!
+ * \brief Output sink for the formatter.
+ *
+ * Text is collected in buf, which starts out as a buffer supplied by
+ * the caller (usually on its stack).  When it fills up it is flushed
+ * to fh if there is one, or else moved to a heap buffer of twice the
+ * size.  With truncate set the buffer never moves, and output that
+ * doesn't fit is only counted, as snprintf does.
+ */
+typedef struct
+{
+  char *buf;
+  size_t len;			/*!< Bytes in buf. */
+  size_t size;			/*!< Capacity of buf. */
+  size_t total;			/*!< Bytes produced, including flushed ones. */
+  FILE *fh;			/*!< Where to flush to, if not NULL. */
+  bool heap;			/*!< buf was allocated here. */
+  bool truncate;		/*!< buf can't grow, drop what doesn't fit. */
+  bool failed;			/*!< Writing to fh failed. */
+} PcbOut;
+
+static void
+out_init (PcbOut *out, char *buf, size_t size, FILE *fh, bool truncate)
+{
+  out->buf = buf;
+  out->len = 0;
+  out->size = size;
+  out->total = 0;
+  out->fh = fh;
+  out->heap = false;
+  out->truncate = truncate;
+  out->failed = false;
+}
+
+static void
+out_flush (PcbOut *out)
+{
+  if (out->fh != NULL && out->len > 0)
+    {
+      if (fwrite (out->buf, 1, out->len, out->fh) != out->len)
+        out->failed = true;
+      out->len = 0;
+    }
+}
+
+/*!
+ * \brief Make room for n more bytes plus a terminating '\\0'.
+ *
+ * \return false if that is not possible, i.e. the output is being
+ * truncated, or written to a file and too big for the buffer.
+ */
+static bool
+out_reserve (PcbOut *out, size_t n)
+{
+  size_t size;
+
+  if (out->len + n < out->size)
+    return true;
+  if (out->truncate)
+    return false;
+  if (out->fh != NULL)
+    {
+      out_flush (out);
+      return n < out->size;
+    }
+  size = MAX (2 * out->size, out->len + n + 1);
+  if (out->heap)
+    out->buf = (char *)g_realloc (out->buf, size);
+  else
+    {
+      char *buf = (char *)g_malloc (size);
+
+      memcpy (buf, out->buf, out->len);
+      out->buf = buf;
+      out->heap = true;
+    }
+  out->size = size;
+  return true;
+}
+
+static void
+out_write (PcbOut *out, const char *s, size_t n)
+{
+  out->total += n;
+  if (!out_reserve (out, n))
+    {
+      if (out->fh != NULL)
+        {
+          /* Too big for the buffer, which out_reserve just flushed */
+          if (fwrite (s, 1, n, out->fh) != n)
+            out->failed = true;
+          return;
+        }
+      n = out->size > out->len ? out->size - out->len - 1 : 0;
+    }
+  memcpy (out->buf + out->len, s, n);
+  out->len += n;
+}
+
+static void
+out_putc (PcbOut *out, char c)
+{
+  if (out->len + 1 < out->size)
+    {
+      out->buf[out->len++] = c;
+      out->total++;
+    }
+  else
+    out_write (out, &c, 1);
+}
+
+static void
+out_puts (PcbOut *out, const char *s)
+{
+  out_write (out, s, strlen (s));
+}
+
+/*!
+ * \brief printf a single conversion straight into the output buffer.
+ */
+static void
+out_format (PcbOut *out, const char *spec, ...)
+{
+  va_list args;
+  size_t avail = out->size - out->len;
+  int n;
+
+  va_start (args, spec);
+  n = vsnprintf (out->buf + out->len, avail, spec, args);
+  va_end (args);
+  if (n < 0)
+    return;
+  if ((size_t) n < avail)
+    {
+      out->len += n;
+      out->total += n;
+      return;
+    }
+
+  /* Didn't fit; vsnprintf has filled the buffer as far as it could */
+  if (out_reserve (out, n))
+    {
+      va_start (args, spec);
+      vsnprintf (out->buf + out->len, out->size - out->len, spec, args);
+      va_end (args);
+      out->len += n;
+    }
+  else if (out->fh != NULL)
+    {
+      va_start (args, spec);
+      if (vfprintf (out->fh, spec, args) < 0)
+        out->failed = true;
+      va_end (args);
+    }
+  else if (out->size > 0)
+    out->len = out->size - 1;
+  out->total += n;
+}
+
+/*!
+ * \brief Terminate the buffer with a '\\0' and flush any file output.
+ */
+static void
+out_finish (PcbOut *out)
+{
+  out_flush (out);
+  if (out->size > 0)
+    out->buf[MIN (out->len, out->size - 1)] = '\0';
+}
+
 /*!
  * \brief Internal coord-to-string converter for pcb-printf.
  *
@@ -322,31 +497,23 @@ static int min_sig_figs(double d)
  * given, the list is enclosed in parens to make the scope of
  * the unit suffix clear.
  *
+ * \param [in] out          Where to write the string.
  * \param [in] coord        Array of coords to convert.
- * \param [in] n_coords     Number of coords in array.
+ * \param [in] n_coords     Number of coords in array, at most 10.
  * \param [in] printf_spec  printf sub-specifier to use with %f.
  * \param [in] e_allow      Bitmap of units the function may use.
  * \param [in] suffix_type  Whether to add a suffix.
- *
- * \return A string containing the formatted coords. Must be freed with
- * g_free.
  */
-static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spec, enum e_allow allow, enum e_suffix suffix_type)
+static void CoordsToString(PcbOut *out, Coord coord[], int n_coords, const char *printf_spec, enum e_allow allow, enum e_suffix suffix_type)
 {
-  GString *buff;
-  gchar *printf_buff;
+  char printf_buff[64];
   gchar filemode_buff[G_ASCII_DTOSTR_BUF_SIZE];
   enum e_family family;
-  double *value;
+  double value[10];
   const char *suffix;
   int i, n;
 
-  value = malloc (n_coords * sizeof *value);
-  buff  = g_string_new ("");
-
   /* Sanity checks */
-  if (buff == NULL || value == NULL)
-    return NULL;
   if (allow == 0)
     allow = ALLOW_ALL;
   if (printf_spec == NULL)
@@ -419,33 +586,28 @@ static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spe
          printf_spec[i] == '#')
     ++i;
   if (printf_spec[i] == '.')
-    printf_buff = g_strdup_printf (", %sf", printf_spec);
+    snprintf (printf_buff, sizeof printf_buff, ", %sf", printf_spec);
   else
-    printf_buff = g_strdup_printf (", %s.%df", printf_spec, Units[n].default_prec);
+    snprintf (printf_buff, sizeof printf_buff, ", %s.%df", printf_spec, Units[n].default_prec);
 
   /* Actually sprintf the values in place
    *  (+ 2 skips the ", " for first value) */
   if (n_coords > 1)
-    g_string_append_c (buff, '(');
-  if (suffix_type == FILE_MODE || suffix_type == FILE_MODE_NO_SUFFIX)
-    {
-      g_ascii_formatd (filemode_buff, sizeof filemode_buff, printf_buff + 2, value[0]);
-      g_string_append_printf (buff, "%s", filemode_buff);
-    }
-  else
-    g_string_append_printf (buff, printf_buff + 2, value[0]);
-  for (i = 1; i < n_coords; ++i)
+    out_putc (out, '(');
+  for (i = 0; i < n_coords; ++i)
     {
+      const char *fmt = i == 0 ? printf_buff + 2 : printf_buff;
+
       if (suffix_type == FILE_MODE || suffix_type == FILE_MODE_NO_SUFFIX)
         {
-          g_ascii_formatd (filemode_buff, sizeof filemode_buff, printf_buff, value[i]);
-          g_string_append_printf (buff, "%s", filemode_buff);
+          g_ascii_formatd (filemode_buff, sizeof filemode_buff, fmt, value[i]);
+          out_puts (out, filemode_buff);
         }
       else
-        g_string_append_printf (buff, printf_buff, value[i]);
+        out_format (out, fmt, value[i]);
     }
   if (n_coords > 1)
-    g_string_append_c (buff, ')');
+    out_putc (out, ')');
   /* Append suffix */
   if (value[0] != 0 || n_coords > 1)
     {
@@ -455,54 +617,62 @@ static gchar *CoordsToString(Coord coord[], int n_coords, const char *printf_spe
         case FILE_MODE_NO_SUFFIX:
           break;
         case SUFFIX:
-          g_string_append_printf (buff, " %s", suffix);
+          out_putc (out, ' ');
+          out_puts (out, suffix);
           break;
         case FILE_MODE:
-          g_string_append_printf (buff, "%s", suffix);
+          out_puts (out, suffix);
           break;
         }
     }
+}
 
-  g_free (printf_buff);
-  free (value);
-  /* Return just the gchar* part of our string */
-  return g_string_free (buff, FALSE);
+/*!
+ * \brief Append to the printf specifier being collected.
+ */
+static void
+spec_append (char *spec, const char *s)
+{
+  size_t len = strlen (spec);
+
+  /* Anything longer than this isn't a sensible specifier anyway */
+  if (len + strlen (s) < PCB_PRINTF_SPEC_MAX)
+    strcpy (spec + len, s);
+}
+
+static void
+spec_append_c (char *spec, char c)
+{
+  char s[2];
+
+  s[0] = c;
+  s[1] = '\0';
+  spec_append (spec, s);
 }
 
 /*!
- * \brief Main pcb-printf function.
- *
- * This is a printf wrapper that accepts new format specifiers to
- * output pcb coords as various units. See the comment at the top
- * of pcb-printf.h for full details.
+ * \brief The pcb-printf formatter.
  *
- * \param [in] fmt    Format specifier.
- * \param [in] args   Arguments to specifier.
- *
- * \return A formatted string. Must be freed with g_free.
+ * Does the work for all the pcb_*printf functions, writing to the given
+ * sink without any allocations of its own.
  */
-gchar *pcb_vprintf(const char *fmt, va_list args)
+static void
+pcb_vformat (PcbOut *out, const char *fmt, va_list args)
 {
-  GString *string = g_string_new ("");
-  GString *spec   = g_string_new ("");
-
+  char spec[PCB_PRINTF_SPEC_MAX];
   enum e_allow mask = ALLOW_ALL;
 
-  if (string == NULL || spec == NULL)
-    return NULL;
-
   while(*fmt)
     {
       enum e_suffix suffix = NO_SUFFIX;
 
       if(*fmt == '%')
         {
-          gchar *unit_str = NULL;
           const char *ext_unit = "";
           Coord value[10];
           int count, i, done;
 
-          g_string_assign (spec, "%");
+          strcpy (spec, "%");
 
           done = 0;
           while ( ! done && fmt++ && *fmt)
@@ -521,7 +691,12 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
                   break;
                 /* Printf sub-specifiers */
                 case '*':
-                  g_string_append_printf (spec, "%d", va_arg (args, int));
+                  {
+                    char width[16];
+
+                    sprintf (width, "%d", va_arg (args, int));
+                    spec_append (spec, width);
+                  }
                   break;
                 case '.':
                 case ' ':
@@ -541,31 +716,34 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
                 case '7':
                 case '8':
                 case '9':
-                  g_string_append_c (spec, *fmt);
+                  spec_append_c (spec, *fmt);
                   break;
                 default:
                   done = 1;
                 }
             }
+          /* A '%' ending the format string prints nothing */
+          if (*fmt == '\0')
+            break;
 
           /* Tack full specifier onto specifier */
           if (*fmt != 'm')
-            g_string_append_c (spec, *fmt);
+            spec_append_c (spec, *fmt);
           switch(*fmt)
             {
             /* Printf specs */
             case 'o': case 'i': case 'd':
             case 'u': case 'x': case 'X':
-              if(strchr (spec->str, 'l'))
+              if(strchr (spec, 'l'))
                 {
-                  if(strchr (spec->str, 'l') != strrchr (spec->str, 'l'))
-                    unit_str = g_strdup_printf (spec->str, va_arg(args, long long));
+                  if(strchr (spec, 'l') != strrchr (spec, 'l'))
+                    out_format (out, spec, va_arg(args, long long));
                   else
-                    unit_str = g_strdup_printf (spec->str, va_arg(args, long));
+                    out_format (out, spec, va_arg(args, long));
                 }
               else
                 {
-                  unit_str = g_strdup_printf (spec->str, va_arg(args, int));
+                  out_format (out, spec, va_arg(args, int));
                 }
               break;
             case 'e': case 'E':
@@ -574,34 +752,40 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
               if(suffix == FILE_MODE || suffix == FILE_MODE_NO_SUFFIX)
                 {
                   gchar buffer[128];
-                  g_ascii_formatd (buffer, 128, spec->str, va_arg(args, double));
-                  unit_str = g_strdup_printf ("%s", buffer);
+                  g_ascii_formatd (buffer, 128, spec, va_arg(args, double));
+                  out_puts (out, buffer);
                 }
               else
-                unit_str = g_strdup_printf (spec->str, va_arg(args, double));
+                out_format (out, spec, va_arg(args, double));
               break;
             case 'c':
-              if(strchr (spec->str, 'l') && sizeof(int) <= sizeof(wchar_t))
-                unit_str = g_strdup_printf (spec->str, va_arg(args, wchar_t));
+              if(strchr (spec, 'l') && sizeof(int) <= sizeof(wchar_t))
+                out_format (out, spec, va_arg(args, wchar_t));
               else
-                unit_str = g_strdup_printf (spec->str, va_arg(args, int));
+                out_format (out, spec, va_arg(args, int));
               break;
             case 's':
-              if(strchr (spec->str, 'l'))
-                unit_str = g_strdup_printf (spec->str, va_arg(args, wchar_t *));
+              if(strchr (spec, 'l'))
+                out_format (out, spec, va_arg(args, wchar_t *));
+              /* The common case doesn't need printf at all */
+              else if (spec[1] == 's')
+                {
+                  const char *s = va_arg(args, char *);
+                  out_puts (out, s != NULL ? s : "(null)");
+                }
               else
-                unit_str = g_strdup_printf (spec->str, va_arg(args, char *));
+                out_format (out, spec, va_arg(args, char *));
               break;
             case 'n':
               /* Depending on gcc settings, this will probably break with
                *  some silly "can't put %n in writeable data space" message */
-              unit_str = g_strdup_printf (spec->str, va_arg(args, int *));
+              out_format (out, spec, va_arg(args, int *));
               break;
             case 'p':
-              unit_str = g_strdup_printf (spec->str, va_arg(args, void *));
+              out_format (out, spec, va_arg(args, void *));
               break;
             case '%':
-              g_string_append_c (string, '%');
+              out_putc (out, '%');
               break;
             /* Our specs */
             case 'm':
@@ -613,11 +797,11 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
               count = 1;
               switch(*fmt)
                 {
-                case 's': unit_str = CoordsToString(value, 1, spec->str, ALLOW_MM | ALLOW_MIL, suffix); break;
-                case 'S': unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_ALL, suffix); break;
-                case 'M': unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_METRIC, suffix); break;
-                case 'L': unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_IMPERIAL, suffix); break;
-                case 'r': unit_str = CoordsToString(value, 1, spec->str, set_allow_readable(0), FILE_MODE); break;
+                case 's': CoordsToString(out, value, 1, spec, ALLOW_MM | ALLOW_MIL, suffix); break;
+                case 'S': CoordsToString(out, value, 1, spec, mask & ALLOW_ALL, suffix); break;
+                case 'M': CoordsToString(out, value, 1, spec, mask & ALLOW_METRIC, suffix); break;
+                case 'L': CoordsToString(out, value, 1, spec, mask & ALLOW_IMPERIAL, suffix); break;
+                case 'r': CoordsToString(out, value, 1, spec, set_allow_readable(0), FILE_MODE); break;
                 /* All these fallthroughs are deliberate */
                 case '9': value[count++] = va_arg(args, Coord);
                 case '8': value[count++] = va_arg(args, Coord);
@@ -629,24 +813,25 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
                 case '2':
                 case 'D':
                   value[count++] = va_arg(args, Coord);
-                  unit_str = CoordsToString(value, count, spec->str, mask & ALLOW_ALL, suffix);
+                  CoordsToString(out, value, count, spec, mask & ALLOW_ALL, suffix);
                   break;
                 case 'd':
                   value[1] = va_arg(args, Coord);
-                  unit_str = CoordsToString(value, 2, spec->str, ALLOW_MM | ALLOW_MIL, suffix);
+                  CoordsToString(out, value, 2, spec, ALLOW_MM | ALLOW_MIL, suffix);
                   break;
                 case '*':
                   for (i = 0; i < N_UNITS; ++i)
                     if (strcmp (ext_unit, Units[i].suffix) == 0)
-                      unit_str = CoordsToString(value, 1, spec->str, Units[i].allow, suffix);
-                  if (unit_str == NULL)
-                    unit_str = CoordsToString(value, 1, spec->str, mask & ALLOW_ALL, suffix);
+                      break;
+                  CoordsToString(out, value, 1, spec,
+                                 i < N_UNITS ? Units[i].allow : mask & ALLOW_ALL,
+                                 suffix);
                   break;
                 case 'a':
-                  g_string_append (spec, "f");
+                  spec_append (spec, "f");
                   if (suffix == SUFFIX)
-                    g_string_append (spec, " deg");
-                  unit_str = g_strdup_printf (spec->str, (double) va_arg(args, Angle));
+                    spec_append (spec, " deg");
+                  out_format (out, spec, (double) va_arg(args, Angle));
                   break;
                 case '+':
                   mask = va_arg(args, enum e_allow);
@@ -654,26 +839,50 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
                 default:
                   for (i = 0; i < N_UNITS; ++i)
                     if (*fmt == Units[i].printf_code)
-                      unit_str = CoordsToString(value, 1, spec->str, Units[i].allow, suffix);
-                  if (unit_str == NULL)
-                    unit_str = CoordsToString(value, 1, spec->str, ALLOW_ALL, suffix);
+                      break;
+                  CoordsToString(out, value, 1, spec,
+                                 i < N_UNITS ? Units[i].allow : ALLOW_ALL,
+                                 suffix);
                   break;
                 }
               break;
             }
-          if (unit_str != NULL)
-            {
-              g_string_append (string, unit_str);
-              g_free (unit_str);
-            }
         }
       else
-        g_string_append_c (string, *fmt);
+        {
+          /* Copy plain text up to the next specifier in one go */
+          const char *end = strchr (fmt, '%');
+
+          if (end == NULL)
+            end = fmt + strlen (fmt);
+          out_write (out, fmt, end - fmt);
+          fmt = end - 1;
+        }
       ++fmt;
     }
-  g_string_free (spec, TRUE);
-  /* Return just the gchar* part of our string */
-  return g_string_free (string, FALSE);
+}
+
+/*!
+ * \brief Main pcb-printf function.
+ *
+ * This is a printf wrapper that accepts new format specifiers to
+ * output pcb coords as various units. See the comment at the top
+ * of pcb-printf.h for full details.
+ *
+ * \param [in] fmt    Format specifier.
+ * \param [in] args   Arguments to specifier.
+ *
+ * \return A formatted string. Must be freed with g_free.
+ */
+gchar *pcb_vprintf(const char *fmt, va_list args)
+{
+  char buf[PCB_PRINTF_BUF_SIZE];
+  PcbOut out;
+
+  out_init (&out, buf, sizeof buf, NULL, false);
+  pcb_vformat (&out, fmt, args);
+  out_finish (&out);
+  return out.heap ? out.buf : g_strndup (out.buf, out.len);
 }
 
 
@@ -695,50 +904,51 @@ gchar *pcb_vprintf(const char *fmt, va_list args)
  */
 int pcb_snprintf(char *string, size_t size, const char *fmt, ...)
 {
-  gchar *tmp;
-  gsize length;
+  PcbOut out;
 
   va_list args;
   va_start(args, fmt);
 
-  tmp = pcb_vprintf (fmt, args);
-  length = strlen (tmp);
-  strncpy (string, tmp, size);
-  string[size - 1] = '\0';
+  out_init (&out, string, size, NULL, true);
+  pcb_vformat (&out, fmt, args);
+  out_finish (&out);
 
-  g_free (tmp);
   va_end(args);
 
-  return length;
+  return out.total;
 }
 
 /*!
  * \brief Wrapper for pcb_vprintf that outputs to a file.
  *
+ * The text goes through a buffer on the stack, so no memory is
+ * allocated unless a single conversion doesn't fit in it.
+ *
  * \param [in] fh   File to output to.
  * \param [in] fmt  Format specifier.
  *
- * \return The length of the written string.
+ * \return The length of the written string, or a negative value on
+ * error.
  */
 int pcb_fprintf(FILE *fh, const char *fmt, ...)
 {
-  int rv;
-  gchar *tmp;
+  char buf[PCB_PRINTF_BUF_SIZE];
+  PcbOut out;
 
   va_list args;
   va_start(args, fmt);
 
   if (fh == NULL)
-    rv = -1;
-  else
     {
-      tmp = pcb_vprintf (fmt, args);
-      rv = fprintf (fh, "%s", tmp);
-      g_free (tmp);
+      va_end(args);
+      return -1;
     }
-  
+  out_init (&out, buf, sizeof buf, fh, false);
+  pcb_vformat (&out, fmt, args);
+  out_finish (&out);
+
   va_end(args);
-  return rv;
+  return out.failed ? -1 : (int) out.total;
 }
 
 /*!
@@ -750,18 +960,18 @@ int pcb_fprintf(FILE *fh, const char *fmt, ...)
  */
 int pcb_printf(const char *fmt, ...)
 {
-  int rv;
-  gchar *tmp;
+  char buf[PCB_PRINTF_BUF_SIZE];
+  PcbOut out;
 
   va_list args;
   va_start(args, fmt);
 
-  tmp = pcb_vprintf (fmt, args);
-  rv = printf ("%s", tmp);
-  g_free (tmp);
-  
+  out_init (&out, buf, sizeof buf, stdout, false);
+  pcb_vformat (&out, fmt, args);
+  out_finish (&out);
+
   va_end(args);
-  return rv;
+  return out.failed ? -1 : (int) out.total;
 }
 
 /*!
@@ -789,6 +999,7 @@ pcb_printf_register_tests ()
 {
   g_test_add_func ("/pcb-printf/test-unit", pcb_printf_test_unit);
   g_test_add_func ("/pcb-printf/test-printf", pcb_printf_test_printf);
+  g_test_add_func ("/pcb-printf/test-buffers", pcb_printf_test_buffers);
 }
 
 void
@@ -868,4 +1079,38 @@ pcb_printf_test_printf ()
   g_assert_cmpstr (pcb_g_strdup_printf ("%#S", e), ==, "");
 }
 
+void
+pcb_printf_test_buffers ()
+{
+  Coord c = unit_to_coord (get_unit_struct ("mil"), 10.0);
+  char buf[8], *long_str, *s;
+  int len;
+
+  /* pcb_snprintf truncates, but returns the full length */
+  len = pcb_snprintf (buf, sizeof buf, "%$mr / %$mr", c, c);
+  g_assert_cmpint (len, ==, 19);
+  g_assert_cmpstr (buf, ==, "10.00mi");
+  len = pcb_snprintf (NULL, 0, "%$mr", c);
+  g_assert_cmpint (len, ==, 8);
+  s = pcb_g_strdup_printf ("%$mr / %$mr", c, c);
+  g_assert_cmpstr (s, ==, "10.00mil / 10.00mil");
+  g_free (s);
+  s = pcb_g_strdup_printf ("%$mr", c);
+  g_assert_cmpstr (s, ==, "10.00mil");
+  g_free (s);
+
+  /* Output longer than the internal buffer */
+  long_str = g_strnfill (3 * PCB_PRINTF_BUF_SIZE, 'x');
+  s = pcb_g_strdup_printf ("%s %$mr", long_str, c);
+  g_assert_cmpint (strlen (s), ==, 3 * PCB_PRINTF_BUF_SIZE + 9);
+  g_assert_cmpstr (s + 3 * PCB_PRINTF_BUF_SIZE, ==, " 10.00mil");
+  g_free (s);
+  g_free (long_str);
+
+  /* A lone '%' at the end prints nothing */
+  s = pcb_g_strdup_printf ("100%");
+  g_assert_cmpstr (s, ==, "100");
+  g_free (s);
+}
+
 #endif
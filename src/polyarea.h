@@ -80,6 +80,7 @@ typedef struct VNODE VNODE;
 struct CVCList
 {
     double angle;
+    Vector dir; /*!< edge direction, for exact angle comparisons. */
     VNODE *parent;
     CVCList *prev, *next, *head;
     char poly, side;
@@ -185,6 +186,8 @@ void poly_Free(POLYAREA **p);
 void poly_Init(POLYAREA  *p);
 void poly_FreeContours(PLINE **pl);
 BOOLp poly_Valid(POLYAREA *p);
+void poly_DelArea(POLYAREA **p);
+unsigned long poly_AllocCount(void);
 
 enum PolygonBooleanOperation {
 	PBO_UNITE,
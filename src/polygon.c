@@ -114,16 +114,22 @@
 #define SUBTRACT_PIN_VIA_BATCH_SIZE 100
 #define SUBTRACT_LINE_BATCH_SIZE 20
 
-static double rotate_circle_seg[4];
+/*! Rotation matrices for a circle of 4 * i segments. */
+static double rotate_circle_seg[POLY_CIRC_SEGS / 4 + 1][4];
 
 void
 polygon_init (void)
 {
-  double cos_ang = cos (2.0 * M_PI / POLY_CIRC_SEGS_F);
-  double sin_ang = sin (2.0 * M_PI / POLY_CIRC_SEGS_F);
+  int i;
 
-  rotate_circle_seg[0] = cos_ang;  rotate_circle_seg[1] = -sin_ang;
-  rotate_circle_seg[2] = sin_ang;  rotate_circle_seg[3] =  cos_ang;
+  for (i = POLY_CIRC_SEGS_MIN / 4; i <= POLY_CIRC_SEGS / 4; i++)
+    {
+      double cos_ang = cos (2.0 * M_PI / (4 * i));
+      double sin_ang = sin (2.0 * M_PI / (4 * i));
+
+      rotate_circle_seg[i][0] = cos_ang;  rotate_circle_seg[i][1] = -sin_ang;
+      rotate_circle_seg[i][2] = sin_ang;  rotate_circle_seg[i][3] =  cos_ang;
+    }
 }
 
 Cardinal
@@ -209,15 +215,140 @@ add_noholes_polyarea (PLINE *pline, void *user_data)
   poly->NoHoles = pline;
 }
 
+/*!
+ * \brief Re-dice only the NoHoles pieces in the polygon's dirty region.
+ *
+ * The region is first grown until no remaining piece crosses it, so
+ * the pieces outside it can be kept as they are and the inside can be
+ * diced on its own.
+ *
+ * \return false if the result doesn't add up to the polygon, e.g. when
+ * a change split off the main island, or if the polygon has a hole too
+ * small to tell a missing one apart from rounding, in which case the
+ * caller has to start over.
+ */
+static bool
+update_noholes (PolygonType *poly)
+{
+  BoxType region = poly->NoHolesDirty;
+  PLINE **link, *pl, *stale = NULL;
+  VNODE *v;
+  double area, expect, slack, smallest;
+  bool grown;
+
+  if (!poly->Clipped)
+    return false;
+
+  /* NB: contour boxes have xmax and ymax one past the last vertex */
+  do
+    {
+      grown = false;
+      for (link = &poly->NoHoles; (pl = *link) != NULL;)
+        {
+          if (pl->xmax - 1 <= region.X1 || pl->xmin >= region.X2 ||
+              pl->ymax - 1 <= region.Y1 || pl->ymin >= region.Y2)
+            {
+              link = &pl->next;
+              continue;
+            }
+          *link = pl->next;
+          pl->next = stale;
+          stale = pl;
+          if (pl->xmin < region.X1)
+            region.X1 = pl->xmin, grown = true;
+          if (pl->xmax - 1 > region.X2)
+            region.X2 = pl->xmax - 1, grown = true;
+          if (pl->ymin < region.Y1)
+            region.Y1 = pl->ymin, grown = true;
+          if (pl->ymax - 1 > region.Y2)
+            region.Y2 = pl->ymax - 1, grown = true;
+        }
+    }
+  while (grown);
+  poly_FreeContours (&stale);
+
+  NoHolesPolygonDicer (poly, &region, add_noholes_polyarea, poly);
+
+  /* The cuts are axis aligned, but where one crosses a sloped edge the
+   * new vertex is rounded to the grid, which moves the edge by at most
+   * half a unit.  A quarter of the sloped edges' length bounds that.
+   */
+  area = slack = 0;
+  for (pl = poly->NoHoles; pl != NULL; pl = pl->next)
+    {
+      area += pl->area;
+      v = &pl->head;
+      do
+        if (v->next->point[0] != v->point[0] &&
+            v->next->point[1] != v->point[1])
+          slack += fabs ((double) v->next->point[0] - v->point[0]) +
+                   fabs ((double) v->next->point[1] - v->point[1]);
+      while ((v = v->next) != &pl->head);
+    }
+  slack /= 4;
+
+  expect = poly->Clipped->contours->area;
+  smallest = expect;
+  for (pl = poly->Clipped->contours->next; pl != NULL; pl = pl->next)
+    {
+      expect -= pl->area;
+      MAKEMIN (smallest, pl->area);
+    }
+
+  /* A piece that missed a clearance is off by at least that hole, so
+   * the slack has to stay well below the smallest one to tell.
+   */
+  if (2 * slack >= smallest)
+    return false;
+  return fabs (area - expect) <= slack;
+}
+
+/*!
+ * \brief Bring the NoHoles pieces of a polygon up to date.
+ *
+ * If the pieces were only invalidated in a region, just that part is
+ * diced again, otherwise the whole polygon is.
+ */
 void
 ComputeNoHoles (PolygonType *poly)
 {
+  if (poly->NoHolesValid && NOHOLES_DIRTY (poly) && update_noholes (poly))
+    {
+      poly->NoHolesDirty.X1 = poly->NoHolesDirty.X2 = 0;
+      return;
+    }
   poly_FreeContours (&poly->NoHoles);
   if (poly->Clipped)
     NoHolesPolygonDicer (poly, NULL, add_noholes_polyarea, poly);
   else
     printf ("Compute_noholes caught poly->Clipped = NULL\n");
   poly->NoHolesValid = 1;
+  poly->NoHolesDirty.X1 = poly->NoHolesDirty.X2 = 0;
+}
+
+/*!
+ * \brief Mark the NoHoles pieces of a polygon as out of date.
+ *
+ * With a region, only the pieces overlapping it are recomputed by the
+ * next ComputeNoHoles(), otherwise all of them are.
+ */
+void
+InvalidateNoHoles (PolygonType *poly, const BoxType *region)
+{
+  if (region == NULL || !poly->NoHolesValid)
+    {
+      poly->NoHolesValid = 0;
+      return;
+    }
+  if (!NOHOLES_DIRTY (poly))
+    poly->NoHolesDirty = *region;
+  else
+    {
+      MAKEMIN (poly->NoHolesDirty.X1, region->X1);
+      MAKEMIN (poly->NoHolesDirty.Y1, region->Y1);
+      MAKEMAX (poly->NoHolesDirty.X2, region->X2);
+      MAKEMAX (poly->NoHolesDirty.Y2, region->Y2);
+    }
 }
 
 static POLYAREA *
@@ -417,6 +548,44 @@ OctagonPoly (Coord x, Coord y, Coord radius)
   return ContourToPoly (contour);
 }
 
+/*!
+ * \brief Number of segments used for a full circle of the given radius.
+ *
+ * The outlining polygon sticks out of the circle by about
+ * radius * (pi / segs)^2 / 2, so take the fewest segments (a multiple
+ * of 4, so that half and quarter circles come out even) that keep this
+ * within Settings.PolyTolerance.  A tolerance of 0 always gives
+ * POLY_CIRC_SEGS.
+ */
+int
+poly_circ_segs (Coord radius)
+{
+  double segs;
+
+  if (Settings.PolyTolerance <= 0 || radius <= 0)
+    return POLY_CIRC_SEGS;
+  segs = M_PI * sqrt ((double) radius / (2.0 * Settings.PolyTolerance));
+  if (segs >= POLY_CIRC_SEGS)
+    return POLY_CIRC_SEGS;
+  return MAX (4 * (int) ceil (segs / 4), POLY_CIRC_SEGS_MIN);
+}
+
+/*!
+ * \brief How far the polygon approximating a circle of the given radius
+ * can reach from its centre.
+ *
+ * This grows with the radius, so it is safe to use for bounding boxes
+ * of anything whose round parts are no larger than radius.
+ */
+Coord
+poly_circ_outline (Coord radius)
+{
+  /* with no tolerance, this is the same as it always was */
+  double outline = radius * POLY_CIRC_RADIUS_ADJ;
+
+  return MAX (outline, (double) radius + Settings.PolyTolerance) + 0.5;
+}
+
 /*!
  * \brief Add vertices in a fractional-circle starting from v 
  * centered at X, Y and going counter-clockwise.
@@ -429,21 +598,27 @@ OctagonPoly (Coord x, Coord y, Coord radius)
 void
 frac_circle (PLINE * c, Coord X, Coord Y, Vector v, int fraction)
 {
-  double e1, e2, t1;
-  int i, range;
+  double e1, e2, t1, adj;
+  double *rot;
+  int i, range, segs;
 
   poly_InclVertex (c->head.prev, poly_CreateNode (v));
   /* move vector to origin */
-  e1 = (v[0] - X) * POLY_CIRC_RADIUS_ADJ;
-  e2 = (v[1] - Y) * POLY_CIRC_RADIUS_ADJ;
+  e1 = v[0] - X;
+  e2 = v[1] - Y;
+  segs = poly_circ_segs (hypot (e1, e2));
+  rot = rotate_circle_seg[segs / 4];
+  adj = POLY_CIRC_ADJ ((double) segs);
+  e1 *= adj;
+  e2 *= adj;
 
   /* NB: the caller adds the last vertex, hence the -1 */
-  range = POLY_CIRC_SEGS / fraction - 1;
+  range = segs / fraction - 1;
   for (i = 0; i < range; i++)
     {
       /* rotate the vector */
-      t1 = rotate_circle_seg[0] * e1 + rotate_circle_seg[1] * e2;
-      e2 = rotate_circle_seg[2] * e1 + rotate_circle_seg[3] * e2;
+      t1 = rot[0] * e1 + rot[1] * e2;
+      e2 = rot[2] * e1 + rot[3] * e2;
       e1 = t1;
       v[0] = X + ROUND (e1);
       v[1] = Y + ROUND (e2);
@@ -536,7 +711,16 @@ ArcPolyNoIntersect (ArcType * a, Coord thick)
     segs = MAX (segs, a->Delta * M_PI / 360 *
                       sqrt (hypot (rx, ry) /
                             POLY_ARC_MAX_DEVIATION / 2 / thick));
-  segs = MAX(segs, a->Delta / ARC_ANGLE);
+  /* Don't go over ARC_ANGLE per segment, unless that is finer than the
+   * polygon tolerance needs at the outer radius.
+   */
+  if (Settings.PolyTolerance > 0)
+    segs = MAX (segs, MIN (a->Delta / ARC_ANGLE,
+                           ceil (a->Delta * M_PI / 360 *
+                                 sqrt ((a->Width + half) /
+                                       (2.0 * Settings.PolyTolerance)))));
+  else
+    segs = MAX(segs, a->Delta / ARC_ANGLE);
 
   ang = a->StartAngle;
   da = (1.0 * a->Delta) / segs;
@@ -1128,7 +1312,7 @@ clearPoly (DataType *Data, LayerType *Layer, PolygonType * polygon,
       r += r_search (Data->pin_tree, &region, NULL, pin_sub_callback, &info);
       subtract_accumulated (&info, polygon);
     }
-  polygon->NoHolesValid = 0;
+  InvalidateNoHoles (polygon, here ? &region : NULL);
   return r;
 }
 
@@ -1287,7 +1471,7 @@ InitClip (DataType *Data, LayerType *layer, PolygonType * p)
   if (TEST_FLAG (CLEARPOLYFLAG, p))
     clearPoly (Data, layer, p, NULL, 0);
   else
-    p->NoHolesValid = 0;
+    InvalidateNoHoles (p, NULL);
   return 1;
 }
 
@@ -1546,32 +1730,32 @@ subtract_plow (DataType *Data, LayerType *Layer, PolygonType *Polygon,
     {
     case PIN_TYPE:
       SubtractPin (Data, (PinType *) ptr2, Layer, Polygon);
-      Polygon->NoHolesValid = 0;
+      InvalidateNoHoles (Polygon, &((AnyObjectType *) ptr2)->BoundingBox);
       return 1;
     case VIA_TYPE:
       via = (PinType *) ptr2;
       if (!VIA_IS_BURIED (via) || VIA_ON_LAYER (via, layer_n))
         {
           SubtractPin (Data, via, Layer, Polygon);
-          Polygon->NoHolesValid = 0;
+          InvalidateNoHoles (Polygon, &((AnyObjectType *) ptr2)->BoundingBox);
           return 1;
 	}
       break;
     case LINE_TYPE:
       SubtractLine ((LineType *) ptr2, Polygon);
-      Polygon->NoHolesValid = 0;
+      InvalidateNoHoles (Polygon, &((AnyObjectType *) ptr2)->BoundingBox);
       return 1;
     case ARC_TYPE:
       SubtractArc ((ArcType *) ptr2, Polygon);
-      Polygon->NoHolesValid = 0;
+      InvalidateNoHoles (Polygon, &((AnyObjectType *) ptr2)->BoundingBox);
       return 1;
     case PAD_TYPE:
       SubtractPad ((PadType *) ptr2, Polygon);
-      Polygon->NoHolesValid = 0;
+      InvalidateNoHoles (Polygon, &((AnyObjectType *) ptr2)->BoundingBox);
       return 1;
     case TEXT_TYPE:
       SubtractText ((TextType *) ptr2, Polygon);
-      Polygon->NoHolesValid = 0;
+      InvalidateNoHoles (Polygon, &((AnyObjectType *) ptr2)->BoundingBox);
       return 1;
     }
   return 0;
@@ -1958,8 +2142,7 @@ MorphPolygon (LayerType *layer, PolygonType *poly)
           POLYAREA *t = p;
 
           p = p->f;
-          poly_DelContour (&t->contours);
-          free (t);
+          poly_DelArea (&t);
         }
     }
   while (p != start);
@@ -39,16 +39,24 @@
 
 /* Implementation constants */
 
+/*!
+ * \brief Number of segments of a full circle.
+ *
+ * Circles get between POLY_CIRC_SEGS_MIN and POLY_CIRC_SEGS segments,
+ * a multiple of 4, depending on their radius and
+ * Settings.PolyTolerance, see poly_circ_segs().
+ */
 #define POLY_CIRC_SEGS 40
 #define POLY_CIRC_SEGS_F ((float)POLY_CIRC_SEGS)
+#define POLY_CIRC_SEGS_MIN 8
 
 /*!
  * \brief Adjustment to make the segments outline the circle rather than
  * connect points on the circle:
  * \f$ 1 - cos ( \frac {\alpha} {2} ) < \frac { ( \frac {\alpha} {2} ) ^ 2 } {2} \f$
  */
-#define POLY_CIRC_RADIUS_ADJ (1.0 + M_PI / POLY_CIRC_SEGS_F * \
-                                    M_PI / POLY_CIRC_SEGS_F / 2.0)
+#define POLY_CIRC_ADJ(segs) (1.0 + M_PI / (segs) * M_PI / (segs) / 2.0)
+#define POLY_CIRC_RADIUS_ADJ POLY_CIRC_ADJ (POLY_CIRC_SEGS_F)
 
 /*!
  * \brief Polygon diverges from modelled arc no more than
@@ -56,6 +64,12 @@
  */
 #define POLY_ARC_MAX_DEVIATION 0.02
 
+/*!
+ * \brief True if some of the (otherwise valid) NoHoles pieces of a
+ * polygon need recomputing.
+ */
+#define NOHOLES_DIRTY(p) ((p)->NoHolesDirty.X2 > (p)->NoHolesDirty.X1)
+
 /* Prototypes */
 
 void polygon_init (void);
@@ -76,6 +90,7 @@ int PlowsPolygon (DataType *, int, void *, void *,
                   int (*callback) (DataType *, LayerType *, PolygonType *, int, void *, void *, void *),
                   void *userdata);
 void ComputeNoHoles (PolygonType *poly);
+void InvalidateNoHoles (PolygonType *poly, const BoxType *region);
 POLYAREA * original_poly(PolygonType *);
 POLYAREA * ContourToPoly (PLINE *);
 POLYAREA * PolygonToPoly (PolygonType *);
@@ -87,6 +102,8 @@ POLYAREA * ArcPoly(ArcType *l, Coord thick);
 POLYAREA * PinPoly(PinType *l, Coord thick, Coord clear);
 POLYAREA * BoxPolyBloated (BoxType *box, Coord radius);
 void frac_circle (PLINE *, Coord, Coord, Vector, int);
+int poly_circ_segs (Coord radius);
+Coord poly_circ_outline (Coord radius);
 int InitClip(DataType *d, LayerType *l, PolygonType *p);
 void RestoreToPolygon(DataType *, int, void *, void *);
 void ClearFromPolygon(DataType *, int, void *, void *);
@@ -77,6 +77,7 @@
 #include	<stdio.h>
 #include	<setjmp.h>
 #include	<math.h>
+#include	<stddef.h>
 #include	<string.h>
 
 #include "global.h"
@@ -89,6 +90,16 @@
 #define EPSILON (1E-8)
 #define IsZero(a, b) (fabs((a) - (b)) < EPSILON)
 
+/* Error bound, relative to |ax * by| + |ay * bx|, of a 2x2 determinant of
+ * integers evaluated in double precision (3 units in the last place).
+ */
+#define DET2_ERRBOUND (3.3306690738754716E-16)
+
+/* The CVC pseudo-angles are computed with a handful of rounding errors of
+ * 2^-53 each; angles closer than this are compared exactly.
+ */
+#define CVC_ANGLE_FILTER (1E-14)
+
 /*              L o n g   V e c t o r   S t u f f                    */
 
 #define Vcopy(a,b) {(a)[0]=(b)[0];(a)[1]=(b)[1];}
@@ -106,6 +117,9 @@ double vect_len2 (Vector v1);
 int vect_inters2 (Vector A, Vector B, Vector C, Vector D, Vector S1,
 		  Vector S2);
 
+static int det2_sign (Coord ax, Coord ay, Coord bx, Coord by);
+static int vect_orient (Vector a, Vector b, Vector c);
+
 /* note that a vertex v's Flags.status represents the edge defined by
  * v to v->next (i.e. the edge is forward of v)
  */
@@ -123,10 +137,149 @@ int vect_inters2 (Vector A, Vector B, Vector C, Vector D, Vector S1,
 
 #define error(code)  longjmp(*(e), code)
 
-#define MemGet(ptr, type) \
-  if (UNLIKELY (((ptr) = (type *)malloc(sizeof(type))) == NULL))	\
+#define MemGet(ptr, type, pool) \
+  if (UNLIKELY (((ptr) = (type *)pool_get(&(pool))) == NULL))	\
     error(err_no_memory);
 
+/* Number of allocations made by the polygon engine so far; reported by
+ * the benchmark in polybench.c.
+ */
+static unsigned long alloc_count = 0;
+
+static void *
+poly_malloc (size_t size)
+{
+  alloc_count++;
+  return malloc (size);
+}
+
+/*!
+ * \brief Fixed-size object pool.
+ *
+ * Clipping a large pour creates and destroys millions of nodes, edge
+ * descriptors and segments, so these are carved out of slabs and
+ * recycled through a free list instead of going through malloc one by
+ * one.  Slabs are kept for the life of the program; the engine is only
+ * used from the main thread, so the pools are not locked.
+ */
+typedef struct poly_pool
+{
+  size_t size;			/*!< object size, at least a pointer. */
+  void *free_list;		/*!< recycled objects, linked through their first word. */
+} poly_pool;
+
+#define POLY_POOL(type) { sizeof (type) < sizeof (void *) ? sizeof (void *) : sizeof (type), NULL }
+
+/*! Objects carved out of each slab. */
+#define POLY_POOL_SLAB 256
+
+static void *
+pool_get (poly_pool * pool)
+{
+  void *obj = pool->free_list;
+
+  if (UNLIKELY (obj == NULL))
+    {
+      char *slab = (char *) poly_malloc (pool->size * POLY_POOL_SLAB);
+      int i;
+
+      if (slab == NULL)
+	return NULL;
+      for (i = POLY_POOL_SLAB - 1; i > 0; i--)
+	{
+	  *(void **) (slab + i * pool->size) = pool->free_list;
+	  pool->free_list = slab + i * pool->size;
+	}
+      return slab;
+    }
+  pool->free_list = *(void **) obj;
+  return obj;
+}
+
+static void *
+pool_get0 (poly_pool * pool)
+{
+  void *obj = pool_get (pool);
+
+  if (obj != NULL)
+    memset (obj, 0, pool->size);
+  return obj;
+}
+
+static void
+pool_put (poly_pool * pool, void *obj)
+{
+  if (obj == NULL)
+    return;
+  *(void **) obj = pool->free_list;
+  pool->free_list = obj;
+}
+
+/*!
+ * \brief Scratch arena for the temporaries of one boolean operation.
+ *
+ * Deferred node insertions and the hole bookkeeping of InsertHoles
+ * only live until the operation returns (or longjmps out), so they are
+ * bump-allocated here and dropped wholesale by scratch_reset() at the
+ * start of the next operation.  The first chunk is kept around for
+ * reuse.
+ */
+typedef struct scratch_chunk scratch_chunk;
+struct scratch_chunk
+{
+  scratch_chunk *next;
+  size_t size, used;
+  double data[1];		/*!< aligned start of the usable space. */
+};
+
+#define SCRATCH_CHUNK_SIZE (64 * 1024)
+
+static scratch_chunk *scratch = NULL;
+
+static void *
+scratch_alloc (size_t size)
+{
+  scratch_chunk *c = scratch;
+
+  size = (size + sizeof (double) - 1) & ~(sizeof (double) - 1);
+  if (c == NULL || c->used + size > c->size)
+    {
+      size_t want = MAX (size, (size_t) SCRATCH_CHUNK_SIZE);
+
+      c = (scratch_chunk *) poly_malloc (offsetof (scratch_chunk, data) + want);
+      if (c == NULL)
+	return NULL;
+      c->size = want;
+      c->used = 0;
+      c->next = scratch;
+      scratch = c;
+    }
+  c->used += size;
+  return (char *) c->data + c->used - size;
+}
+
+static void
+scratch_reset (void)
+{
+  scratch_chunk *c;
+
+  if (scratch == NULL)
+    return;
+  /* keep only the oldest chunk, which is the one at the end */
+  while (scratch->next != NULL)
+    {
+      c = scratch;
+      scratch = c->next;
+      free (c);
+    }
+  scratch->used = 0;
+}
+
+static poly_pool vnode_pool = POLY_POOL (VNODE);
+static poly_pool pline_pool = POLY_POOL (PLINE);
+static poly_pool area_pool = POLY_POOL (POLYAREA);
+static poly_pool cvc_pool = POLY_POOL (CVCList);
+
 #undef DEBUG_LABEL
 #undef DEBUG_ALL_LABELS
 #undef DEBUG_JUMP
@@ -240,7 +393,7 @@ node_add_single (VNODE * dest, Vector po)
 static CVCList *
 new_descriptor (VNODE * a, char poly, char side)
 {
-  CVCList *l = (CVCList *) malloc (sizeof (CVCList));
+  CVCList *l = (CVCList *) pool_get (&cvc_pool);
   Vector v;
   register double ang, dx, dy;
 
@@ -288,6 +441,7 @@ new_descriptor (VNODE * a, char poly, char side)
   else if (v[0] >= 0 && v[1] < 0)
     ang = 4.0 - ang;		/* 4th quadrant */
   l->angle = ang;
+  Vcpy2 (l->dir, v);
   assert (ang >= 0.0 && ang <= 4.0);
 #ifdef DEBUG_ANGLE
   DEBUGP ("node on %c at %#mD assigned angle %g on side %c\n", poly,
@@ -296,6 +450,51 @@ new_descriptor (VNODE * a, char poly, char side)
   return l;
 }
 
+/*!
+ * \brief Quadrant (0 to 3) used by new_descriptor for a direction.
+ */
+static int
+cvc_quadrant (Vector v)
+{
+  if (v[0] < 0)
+    return (v[1] >= 0) ? 1 : 2;
+  return (v[1] >= 0) ? 0 : 3;
+}
+
+/*!
+ * \brief Compare the pseudo-angles of two descriptors.
+ *
+ * The double angle is only a filter: when the two angles are too close
+ * to be told apart in floating point, the edge directions themselves are
+ * compared exactly, so collinear edges always compare equal and distinct
+ * edges never do.
+ *
+ * \return -1, 0 or +1 like strcmp.
+ */
+static int
+cvc_angle_cmp (CVCList * a, CVCList * b)
+{
+  int qa, qb, s;
+
+  if (a->angle < b->angle - CVC_ANGLE_FILTER)
+    return -1;
+  if (a->angle > b->angle + CVC_ANGLE_FILTER)
+    return 1;
+
+  qa = cvc_quadrant (a->dir);
+  qb = cvc_quadrant (b->dir);
+  if (qa != qb)
+    return (qa < qb) ? -1 : 1;
+
+  /* Within a quadrant the angle is |dy| / (|dx| + |dy|), mirrored in the
+   * 2nd and 4th quadrants, so comparing |ay| * |bx| with |by| * |ax| gives
+   * the same order.
+   */
+  s = det2_sign (ABS (b->dir[0]), ABS (b->dir[1]),
+		 ABS (a->dir[0]), ABS (a->dir[1]));
+  return (qa & 1) ? -s : s;
+}
+
 /*!
  * \brief insert_descriptor.
  *
@@ -352,12 +551,13 @@ insert_descriptor (VNODE * a, char poly, char side, CVCList * start)
   l = big = small = start;
   do
     {
-      if (l->next->angle < l->angle)	/* find start/end of list */
+      if (cvc_angle_cmp (l->next, l) < 0)	/* find start/end of list */
 	{
 	  small = l->next;
 	  big = l;
 	}
-      else if (newone->angle >= l->angle && newone->angle <= l->next->angle)
+      else if (cvc_angle_cmp (newone, l) >= 0 &&
+	       cvc_angle_cmp (newone, l->next) <= 0)
 	{
 	  /* insert new cvc if it lies between existing points */
 	  newone->prev = l;
@@ -368,14 +568,14 @@ insert_descriptor (VNODE * a, char poly, char side, CVCList * start)
     }
   while ((l = l->next) != start);
   /* didn't find it between points, it must go on an end */
-  if (big->angle <= newone->angle)
+  if (cvc_angle_cmp (big, newone) <= 0)
     {
       newone->prev = big;
       newone->next = big->next;
       big->next = big->next->prev = newone;
       return newone;
     }
-  assert (small->angle >= newone->angle);
+  assert (cvc_angle_cmp (small, newone) >= 0);
   newone->next = small;
   newone->prev = small->prev;
   small->prev = small->prev->next = newone;
@@ -435,7 +635,7 @@ node_label (VNODE * pn)
    * check for shared edges (that could be prev or next in the list since the angles are equal)
    * and check if this edge (pn -> pn->next) is found between the other poly's entry and exit
    */
-  if (pn->cvc_next->angle == pn->cvc_next->prev->angle)
+  if (cvc_angle_cmp (pn->cvc_next, pn->cvc_next->prev) == 0)
     l = pn->cvc_next->prev;
   else
     l = pn->cvc_next->next;
@@ -461,7 +661,7 @@ node_label (VNODE * pn)
 	}
       else
 	{
-	  if (l->angle == pn->cvc_next->angle)
+	  if (cvc_angle_cmp (l, pn->cvc_next) == 0)
 	    {
 	      assert (l->parent->next->point[0] == pn->next->point[0] &&
 		      l->parent->next->point[1] == pn->next->point[1]);
@@ -541,6 +741,11 @@ typedef struct seg
   int intersected;
 } seg;
 
+/*! Segments are owned by the contour's edge tree, which is inserted
+ * unmanaged so that poly_DelContour can hand them back to this pool.
+ */
+static poly_pool seg_pool = POLY_POOL (seg);
+
 typedef struct _insert_node_task insert_node_task;
 
 struct _insert_node_task
@@ -584,7 +789,7 @@ adjust_tree (rtree_t * tree, struct seg *s)
 {
   struct seg *q;
 
-  q = (seg *)malloc (sizeof (struct seg));
+  q = (seg *)pool_get (&seg_pool);
   if (!q)
     return 1;
   q->intersected = 0;
@@ -594,8 +799,8 @@ adjust_tree (rtree_t * tree, struct seg *s)
   q->box.X2 = max (q->v->point[0], q->v->next->point[0]) + 1;
   q->box.Y1 = min (q->v->point[1], q->v->next->point[1]);
   q->box.Y2 = max (q->v->point[1], q->v->next->point[1]) + 1;
-  r_insert_entry (tree, (const BoxType *) q, 1);
-  q = (seg *)malloc (sizeof (struct seg));
+  r_insert_entry (tree, (const BoxType *) q, 0);
+  q = (seg *)pool_get (&seg_pool);
   if (!q)
     return 1;
   q->intersected = 0;
@@ -605,8 +810,9 @@ adjust_tree (rtree_t * tree, struct seg *s)
   q->box.X2 = max (q->v->point[0], q->v->next->point[0]) + 1;
   q->box.Y1 = min (q->v->point[1], q->v->next->point[1]);
   q->box.Y2 = max (q->v->point[1], q->v->next->point[1]) + 1;
-  r_insert_entry (tree, (const BoxType *) q, 1);
+  r_insert_entry (tree, (const BoxType *) q, 0);
   r_delete_entry (tree, (const BoxType *) s);
+  pool_put (&seg_pool, s);
   return 0;
 }
 
@@ -651,7 +857,7 @@ seg_in_region (const BoxType * b, void *cl)
 static insert_node_task *
 prepend_insert_node_task (insert_node_task *list, seg *seg, VNODE *new_node)
 {
-  insert_node_task *task = (insert_node_task *)malloc (sizeof (*task));
+  insert_node_task *task = (insert_node_task *)scratch_alloc (sizeof (*task));
   task->node_seg = seg;
   task->new_node = new_node;
   task->next = list;
@@ -765,7 +971,7 @@ make_edge_tree (PLINE * pb)
   bv = &pb->head;
   do
     {
-      s = (seg *)malloc (sizeof (struct seg));
+      s = (seg *)pool_get (&seg_pool);
       s->intersected = 0;
 
       /* Generate a bounding box for the current segment */
@@ -799,7 +1005,7 @@ make_edge_tree (PLINE * pb)
       s->p = pb;
 
       /* Add the segment to the rtree. */
-      r_insert_entry (ans, (const BoxType *) s, 1);
+      r_insert_entry (ans, (const BoxType *) s, 0);
     }
   /* Move to the next point in the contour. */
   while ((bv = bv->next) != &pb->head);
@@ -1009,7 +1215,6 @@ intersect_impl (jmp_buf * jb, POLYAREA * b, POLYAREA * a, int add)
 
     need_restart = 1; /* Any new nodes could intersect */
 
-    free (task);
     task = next;
   }
 
@@ -1293,13 +1498,13 @@ InsCntr (jmp_buf * e, PLINE * c, POLYAREA ** dst)
 
   if (*dst == NULL)
     {
-      MemGet (*dst, POLYAREA);
+      MemGet (*dst, POLYAREA, area_pool);
       (*dst)->f = (*dst)->b = *dst;
       newp = *dst;
     }
   else
     {
-      MemGet (newp, POLYAREA);
+      MemGet (newp, POLYAREA, area_pool);
       newp->f = *dst;
       newp->b = (*dst)->b;
       newp->f->b = newp->b->f = newp;
@@ -1439,7 +1644,7 @@ InsertHoles (jmp_buf * e, POLYAREA * dest, PLINE ** src)
 
   /* make a polyarea info table */
   /* make an rtree of polyarea info table */
-  all_pa_info = (struct polyarea_info *) malloc (sizeof (struct polyarea_info) * num_polyareas);
+  all_pa_info = (struct polyarea_info *) scratch_alloc (sizeof (struct polyarea_info) * num_polyareas);
   tree = r_create_tree (NULL, 0, 0);
   i = 0;
   curc = dest;
@@ -1563,7 +1768,6 @@ InsertHoles (jmp_buf * e, POLYAREA * dest, PLINE ** src)
 	}
     }
   r_destroy_tree (&tree);
-  free (all_pa_info);
 }				/* InsertHoles */
 
 
@@ -2393,6 +2597,7 @@ Touching (POLYAREA * a, POLYAREA * b)
   jmp_buf e;
   int code;
 
+  scratch_reset ();
   if ((code = setjmp (e)) == 0)
     {
 #ifdef DEBUG
@@ -2477,6 +2682,7 @@ poly_Boolean_free (POLYAREA * ai, POLYAREA * bi, POLYAREA ** res, int action)
 	}
     }
 
+  scratch_reset ();
   if ((code = setjmp (e)) == 0)
     {
 #ifdef DEBUG
@@ -2565,6 +2771,7 @@ poly_AndSubtract_free (POLYAREA * ai, POLYAREA * bi,
   *aandb = NULL;
   *aminusb = NULL;
 
+  scratch_reset ();
   if ((code = setjmp (e)) == 0)
     {
 
@@ -2640,7 +2847,7 @@ poly_CreateNode (Vector v)
   Coord *c;
 
   assert (v);
-  res = (VNODE *) calloc (1, sizeof (VNODE));
+  res = (VNODE *) pool_get0 (&vnode_pool);
   if (res == NULL)
     /* Couldn't allocate memory */
     return NULL;
@@ -2687,7 +2894,7 @@ poly_NewContour (Vector v)
 {
   PLINE *res;
 
-  res = (PLINE *) calloc (1, sizeof (PLINE));
+  res = (PLINE *) pool_get0 (&pline_pool);
   if (res == NULL)
     /* Failed to allocate memory */
     return NULL;
@@ -2715,11 +2922,18 @@ poly_ClrContour (PLINE * c)
   while ((cur = c->head.next) != &c->head)
     {
       poly_ExclVertex (cur);
-      free (cur);
+      pool_put (&vnode_pool, cur);
     }
   poly_IniContour (c);
 }
 
+static int
+free_seg_cb (const BoxType * b, void *cl)
+{
+  pool_put (&seg_pool, (void *) b);
+  return 1;
+}
+
 void
 poly_DelContour (PLINE ** c)
 {
@@ -2732,23 +2946,24 @@ poly_DelContour (PLINE ** c)
       prev = cur->prev;
       if (cur->cvc_next != NULL)
 	{
-	  free (cur->cvc_next);
-	  free (cur->cvc_prev);
+	  pool_put (&cvc_pool, cur->cvc_next);
+	  pool_put (&cvc_pool, cur->cvc_prev);
 	}
-      free (cur);
+      pool_put (&vnode_pool, cur);
     }
   if ((*c)->head.cvc_next != NULL)
     {
-      free ((*c)->head.cvc_next);
-      free ((*c)->head.cvc_prev);
+      pool_put (&cvc_pool, (*c)->head.cvc_next);
+      pool_put (&cvc_pool, (*c)->head.cvc_prev);
     }
   /*! \todo FIXME -- strict aliasing violation. */
   if ((*c)->tree)
     {
       rtree_t *r = (*c)->tree;
+      r_search (r, NULL, NULL, free_seg_cb, NULL);
       r_destroy_tree (&r);
     }
-  free (*c), *c = NULL;
+  pool_put (&pline_pool, *c), *c = NULL;
 }
 
 /*!
@@ -2777,10 +2992,10 @@ poly_PreContour (PLINE * C, BOOLp optimize)
        * */
 	  Vsub2 (p1, c->point, p->point);
 	  Vsub2 (p2, c->next->point, c->point);
-	  if (vect_det2 (p1, p2) == 0)
+	  if (det2_sign (p1[0], p1[1], p2[0], p2[1]) == 0)
       {
 	    poly_ExclVertex (c);
-	    free (c);
+	    pool_put (&vnode_pool, c);
 	    c = p;
       }
 	} /* for (each vertex) */
@@ -2886,8 +3101,8 @@ poly_ExclVertex (VNODE * node)
   assert (node != NULL);
   if (node->cvc_next)
     {
-      free (node->cvc_next);
-      free (node->cvc_prev);
+      pool_put (&cvc_pool, node->cvc_next);
+      pool_put (&cvc_pool, node->cvc_prev);
     }
   node->prev->next = node->next;
   node->next->prev = node->prev;
@@ -2915,7 +3130,7 @@ poly_InclVertex (VNODE * after, VNODE * node)
       VNODE *t = node->prev;
       t->prev->next = node;
       node->prev = t->prev;
-      free (t);
+      pool_put (&vnode_pool, t);
     }
 }
 
@@ -2954,7 +3169,7 @@ poly_Copy0 (POLYAREA ** dst, const POLYAREA * src)
 {
   *dst = NULL;
   if (src != NULL)
-    *dst = (POLYAREA *)calloc (1, sizeof (POLYAREA));
+    *dst = (POLYAREA *)pool_get0 (&area_pool);
   if (*dst == NULL)
     return FALSE;
   (*dst)->contour_tree = r_create_tree (NULL, 0, 0);
@@ -3243,35 +3458,19 @@ dot (Vector A, Vector B)
  * \brief Compute whether point is inside a triangle formed by 3 other
  * points.
  *
- * Algorithm from http://www.blackpawn.com/texts/pointinpoly/default.html.
+ * The point is strictly inside when it lies on the same side of all
+ * three edges as the opposite vertex, which needs only the exact
+ * orientation predicate.
  */
 static int
 point_in_triangle (Vector A, Vector B, Vector C, Vector P)
 {
-  Vector v0, v1, v2;
-  double dot00, dot01, dot02, dot11, dot12;
-  double invDenom;
-  double u, v;
+  int o = vect_orient (A, B, C);
 
-  /* Compute vectors */
-  v0[0] = C[0] - A[0];  v0[1] = C[1] - A[1];
-  v1[0] = B[0] - A[0];  v1[1] = B[1] - A[1];
-  v2[0] = P[0] - A[0];  v2[1] = P[1] - A[1];
-
-  /* Compute dot products */
-  dot00 = dot (v0, v0);
-  dot01 = dot (v0, v1);
-  dot02 = dot (v0, v2);
-  dot11 = dot (v1, v1);
-  dot12 = dot (v1, v2);
-
-  /* Compute barycentric coordinates */
-  invDenom = 1. / (dot00 * dot11 - dot01 * dot01);
-  u = (dot11 * dot02 - dot01 * dot12) * invDenom;
-  v = (dot00 * dot12 - dot01 * dot02) * invDenom;
-
-  /* Check if point is in triangle */
-  return (u > 0.0) && (v > 0.0) && (u + v < 1.0);
+  return o != 0 &&
+    vect_orient (A, B, P) == o &&
+    vect_orient (B, C, P) == o &&
+    vect_orient (C, A, P) == o;
 }
 
 
@@ -3335,15 +3534,18 @@ poly_ComputeInteriorPoint (PLINE *poly, Vector v)
   pt1 = &poly->head;
   do
     {
-      double dot_product;
+      int convex;
 
       pt2 = pt1->next;
       pt3 = pt2->next;
 
-      dot_product = dot_orthogonal_to_direction (pt1->point, pt2->point,
-                                                 pt3->point, pt2->point);
+      /* Sign of dot_orthogonal_to_direction (pt1, pt2, pt3, pt2) */
+      convex = det2_sign (pt2->point[0] - pt3->point[0],
+                          pt2->point[1] - pt3->point[1],
+                          pt2->point[0] - pt1->point[0],
+                          pt2->point[1] - pt1->point[1]);
 
-      if (dot_product * dir > 0.)
+      if (convex * dir > 0.)
         break;
     }
   while ((pt1 = pt1->next) != &poly->head);
@@ -3421,7 +3623,7 @@ poly_Create (void)
 {
   POLYAREA *res;
 
-  if ((res = (POLYAREA *)malloc (sizeof (POLYAREA))) != NULL)
+  if ((res = (POLYAREA *)pool_get (&area_pool)) != NULL)
     poly_Init (res);
   return res;
 }
@@ -3451,11 +3653,38 @@ poly_Free (POLYAREA ** p)
       r_destroy_tree (&cur->contour_tree);
       cur->f->b = cur->b;
       cur->b->f = cur->f;
-      free (cur);
+      pool_put (&area_pool, cur);
     }
   poly_FreeContours (&cur->contours);
   r_destroy_tree (&cur->contour_tree);
-  free (*p), *p = NULL;
+  pool_put (&area_pool, *p), *p = NULL;
+}
+
+/*!
+ * \brief Free a single POLYAREA and its contours, leaving the rest of
+ * the list it is linked into alone.
+ */
+void
+poly_DelArea (POLYAREA ** p)
+{
+  if (*p == NULL)
+    return;
+  poly_FreeContours (&(*p)->contours);
+  r_destroy_tree (&(*p)->contour_tree);
+  pool_put (&area_pool, *p), *p = NULL;
+}
+
+/*!
+ * \brief Number of allocations made by the polygon engine since startup.
+ *
+ * Nodes, contours, descriptors and segments come from pools, so this
+ * counts the slabs and scratch chunks requested from malloc, not the
+ * r-tree internals.
+ */
+unsigned long
+poly_AllocCount (void)
+{
+  return alloc_count;
 }
 
 static BOOLp
@@ -3469,9 +3698,9 @@ inside_sector (VNODE * pn, Vector p2)
   vect_sub (pdir, pn->point, pn->prev->point);
   vect_sub (ndir, pn->next->point, pn->point);
 
-  p_c = vect_det2 (pdir, cdir) >= 0;
-  n_c = vect_det2 (ndir, cdir) >= 0;
-  p_n = vect_det2 (pdir, ndir) >= 0;
+  p_c = det2_sign (pdir[0], pdir[1], cdir[0], cdir[1]) >= 0;
+  n_c = det2_sign (ndir[0], ndir[1], cdir[0], cdir[1]) >= 0;
+  p_n = det2_sign (pdir[0], pdir[1], ndir[0], ndir[1]) >= 0;
 
   if ((p_n && p_c && n_c) || ((!p_n) && (p_c || n_c)))
     return TRUE;
@@ -3681,21 +3910,47 @@ vect_det2 (Vector v1, Vector v2)
   return (((double) v1[0] * v2[1]) - ((double) v2[0] * v1[1]));
 }
 
-static double
-vect_m_dist (Vector v1, Vector v2)
+/*!
+ * \brief Exact sign of the determinant ax * by - ay * bx.
+ *
+ * The determinant is first evaluated in double precision and that result
+ * is used whenever it is safely away from zero. Only near-degenerate
+ * cases fall back to exact integer arithmetic: coordinates are 30-bit
+ * integers, so the differences passed in here are at most 31 bits wide
+ * and each product fits in a long long.
+ *
+ * \return -1, 0 or +1.
+ */
+static int
+det2_sign (Coord ax, Coord ay, Coord bx, Coord by)
 {
-  double dx = v1[0] - v2[0];
-  double dy = v1[1] - v2[1];
-  double dd = (dx * dx + dy * dy);	/* sqrt */
+  double l = (double) ax * by;
+  double r = (double) ay * bx;
+  double det = l - r;
+  double bound = DET2_ERRBOUND * (fabs (l) + fabs (r));
+  long long el, er;
 
-  if (dx > 0)
-    return +dd;
-  if (dx < 0)
-    return -dd;
-  if (dy > 0)
-    return +dd;
-  return -dd;
-}				/* vect_m_dist */
+  if (det > bound)
+    return 1;
+  if (det < -bound)
+    return -1;
+
+  el = (long long) ax * by;
+  er = (long long) ay * bx;
+  return (el > er) - (el < er);
+}
+
+/*!
+ * \brief Orientation of point c relative to the directed line a->b.
+ *
+ * \return the exact sign of (b - a) x (c - a): 0 when the three points
+ * are collinear.
+ */
+static int
+vect_orient (Vector a, Vector b, Vector c)
+{
+  return det2_sign (b[0] - a[0], b[1] - a[1], c[0] - a[0], c[1] - a[1]);
+}
 
 /*!
  * \brief vect_inters2.
@@ -3713,7 +3968,7 @@ int
 vect_inters2 (Vector p1, Vector p2, Vector q1, Vector q2,
 	      Vector S1, Vector S2)
 {
-  double s, t, deel;
+  double t, deel;
   double rpx, rpy, rqx, rqy;
 
   if (max (p1[0], p2[0]) < min (q1[0], q2[0]) ||
@@ -3730,29 +3985,31 @@ vect_inters2 (Vector p1, Vector p2, Vector q1, Vector q2,
   rqx = q2[0] - q1[0];
   rqy = q2[1] - q1[1];
 
-  deel = rpy * rqx - rpx * rqy;	/* -vect_det(rp,rq); */
-
-  /* coordinates are 30-bit integers so deel will be exactly zero
-   * if the lines are parallel
+  /* The products do not fit in a double exactly, so parallelism is
+   * decided by the exact predicate rather than by testing deel == 0.
    */
-
-  if (deel == 0)		/* parallel */
+  if (det2_sign (p2[0] - p1[0], p2[1] - p1[1],
+		 q2[0] - q1[0], q2[1] - q1[1]) == 0)	/* parallel */
     {
-      double dc1, dc2, d1, d2, h;	/* Check to see whether p1-p2 and q1-q2 are on the same line */
-      Vector hp1, hq1, hp2, hq2, q1p1, q1q2;
-
-      Vsub2 (q1p1, q1, p1);
-      Vsub2 (q1q2, q1, q2);
-
-      /* If this product is not zero then p1-p2 and q1-q2 are not on same line! */
-      if (vect_det2 (q1p1, q1q2) != 0)  return 0;
-
-      dc1 = 0;			/* m_len(p1 - p1) */
+      Coord dc1, dc2, d1, d2, h;	/* Check to see whether p1-p2 and q1-q2 are on the same line */
+      Vector hp1, hq1, hp2, hq2;
+      int axis;
 
+      /* If any of these is not collinear then p1-p2 and q1-q2 are not on
+       * the same line! The last test catches a zero length p1-p2.
+       */
+      if (vect_orient (p1, p2, q1) != 0 || vect_orient (p1, p2, q2) != 0 ||
+	  vect_orient (q1, q2, p1) != 0)
+	return 0;
 
-      dc2 = vect_m_dist (p1, p2); /* signed dist^2 */
-      d1 = vect_m_dist (p1, q1);
-      d2 = vect_m_dist (p1, q2);
+      /* All four points are on one line, so their offsets from p1 along
+       * the x axis (the y axis if the line is vertical) order them exactly.
+       */
+      axis = (p1[0] == p2[0] && q1[0] == q2[0] && p1[0] == q1[0]) ? 1 : 0;
+      dc1 = 0;
+      dc2 = p2[axis] - p1[axis];
+      d1 = q1[axis] - p1[axis];
+      d2 = q2[axis] - p1[axis];
 
 /* Sorting the independent points from small to large */
       Vcpy2 (hp1, p1);
@@ -3839,13 +4096,21 @@ vect_inters2 (Vector p1, Vector p2, Vector q1, Vector q2,
 	}
       else
 	{
-	  s = (rqy * (p1[0] - q1[0]) + rqx * (q1[1] - p1[1])) / deel;
-	  if (s < 0 || s > 1.)
+	  /* 0 <= s <= 1 and 0 <= t <= 1 exactly when neither segment lies
+	   * strictly on one side of the other's line.
+	   */
+	  if (vect_orient (q1, q2, p1) * vect_orient (q1, q2, p2) > 0)
 	    return 0;
-	  t = (rpy * (p1[0] - q1[0]) + rpx * (q1[1] - p1[1])) / deel;
-	  if (t < 0 || t > 1.)
+	  if (vect_orient (p1, p2, q1) * vect_orient (p1, p2, q2) > 0)
 	    return 0;
 
+	  deel = rpy * rqx - rpx * rqy;	/* -vect_det(rp,rq); */
+	  t = (rpy * (p1[0] - q1[0]) + rpx * (q1[1] - p1[1])) / deel;
+	  if (t < 0.)
+	    t = 0.;
+	  else if (t > 1.)
+	    t = 1.;
+
 	  S1[0] = q1[0] + ROUND (t * rqx);
 	  S1[1] = q1[1] + ROUND (t * rqy);
 	}
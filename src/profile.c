@@ -0,0 +1,249 @@
+/*!
+ * \file src/profile.c
+ *
+ * \brief Load profile.
+ *
+ * With the profile-load option on, or through the ProfileLoad() action,
+ * loading a layout reports the wall time and heap growth of each phase
+ * of the load: font setup, lexing and parsing, r-tree insertion,
+ * CreateNewPCBPost(), polygon clipping, netlist sorting and the rest of
+ * the setup.
+ *
+ * The phases are marked with PROFILE_PUSH() and PROFILE_POP(), which
+ * cost one test of a global while no profile is taken.  Phases nest, so
+ * the r-tree insertions made while parsing are not counted as parsing.
+ *
+ * The heap growth is read from mallinfo(), which is too slow to call
+ * for each r-tree insertion, so the heap used by the r-trees is
+ * counted for the phase which inserts into them.  The allocations of
+ * the polygon engine are counted as well, see poly_AllocCount().
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#if defined (HAVE_MALLINFO2) || defined (HAVE_MALLINFO)
+#include <malloc.h>
+#endif
+
+#include "global.h"
+
+#include "data.h"
+#include "error.h"
+#include "file.h"
+#include "misc.h"
+#include "polyarea.h"
+#include "profile.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#define MAX_DEPTH 8
+
+bool profiling = false;
+
+static const char *phase_names[PROFILE_PHASES] = {
+  N_("font setup"),
+  N_("lexing and parsing"),
+  N_("r-tree insertion"),
+  N_("CreateNewPCBPost"),
+  N_("polygon clipping"),
+  N_("netlist sorting"),
+  N_("library setup"),
+  N_("other setup")
+};
+
+static struct
+{
+  int stack[MAX_DEPTH];
+  int depth;
+  gint64 start, mark;		/*!< Microseconds. */
+  size_t heap_mark;
+  unsigned long alloc_mark;
+  gint64 time[PROFILE_PHASES];
+  long heap[PROFILE_PHASES];
+  unsigned long allocs[PROFILE_PHASES];	/*!< Of the polygon engine. */
+  long calls[PROFILE_PHASES];
+} profile;
+
+static size_t
+heap_in_use (void)
+{
+#if defined (HAVE_MALLINFO2)
+  struct mallinfo2 info = mallinfo2 ();
+
+  return info.uordblks + info.hblkhd;
+#elif defined (HAVE_MALLINFO)
+  struct mallinfo info = mallinfo ();
+
+  return (unsigned) info.uordblks + (unsigned) info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+static int
+current_phase (void)
+{
+  if (profile.depth == 0)
+    return PROFILE_SETUP;
+  return profile.stack[MIN (profile.depth, MAX_DEPTH) - 1];
+}
+
+/*!
+ * \brief Charges the time since the last switch to the current phase.
+ */
+static void
+charge (bool heap)
+{
+  gint64 now = g_get_monotonic_time ();
+  int phase = current_phase ();
+
+  profile.time[phase] += now - profile.mark;
+  profile.mark = now;
+  profile.allocs[phase] += poly_AllocCount () - profile.alloc_mark;
+  profile.alloc_mark = poly_AllocCount ();
+  if (heap)
+    {
+      size_t used = heap_in_use ();
+
+      profile.heap[phase] += (long) (used - profile.heap_mark);
+      profile.heap_mark = used;
+    }
+}
+
+/*!
+ * \brief Starts a new profile; the time until the first phase is
+ * "other setup".
+ */
+void
+ProfileStart (void)
+{
+  memset (&profile, 0, sizeof (profile));
+  profile.start = profile.mark = g_get_monotonic_time ();
+  profile.heap_mark = heap_in_use ();
+  profile.alloc_mark = poly_AllocCount ();
+  profiling = true;
+}
+
+void
+ProfilePush (int Phase)
+{
+  /* r-tree insertions are too many to read the heap for each */
+  charge (Phase != PROFILE_RTREE);
+  if (profile.depth < MAX_DEPTH)
+    profile.stack[profile.depth] = Phase;
+  profile.depth++;
+  profile.calls[Phase]++;
+}
+
+void
+ProfilePop (void)
+{
+  charge (current_phase () != PROFILE_RTREE);
+  if (profile.depth > 0)
+    profile.depth--;
+}
+
+/*!
+ * \brief Ends the profile and logs it.
+ */
+void
+ProfileReport (const char *What)
+{
+  gint64 total;
+  int i;
+
+  if (!profiling)
+    return;
+  charge (true);
+  profiling = false;
+  total = profile.mark - profile.start;
+
+  Message (_("Load profile of %s:\n"), What);
+  for (i = 0; i < PROFILE_PHASES; i++)
+    {
+      if (profile.calls[i] == 0 && profile.time[i] == 0)
+	continue;
+      Message ("  %-20s %10.1f ms %5.1f%% %10ld kB",
+	       _(phase_names[i]), profile.time[i] / 1000.0,
+	       total > 0 ? 100.0 * profile.time[i] / total : 0.0,
+	       profile.heap[i] / 1024);
+      if (i == PROFILE_RTREE)
+	Message (_(" (%ld insertions)"), profile.calls[i]);
+      if (profile.allocs[i] != 0)
+	Message (_(" (%lu polygon allocations)"), profile.allocs[i]);
+      Message ("\n");
+    }
+  Message (_("  %-20s %10.1f ms\n"), _("total"), total / 1000.0);
+}
+
+static const char profileload_syntax[] =
+  N_("ProfileLoad([filename])");
+
+static const char profileload_help[] =
+  N_("Load a layout and report where the time went.");
+
+/* %start-doc actions ProfileLoad
+
+Loads the given layout, or reloads the current one, and logs the wall
+time and heap growth of each phase of the load.  The same report is
+made for every load when the @code{--profile-load} option is given.
+
+%end-doc */
+
+static int
+ActionProfileLoad (int argc, char **argv, Coord x, Coord y)
+{
+  char *name = ARG (0) ? ARG (0) : PCB->Filename;
+  bool old = Settings.ProfileLoad;
+  int result;
+
+  if (name == NULL)
+    AFAIL (profileload);
+  if (PCB->Changed
+      && !gui->confirm_dialog (_("OK to override layout data?"), 0))
+    return 1;
+
+  /* the load frees PCB->Filename */
+  name = strdup (name);
+  Settings.ProfileLoad = true;
+  result = LoadPCB (name);
+  Settings.ProfileLoad = old;
+  free (name);
+  return result;
+}
+
+HID_Action profile_action_list[] = {
+  {"ProfileLoad", 0, ActionProfileLoad,
+   profileload_help, profileload_syntax}
+};
+
+REGISTER_ACTIONS (profile_action_list)
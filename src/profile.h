@@ -0,0 +1,64 @@
+/*!
+ * \file src/profile.h
+ *
+ * \brief Prototypes for the load profile.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef	PCB_PROFILE_H
+#define	PCB_PROFILE_H
+
+#include "global.h"
+
+/*!
+ * \brief The phases of loading a layout.
+ */
+enum
+{
+  PROFILE_FONT,			/*!< CreateNewPCB() and the default font. */
+  PROFILE_PARSE,		/*!< Lexing and parsing. */
+  PROFILE_RTREE,		/*!< r_insert_entry(). */
+  PROFILE_LAYOUT,		/*!< CreateNewPCBPost(). */
+  PROFILE_CLIP,			/*!< InitClip() of all polygons. */
+  PROFILE_NETLIST,		/*!< sort_netlist(). */
+  PROFILE_LIBRARY,		/*!< ReadLibraryContents(). */
+  PROFILE_SETUP,		/*!< Everything else. */
+  PROFILE_PHASES
+};
+
+extern bool profiling;
+
+void ProfileStart (void);
+void ProfilePush (int);
+void ProfilePop (void);
+void ProfileReport (const char *);
+
+/*!
+ * \brief Time spent until the matching PROFILE_POP() goes to Phase.
+ *
+ * Phases nest; the time of an inner phase is not counted for the
+ * outer one.
+ */
+#define PROFILE_PUSH(Phase) do { if (profiling) ProfilePush (Phase); } while (0)
+#define PROFILE_POP() do { if (profiling) ProfilePop (); } while (0)
+
+#endif
@@ -60,6 +60,7 @@
 #include "mymem.h"
 #include "polygon.h"
 #include "rats.h"
+#include "remove.h"
 #include "search.h"
 #include "set.h"
 #include "undo.h"
@@ -77,15 +78,16 @@
 static bool FindPad (char *, char *, ConnectionType *, bool);
 static bool ParseConnection (char *, char *, char *);
 static bool DrawShortestRats (NetListType *, void (*)(register ConnectionType *, register ConnectionType *, register RouteStyleType *));
-static bool GatherSubnets (NetListType *, bool, bool);
-static bool CheckShorts (LibraryMenuType *);
-static void TransferNet (NetListType *, NetType *, NetType *);
+static bool GatherSubnets (NetListType *, bool);
 
 /* ---------------------------------------------------------------------------
  * some local identifiers
  */
 static bool badnet = false;
 static Cardinal top_group, bottom_group;	/* layer group holding top/bottom side */
+static NetListType *Wantlist = NULL;	/* made by ProcNetlist */
+static LibraryType *wantlist_menu = NULL;	/* what Wantlist was made from */
+static GHashTable *element_nets = NULL;	/* element to its nets in Wantlist */
 
 /*!
  * \brief Parse a connection description from a string.
@@ -122,6 +124,38 @@ ParseConnection (char *InString, char *ElementName, char *PinNum)
     }
 }
 
+/*!
+ * \brief Sets the position and layer group of a pin or pad connection.
+ */
+static void
+rat_set_position (ConnectionType *conn)
+{
+  if (conn->type == PAD_TYPE)
+    {
+      PadType *pad = (PadType *) conn->ptr2;
+
+      conn->group = TEST_FLAG (ONSOLDERFLAG, pad) ? bottom_group : top_group;
+      if (TEST_FLAG (EDGE2FLAG, pad))
+	{
+	  conn->X = pad->Point2.X;
+	  conn->Y = pad->Point2.Y;
+	}
+      else
+	{
+	  conn->X = pad->Point1.X;
+	  conn->Y = pad->Point1.Y;
+	}
+    }
+  else
+    {
+      PinType *pin = (PinType *) conn->ptr2;
+
+      conn->group = bottom_group;	/* any layer will do */
+      conn->X = pin->X;
+      conn->Y = pin->Y;
+    }
+}
+
 /*!
  * \brief Find a particular pad from an element name and pin number.
  */
@@ -134,28 +168,21 @@ FindPad (char *ElementName, char *PinNum, ConnectionType * conn, bool Same)
   if ((element = SearchElementByName (PCB->Data, ElementName)) == NULL)
     return false;
 
+  /* pin numbers are interned, so equal numbers are the same pointer */
+  if ((PinNum = FindInternedString (PinNum)) == NULL)
+    return false;
+
   for (i = element->Pad; i != NULL; i = g_list_next (i))
     {
       PadType *pad = i->data;
 
-      if (NSTRCMP (PinNum, pad->Number) == 0 &&
+      if (pad->Number == PinNum &&
           (!Same || !TEST_FLAG (DRCFLAG, pad)))
         {
           conn->type = PAD_TYPE;
           conn->ptr1 = element;
           conn->ptr2 = pad;
-          conn->group = TEST_FLAG (ONSOLDERFLAG, pad) ? bottom_group : top_group;
-
-          if (TEST_FLAG (EDGE2FLAG, pad))
-            {
-              conn->X = pad->Point2.X;
-              conn->Y = pad->Point2.Y;
-            }
-          else
-            {
-              conn->X = pad->Point1.X;
-              conn->Y = pad->Point1.Y;
-            }
+          rat_set_position (conn);
           return true;
         }
     }
@@ -165,15 +192,13 @@ FindPad (char *ElementName, char *PinNum, ConnectionType * conn, bool Same)
       PinType *pin = i->data;
 
       if (!TEST_FLAG (HOLEFLAG, pin) &&
-          pin->Number && NSTRCMP (PinNum, pin->Number) == 0 &&
+          pin->Number == PinNum &&
           (!Same || !TEST_FLAG (DRCFLAG, pin)))
         {
           conn->type = PIN_TYPE;
           conn->ptr1 = element;
           conn->ptr2 = pin;
-          conn->group = bottom_group;        /* any layer will do */
-          conn->X = pin->X;
-          conn->Y = pin->Y;
+          rat_set_position (conn);
           return true;
         }
     }
@@ -221,26 +246,89 @@ SeekPad (LibraryEntryType * entry, ConnectionType * conn, bool Same)
 }
 
 /*!
- * \brief Read the library-netlist build a true Netlist structure.
+ * \brief Makes the next ProcNetlist() read the netlist again.
+ *
+ * Called by NetlistChanged(), and when an element of the layout is
+ * created, removed or renamed, which undo and redo do through the same
+ * functions.  The pin numbers are set when a pin is created with its
+ * element, so they are covered too.
  */
-NetListType *
-ProcNetlist (LibraryType *net_menu)
+void
+InvalidateNetlist (void)
+{
+  wantlist_menu = NULL;
+}
+
+/*!
+ * \brief Finds the route style of a net by its name.
+ *
+ * \return NULL if the net has no style or it is not found.
+ */
+static RouteStyleType *
+rat_net_style (LibraryMenuType *menu)
+{
+  if (menu->Style)
+    {
+      STYLE_LOOP (PCB);
+      {
+	if (style->Name && !NSTRCMP (style->Name, menu->Style))
+	  return style;
+      }
+      END_LOOP;
+    }
+  return NULL;
+}
+
+/*!
+ * \brief Brings the positions of the connections of a net and its
+ * route style up to date.
+ */
+static void
+rat_refresh_net (NetType *net)
+{
+  if (net->ConnectionN)
+    net->Style = rat_net_style (net->Connection[0].menu);
+  CONNECTION_LOOP (net);
+  {
+    rat_set_position (connection);
+  }
+  END_LOOP;
+}
+
+static void
+rat_free_nets (gpointer nets)
+{
+  g_array_free ((GArray *) nets, TRUE);
+}
+
+/*!
+ * \brief Returns Wantlist, reading the library-netlist into it first if
+ * it has been invalidated.
+ *
+ * A reused Wantlist may have stale positions and styles, see
+ * rat_refresh_net().
+ */
+static NetListType *
+rat_wantlist (LibraryType *net_menu)
 {
   ConnectionType *connection;
   ConnectionType LastPoint;
   NetType *net;
-  static NetListType *Wantlist = NULL;
+  Cardinal i;
 
   if (!net_menu->MenuN)
     return (NULL);
-  FreeNetListMemory (Wantlist);
-  free (Wantlist);
-  badnet = false;
 
   /* find layer groups of the component side and solder side */
   bottom_group = GetLayerGroupNumberBySide (BOTTOM_SIDE);
   top_group = GetLayerGroupNumberBySide (TOP_SIDE);
 
+  if (Wantlist && wantlist_menu == net_menu)
+    return (Wantlist);
+  FreeNetListMemory (Wantlist);
+  free (Wantlist);
+  badnet = false;
+
   Wantlist = (NetListType *)calloc (1, sizeof (NetListType));
   if (Wantlist)
     {
@@ -264,20 +352,7 @@ ProcNetlist (LibraryType *net_menu)
 	    continue;
 	  }
 	net = GetNetMemory (Wantlist);
-	if (menu->Style)
-	  {
-	    STYLE_LOOP (PCB);
-	    {
-	      if (style->Name && !NSTRCMP (style->Name, menu->Style))
-		{
-		  net->Style = style;
-		  break;
-		}
-	    }
-	    END_LOOP;
-	  }
-	else			/* default to NULL if none found */
-	  net->Style = NULL;
+	net->Style = rat_net_style (menu);
 	ENTRY_LOOP (menu);
 	{
 	  if (SeekPad (entry, &LastPoint, false))
@@ -335,36 +410,278 @@ ProcNetlist (LibraryType *net_menu)
     CLEAR_FLAG (DRCFLAG, pad);
   }
   ENDALL_LOOP;
+
+  /* index the nets of each element, for UpdateElementRats() */
+  if (element_nets)
+    g_hash_table_remove_all (element_nets);
+  else
+    element_nets = g_hash_table_new_full (NULL, NULL, NULL, rat_free_nets);
+  for (i = 0; Wantlist && i < Wantlist->NetN; i++)
+    {
+      net = &Wantlist->Net[i];
+      CONNECTION_LOOP (net);
+      {
+	GArray *nets = (GArray *) g_hash_table_lookup (element_nets,
+						       connection->ptr1);
+
+	if (nets == NULL)
+	  {
+	    nets = g_array_new (FALSE, FALSE, sizeof (Cardinal));
+	    g_hash_table_insert (element_nets, connection->ptr1, nets);
+	  }
+	if (nets->len == 0
+	    || g_array_index (nets, Cardinal, nets->len - 1) != i)
+	  g_array_append_val (nets, i);
+      }
+      END_LOOP;
+    }
+  wantlist_menu = net_menu;
   return (Wantlist);
 }
 
 /*!
- * \brief Copy all connections from one net into another and then remove
- * the first net from its netlist.
+ * \brief Read the library-netlist build a true Netlist structure.
+ *
+ * Looking up the pins by element name is slow on large boards, so the
+ * result is kept until InvalidateNetlist() is called.  Only the
+ * positions of the connections and the route styles are brought up to
+ * date when it is reused.
+ */
+NetListType *
+ProcNetlist (LibraryType *net_menu)
+{
+  bool reused = Wantlist && wantlist_menu == net_menu;
+  NetListType *netlist = rat_wantlist (net_menu);
+
+  if (netlist && reused)
+    {
+      NET_LOOP (netlist);
+      {
+	rat_refresh_net (net);
+      }
+      END_LOOP;
+    }
+  return (netlist);
+}
+
+/* ---------------------------------------------------------------------------
+ * connected components of the copper, for GatherSubnets
+ */
+
+/*!
+ * \brief An attachment point, pin or pad of a component.
+ */
+typedef struct
+{
+  int type;
+  void *ptr1, *ptr2;
+  int order; /*!< Position in the order the lookups found them. */
+} RatMemberType;
+
+/*!
+ * \brief A connected component of the copper.
+ *
+ * Components which are joined by a new rat line are kept in a list
+ * starting at their union-find root; their members are merged when
+ * the root is next asked for.
+ */
+typedef struct
+{
+  GArray *members; /*!< RatMemberType, in the order of the board. */
+  int next; /*!< Next component of the same union, or -1. */
+  int last; /*!< Last component of the union, at the root. */
+  int subnet; /*!< Subnet of the component in GatherSubnets(), or -1. */
+} RatComponentType;
+
+static struct
+{
+  GHashTable *label; /*!< Object to its component number + 1. */
+  GPtrArray *rats; /*!< The rat lines found. */
+  RatComponentType *comp;
+  int *parent; /*!< Union-find over the components. */
+  int n, max;
+  int order; /*!< Number of members listed so far. */
+} components;
+
+static int
+rat_find (int *parent, int i)
+{
+  while (parent[i] != i)
+    i = parent[i] = parent[parent[i]];
+  return i;
+}
+
+/*!
+ * \brief Labels an object found by the lookup of a component, and lists
+ * it with the members of the component if it is an attachment point,
+ * pin or pad.
  */
 static void
-TransferNet (NetListType *Netl, NetType *SourceNet, NetType *DestNet)
+rat_label_object (int type, void *ptr1, void *ptr2, void *label)
 {
-  ConnectionType *conn;
+  RatComponentType *comp = &components.comp[GPOINTER_TO_INT (label) - 1];
+  RatMemberType member;
+
+  g_hash_table_insert (components.label, ptr2, label);
+  if (type == RATLINE_TYPE)
+    g_ptr_array_add (components.rats, ptr2);
+  if (type == RATLINE_TYPE || type == ARC_TYPE)
+    return;
+  if (comp->members == NULL)
+    comp->members = g_array_new (FALSE, FALSE, sizeof (RatMemberType));
+  member.type = type;
+  member.ptr1 = ptr1;
+  member.ptr2 = ptr2;
+  member.order = components.order++;
+  g_array_append_val (comp->members, member);
+}
 
-  /* It would be worth checking if SourceNet is NULL here to avoid a segfault. Seb James. */
-  CONNECTION_LOOP (SourceNet);
+static gint
+rat_member_cmp (gconstpointer a, gconstpointer b)
+{
+  return ((const RatMemberType *) a)->order
+    - ((const RatMemberType *) b)->order;
+}
+
+/*!
+ * \brief Labels the copper connected to the connections of the netlist.
+ *
+ * Each component is looked up once, starting from the first connection
+ * in it, and keeps DRCFLAG set until FreeComponents().  The lines,
+ * polygons, vias, pins and pads found become the members of the
+ * component, in the order they are found, so only the copper of these
+ * nets is visited.
+ *
+ * DRCFLAG must be clear on the copper of the nets, as it is between
+ * operations.
+ */
+static void
+LabelComponents (NetListType *Wantlist, bool SelectedOnly, bool AndRats)
+{
+  components.label = g_hash_table_new (NULL, NULL);
+  components.rats = g_ptr_array_new ();
+  components.n = 0;
+  components.order = 0;
+  NET_LOOP (Wantlist);
   {
-    conn = GetConnectionMemory (DestNet);
-    *conn = *connection;
+    CONNECTION_LOOP (net);
+    {
+      RatComponentType *comp;
+
+      if ((SelectedOnly
+	   && !TEST_FLAG (SELECTEDFLAG, (PinType *) connection->ptr2))
+	  || TEST_FLAG (DRCFLAG, (PinType *) connection->ptr2))
+	continue;
+      if (components.n >= components.max)
+	{
+	  components.max = components.max ? 2 * components.max : 256;
+	  components.comp = (RatComponentType *)
+	    realloc (components.comp,
+		     components.max * sizeof (RatComponentType));
+	  components.parent = (int *)
+	    realloc (components.parent, components.max * sizeof (int));
+	}
+      comp = &components.comp[components.n];
+      comp->members = NULL;
+      comp->next = comp->subnet = -1;
+      comp->last = components.n;
+      components.parent[components.n] = components.n;
+      components.n++;
+      RatFindHook (connection->type, connection->ptr1, connection->ptr2,
+		   connection->ptr2, false, DRCFLAG, AndRats);
+      ForEachFoundObject (rat_label_object,
+			  GINT_TO_POINTER (components.n));
+    }
+    END_LOOP;
   }
   END_LOOP;
-  DestNet->Style = SourceNet->Style;
-  /* free the connection memory */
-  FreeNetMemory (SourceNet);
-  /* remove SourceNet from its netlist */
-  *SourceNet = Netl->Net[--(Netl->NetN)];
-  /* zero out old garbage */
-  memset (&Netl->Net[Netl->NetN], 0, sizeof (NetType));
+}
+
+/*!
+ * \brief Frees the components and clears DRCFLAG on the objects found.
+ */
+static void
+FreeComponents (void)
+{
+  GHashTableIter iter;
+  gpointer object;
+  int i;
+
+  g_hash_table_iter_init (&iter, components.label);
+  while (g_hash_table_iter_next (&iter, &object, NULL))
+    CLEAR_FLAG (DRCFLAG, (AnyObjectType *) object);
+  for (i = 0; i < components.n; i++)
+    if (components.comp[i].members)
+      g_array_free (components.comp[i].members, TRUE);
+  free (components.comp);
+  free (components.parent);
+  g_hash_table_destroy (components.label);
+  if (components.rats)
+    g_ptr_array_free (components.rats, TRUE);
+  memset (&components, 0, sizeof (components));
+}
+
+/*!
+ * \brief Returns the component of a labelled object.
+ */
+static int
+rat_component (void *ptr)
+{
+  int c = GPOINTER_TO_INT (g_hash_table_lookup (components.label, ptr)) - 1;
+
+  return rat_find (components.parent, c);
+}
+
+/*!
+ * \brief Records that a new rat line joins the components of two
+ * connections, as a lookup with rats would now see them as one.
+ */
+static void
+rat_join_components (ConnectionType *first, ConnectionType *second)
+{
+  int a, b;
+
+  if (components.label == NULL)
+    return;
+  a = rat_component (first->ptr2);
+  b = rat_component (second->ptr2);
+  if (a == b)
+    return;
+  components.parent[b] = a;
+  components.comp[components.comp[a].last].next = b;
+  components.comp[a].last = components.comp[b].last;
+}
+
+/*!
+ * \brief Returns the members of a component root, merging those of
+ * the components joined to it.
+ */
+static GArray *
+rat_members (int c)
+{
+  RatComponentType *root = &components.comp[c];
+  int i;
+
+  if (root->members == NULL)
+    root->members = g_array_new (FALSE, FALSE, sizeof (RatMemberType));
+  if (root->next < 0)
+    return root->members;
+  for (i = root->next; i >= 0; i = components.comp[i].next)
+    if (components.comp[i].members)
+      {
+	g_array_append_vals (root->members, components.comp[i].members->data,
+			     components.comp[i].members->len);
+	g_array_free (components.comp[i].members, TRUE);
+	components.comp[i].members = NULL;
+      }
+  g_array_sort (root->members, rat_member_cmp);
+  root->next = -1;
+  root->last = c;
+  return root->members;
 }
 
 static bool
-CheckShorts (LibraryMenuType *theNet)
+CheckShorts (LibraryMenuType *theNet, GArray *members)
 {
   bool newone, warn = false;
   PointerListType *generic = (PointerListType *)calloc (1, sizeof (PointerListType));
@@ -372,80 +689,96 @@ CheckShorts (LibraryMenuType *theNet)
    * the menu is always non-null
    */
   void **menu = GetPointerMemory (generic);
+  RatMemberType *member;
+  guint i;
 
   *menu = theNet;
-  ALLPIN_LOOP (PCB->Data);
-  {
-    if (TEST_FLAG (DRCFLAG, pin))
-      {
-	warn = true;
-	if (!pin->Spare)
-	  {
-	    Message (_("Warning! Net \"%s\" is shorted to %s pin %s\n"),
-		     &theNet->Name[2],
-		     UNKNOWN (NAMEONPCB_NAME (element)),
-		     UNKNOWN (pin->Number));
-	    SET_FLAG (WARNFLAG, pin);
-	    continue;
-	  }
-	newone = true;
-	POINTER_LOOP (generic);
+  for (i = 0; i < members->len; i++)
+    {
+      ElementType *element;
+      PinType *pin;
+
+      member = &g_array_index (members, RatMemberType, i);
+      if (member->type != PIN_TYPE)
+	continue;
+      element = (ElementType *) member->ptr1;
+      pin = (PinType *) member->ptr2;
+      if (TEST_FLAG (DRCFLAG, pin))
 	{
-	  if (*ptr == pin->Spare)
+	  warn = true;
+	  if (!pin->Spare)
 	    {
-	      newone = false;
-	      break;
+	      Message (_("Warning! Net \"%s\" is shorted to %s pin %s\n"),
+		       &theNet->Name[2],
+		       UNKNOWN (NAMEONPCB_NAME (element)),
+		       UNKNOWN (pin->Number));
+	      SET_FLAG (WARNFLAG, pin);
+	      continue;
 	    }
-	}
-	END_LOOP;
-	if (newone)
+	  newone = true;
+	  POINTER_LOOP (generic);
 	  {
-	    menu = GetPointerMemory (generic);
-	    *menu = pin->Spare;
-	    Message (_("Warning! Net \"%s\" is shorted to net \"%s\"\n"),
-		     &theNet->Name[2],
-		     &((LibraryMenuType *) (pin->Spare))->Name[2]);
-	    SET_FLAG (WARNFLAG, pin);
+	    if (*ptr == pin->Spare)
+	      {
+		newone = false;
+		break;
+	      }
 	  }
-      }
-  }
-  ENDALL_LOOP;
-  ALLPAD_LOOP (PCB->Data);
-  {
-    if (TEST_FLAG (DRCFLAG, pad))
-      {
-	warn = true;
-	if (!pad->Spare)
-	  {
-	    Message (_("Warning! Net \"%s\" is shorted  to %s pad %s\n"),
-		     &theNet->Name[2],
-		     UNKNOWN (NAMEONPCB_NAME (element)),
-		     UNKNOWN (pad->Number));
-	    SET_FLAG (WARNFLAG, pad);
-	    continue;
-	  }
-	newone = true;
-	POINTER_LOOP (generic);
-	{
-	  if (*ptr == pad->Spare)
+	  END_LOOP;
+	  if (newone)
 	    {
-	      newone = false;
-	      break;
+	      menu = GetPointerMemory (generic);
+	      *menu = pin->Spare;
+	      Message (_("Warning! Net \"%s\" is shorted to net \"%s\"\n"),
+		       &theNet->Name[2],
+		       &((LibraryMenuType *) (pin->Spare))->Name[2]);
+	      SET_FLAG (WARNFLAG, pin);
 	    }
 	}
-	END_LOOP;
-	if (newone)
+    }
+  for (i = 0; i < members->len; i++)
+    {
+      ElementType *element;
+      PadType *pad;
+
+      member = &g_array_index (members, RatMemberType, i);
+      if (member->type != PAD_TYPE)
+	continue;
+      element = (ElementType *) member->ptr1;
+      pad = (PadType *) member->ptr2;
+      if (TEST_FLAG (DRCFLAG, pad))
+	{
+	  warn = true;
+	  if (!pad->Spare)
+	    {
+	      Message (_("Warning! Net \"%s\" is shorted  to %s pad %s\n"),
+		       &theNet->Name[2],
+		       UNKNOWN (NAMEONPCB_NAME (element)),
+		       UNKNOWN (pad->Number));
+	      SET_FLAG (WARNFLAG, pad);
+	      continue;
+	    }
+	  newone = true;
+	  POINTER_LOOP (generic);
 	  {
-	    menu = GetPointerMemory (generic);
-	    *menu = pad->Spare;
-	    Message (_("Warning! Net \"%s\" is shorted to net \"%s\"\n"),
-		     &theNet->Name[2],
-		     &((LibraryMenuType *) (pad->Spare))->Name[2]);
-	    SET_FLAG (WARNFLAG, pad);
+	    if (*ptr == pad->Spare)
+	      {
+		newone = false;
+		break;
+	      }
 	  }
-      }
-  }
-  ENDALL_LOOP;
+	  END_LOOP;
+	  if (newone)
+	    {
+	      menu = GetPointerMemory (generic);
+	      *menu = pad->Spare;
+	      Message (_("Warning! Net \"%s\" is shorted to net \"%s\"\n"),
+		       &theNet->Name[2],
+		       &((LibraryMenuType *) (pad->Spare))->Name[2]);
+	      SET_FLAG (WARNFLAG, pad);
+	    }
+	}
+    }
   FreePointerListMemory (generic);
   free (generic);
   return (warn);
@@ -458,102 +791,370 @@ CheckShorts (LibraryMenuType *theNet)
  *
  * Initially the netlist has each connection in its own individual net
  * afterwards there can be many fewer nets with multiple connections
- * each.
+ * each.  The subnets keep the order of their first connections.
+ *
+ * The copper must have been labelled by LabelComponents().
  */
 static bool
-GatherSubnets (NetListType *Netl, bool NoWarn, bool AndRats)
+GatherSubnets (NetListType *Netl, bool NoWarn)
 {
-  NetType *a, *b;
+  NetType *a;
   ConnectionType *conn;
-  Cardinal m, n;
+  RatComponentType *comp;
+  GArray *members;
+  Cardinal m, n, pins;
+  guint i;
+  int c;
   bool Warned = false;
 
-  for (m = 0; Netl->NetN > 0 && m < Netl->NetN; m++)
+  /* move each connection to the subnet of its component */
+  for (m = n = 0; m < Netl->NetN; m++)
     {
-      a = &Netl->Net[m];
-      ClearFlagOnAllObjects (DRCFLAG, false);
-      RatFindHook (a->Connection[0].type, a->Connection[0].ptr1,
-                   a->Connection[0].ptr2, a->Connection[0].ptr2,
-                   false, DRCFLAG, AndRats);
-      /* now anybody connected to the first point has DRCFLAG set */
-      /* so move those to this subnet */
-      CLEAR_FLAG (DRCFLAG, (PinType *) a->Connection[0].ptr2);
-      for (n = m + 1; n < Netl->NetN; n++)
+      comp = &components.comp[rat_component (Netl->Net[m].Connection[0].ptr2)];
+      if (comp->subnet < 0)
 	{
-	  b = &Netl->Net[n];
-	  /* There can be only one connection in net b */
-	  if (TEST_FLAG (DRCFLAG, (PinType *) b->Connection[0].ptr2))
+	  comp->subnet = n;
+	  if (n != m)
 	    {
-	      CLEAR_FLAG (DRCFLAG, (PinType *) b->Connection[0].ptr2);
-	      TransferNet (Netl, b, a);
-	      /* back up since new subnet is now at old index */
-	      n--;
+	      Netl->Net[n] = Netl->Net[m];
+	      memset (&Netl->Net[m], 0, sizeof (NetType));
 	    }
+	  n++;
+	  continue;
 	}
+      a = &Netl->Net[comp->subnet];
+      conn = GetConnectionMemory (a);
+      *conn = Netl->Net[m].Connection[0];
+      a->Style = Netl->Net[m].Style;
+      FreeNetMemory (&Netl->Net[m]);
+    }
+  Netl->NetN = n;
+
+  for (m = 0; m < Netl->NetN; m++)
+    {
+      a = &Netl->Net[m];
+      c = rat_component (a->Connection[0].ptr2);
+      components.comp[c].subnet = -1;
+      members = rat_members (c);
+      /* the pins and pads of the subnet are not shorts */
+      pins = a->ConnectionN;
+      for (n = 0; n < pins; n++)
+	CLEAR_FLAG (DRCFLAG, (PinType *) a->Connection[n].ptr2);
       /* now add other possible attachment points to the subnet */
       /* e.g. line end-points and vias */
-      /* don't add non-manhattan lines, the auto-router can't route to them */
-      ALLLINE_LOOP (PCB->Data);
-      {
-	if (TEST_FLAG (DRCFLAG, line))
-	  {
-	    conn = GetConnectionMemory (a);
-	    conn->X = line->Point1.X;
-	    conn->Y = line->Point1.Y;
-	    conn->type = LINE_TYPE;
-	    conn->ptr1 = layer;
-	    conn->ptr2 = line;
-	    conn->group = GetLayerGroupNumberByPointer (layer);
-	    conn->menu = NULL;	/* agnostic view of where it belongs */
-	    conn = GetConnectionMemory (a);
-	    conn->X = line->Point2.X;
-	    conn->Y = line->Point2.Y;
-	    conn->type = LINE_TYPE;
-	    conn->ptr1 = layer;
-	    conn->ptr2 = line;
-	    conn->group = GetLayerGroupNumberByPointer (layer);
-	    conn->menu = NULL;
-	  }
-      }
-      ENDALL_LOOP;
-      /* add polygons so the auto-router can see them as targets */
-      ALLPOLYGON_LOOP (PCB->Data);
-      {
-	if (TEST_FLAG (DRCFLAG, polygon))
-	  {
-	    conn = GetConnectionMemory (a);
-	    /* make point on a vertex */
-	    conn->X = polygon->Clipped->contours->head.point[0];
-	    conn->Y = polygon->Clipped->contours->head.point[1];
-	    conn->type = POLYGON_TYPE;
-	    conn->ptr1 = layer;
-	    conn->ptr2 = polygon;
-	    conn->group = GetLayerGroupNumberByPointer (layer);
-	    conn->menu = NULL;	/* agnostic view of where it belongs */
-	  }
-      }
-      ENDALL_LOOP;
-      VIA_LOOP (PCB->Data);
-      {
-	if (TEST_FLAG (DRCFLAG, via))
-	  {
-	    conn = GetConnectionMemory (a);
-	    conn->X = via->X;
-	    conn->Y = via->Y;
-	    conn->type = VIA_TYPE;
-	    conn->ptr1 = via;
-	    conn->ptr2 = via;
-	    conn->group = bottom_group;
-	  }
-      }
-      END_LOOP;
+      for (i = 0; i < members->len; i++)
+	{
+	  RatMemberType *member = &g_array_index (members, RatMemberType, i);
+	  LayerType *layer = (LayerType *) member->ptr1;
+
+	  switch (member->type)
+	    {
+	    case LINE_TYPE:
+	      {
+		LineType *line = (LineType *) member->ptr2;
+
+		conn = GetConnectionMemory (a);
+		conn->X = line->Point1.X;
+		conn->Y = line->Point1.Y;
+		conn->type = LINE_TYPE;
+		conn->ptr1 = layer;
+		conn->ptr2 = line;
+		conn->group = GetLayerGroupNumberByPointer (layer);
+		conn->menu = NULL;	/* agnostic view of where it belongs */
+		conn = GetConnectionMemory (a);
+		conn->X = line->Point2.X;
+		conn->Y = line->Point2.Y;
+		conn->type = LINE_TYPE;
+		conn->ptr1 = layer;
+		conn->ptr2 = line;
+		conn->group = GetLayerGroupNumberByPointer (layer);
+		conn->menu = NULL;
+		break;
+	      }
+	    /* add polygons so the auto-router can see them as targets */
+	    case POLYGON_TYPE:
+	      {
+		PolygonType *polygon = (PolygonType *) member->ptr2;
+
+		conn = GetConnectionMemory (a);
+		/* make point on a vertex */
+		conn->X = polygon->Clipped->contours->head.point[0];
+		conn->Y = polygon->Clipped->contours->head.point[1];
+		conn->type = POLYGON_TYPE;
+		conn->ptr1 = layer;
+		conn->ptr2 = polygon;
+		conn->group = GetLayerGroupNumberByPointer (layer);
+		conn->menu = NULL;	/* agnostic view of where it belongs */
+		break;
+	      }
+	    case VIA_TYPE:
+	      {
+		PinType *via = (PinType *) member->ptr2;
+
+		conn = GetConnectionMemory (a);
+		conn->X = via->X;
+		conn->Y = via->Y;
+		conn->type = VIA_TYPE;
+		conn->ptr1 = via;
+		conn->ptr2 = via;
+		conn->group = bottom_group;
+		break;
+	      }
+	    }
+	}
       if (!NoWarn)
-	Warned |= CheckShorts (a->Connection[0].menu);
+	Warned |= CheckShorts (a->Connection[0].menu, members);
+      for (n = 0; n < pins; n++)
+	SET_FLAG (DRCFLAG, (PinType *) a->Connection[n].ptr2);
     }
-  ClearFlagOnAllObjects (DRCFLAG, false);
   return (Warned);
 }
 
+/* ---------------------------------------------------------------------------
+ * minimum spanning forest of the subnets, for DrawShortestRats
+ */
+#define RAT_LEAF_SIZE 8
+
+/*!
+ * \brief A connection of the net being connected.
+ */
+typedef struct
+{
+  ConnectionType *conn;
+  int subnet; /*!< Index of its subnet in the netlist. */
+  int root; /*!< Set of the subnet in this round. */
+} RatPointType;
+
+/*!
+ * \brief A node of the kd-tree over the connections.
+ *
+ * Node k covers a range of the points, its children are 2k+1 and 2k+2.
+ */
+typedef struct
+{
+  Coord X1, Y1, X2, Y2; /*!< Bounding box of the points. */
+  int root; /*!< Set shared by all the points, or -1. */
+} RatNodeType;
+
+typedef struct
+{
+  RatPointType *points;
+  RatNodeType *nodes;
+  int *parent; /*!< Union-find over the subnets. */
+} RatForestType;
+
+static int
+rat_cmp_x (const void *va, const void *vb)
+{
+  const RatPointType *a = (const RatPointType *) va;
+  const RatPointType *b = (const RatPointType *) vb;
+
+  return (a->conn->X > b->conn->X) - (a->conn->X < b->conn->X);
+}
+
+static int
+rat_cmp_y (const void *va, const void *vb)
+{
+  const RatPointType *a = (const RatPointType *) va;
+  const RatPointType *b = (const RatPointType *) vb;
+
+  return (a->conn->Y > b->conn->Y) - (a->conn->Y < b->conn->Y);
+}
+
+/*!
+ * \brief Builds the kd-tree, splitting each range across its wider
+ * side.
+ */
+static void
+rat_build (RatForestType *f, int k, int lo, int hi)
+{
+  RatNodeType *node = &f->nodes[k];
+  int i, mid;
+
+  node->X1 = node->X2 = f->points[lo].conn->X;
+  node->Y1 = node->Y2 = f->points[lo].conn->Y;
+  for (i = lo + 1; i < hi; i++)
+    {
+      node->X1 = MIN (node->X1, f->points[i].conn->X);
+      node->X2 = MAX (node->X2, f->points[i].conn->X);
+      node->Y1 = MIN (node->Y1, f->points[i].conn->Y);
+      node->Y2 = MAX (node->Y2, f->points[i].conn->Y);
+    }
+  if (hi - lo <= RAT_LEAF_SIZE)
+    return;
+
+  qsort (f->points + lo, hi - lo, sizeof (RatPointType),
+	 node->X2 - node->X1 >= node->Y2 - node->Y1 ? rat_cmp_x : rat_cmp_y);
+  mid = (lo + hi) / 2;
+  rat_build (f, 2 * k + 1, lo, mid);
+  rat_build (f, 2 * k + 2, mid, hi);
+}
+
+/*!
+ * \brief Notes in each node whether all its points are in one set.
+ */
+static int
+rat_label (RatForestType *f, int k, int lo, int hi)
+{
+  int i, mid, root;
+
+  if (hi - lo <= RAT_LEAF_SIZE)
+    {
+      root = f->points[lo].root;
+      for (i = lo + 1; i < hi && root >= 0; i++)
+	if (f->points[i].root != root)
+	  root = -1;
+    }
+  else
+    {
+      mid = (lo + hi) / 2;
+      root = rat_label (f, 2 * k + 1, lo, mid);
+      if (rat_label (f, 2 * k + 2, mid, hi) != root)
+	root = -1;
+    }
+  return f->nodes[k].root = root;
+}
+
+static double
+rat_box_distance (RatNodeType *node, Coord X, Coord Y)
+{
+  double dx = 0, dy = 0;
+
+  if (X < node->X1)
+    dx = (double) node->X1 - X;
+  else if (X > node->X2)
+    dx = (double) X - node->X2;
+  if (Y < node->Y1)
+    dy = (double) node->Y1 - Y;
+  else if (Y > node->Y2)
+    dy = (double) Y - node->Y2;
+  return dx * dx + dy * dy;
+}
+
+/*!
+ * \brief Finds the nearest point to point p which is in another set.
+ */
+static void
+rat_nearest (RatForestType *f, int k, int lo, int hi, int p,
+	     double *best, int *found)
+{
+  RatPointType *point = &f->points[p];
+  int i, mid;
+
+  if (f->nodes[k].root == point->root
+      || rat_box_distance (&f->nodes[k], point->conn->X,
+			   point->conn->Y) > *best)
+    return;
+
+  if (hi - lo <= RAT_LEAF_SIZE)
+    {
+      for (i = lo; i < hi; i++)
+	{
+	  double dx, dy, d;
+
+	  if (f->points[i].root == point->root)
+	    continue;
+	  dx = (double) f->points[i].conn->X - point->conn->X;
+	  dy = (double) f->points[i].conn->Y - point->conn->Y;
+	  d = dx * dx + dy * dy;
+	  if (d < *best || (d == *best && i < *found))
+	    {
+	      *best = d;
+	      *found = i;
+	    }
+	}
+      return;
+    }
+
+  /* the nearer child first, to prune more of the other */
+  mid = (lo + hi) / 2;
+  if (rat_box_distance (&f->nodes[2 * k + 1], point->conn->X,
+			point->conn->Y)
+      <= rat_box_distance (&f->nodes[2 * k + 2], point->conn->X,
+			   point->conn->Y))
+    {
+      rat_nearest (f, 2 * k + 1, lo, mid, p, best, found);
+      rat_nearest (f, 2 * k + 2, mid, hi, p, best, found);
+    }
+  else
+    {
+      rat_nearest (f, 2 * k + 2, mid, hi, p, best, found);
+      rat_nearest (f, 2 * k + 1, lo, mid, p, best, found);
+    }
+}
+
+/*!
+ * \brief Adds a rat between two connections of different subnets, or
+ * passes them to funcp.
+ */
+static bool
+rat_connect (ConnectionType *first, ConnectionType *second, bool via,
+	     RouteStyleType *style,
+	     void (*funcp) (register ConnectionType *, register ConnectionType *, register RouteStyleType *))
+{
+  RatType *line;
+
+  if (funcp)
+    {
+      (*funcp) (first, second, style);
+      return false;
+    }
+  if ((line = CreateNewRat (PCB->Data,
+			    first->X, first->Y,
+			    second->X, second->Y,
+			    first->group, second->group,
+			    Settings.RatThickness,
+			    NoFlags ())) == NULL)
+    return false;
+  if (via)
+    SET_FLAG (VIAFLAG, line);
+  AddObjectToCreateUndoList (RATLINE_TYPE, line, line, line);
+  DrawRat (line);
+  rat_join_components (first, second);
+  return true;
+}
+
+/*!
+ * \brief Connects the subnets to the polygons they lie in, with rats
+ * of zero length, preferring vias (ie assume the user wants a via to
+ * a plane, not a daisy chain).
+ */
+static bool
+rat_connect_polygons (RatForestType *f, int n, bool vias,
+		      RouteStyleType *style,
+		      void (*funcp) (register ConnectionType *, register ConnectionType *, register RouteStyleType *))
+{
+  PolygonType *polygon;
+  bool changed = false;
+  int i, j, a, b;
+
+  for (i = 0; i < n; i++)
+    {
+      if (f->points[i].conn->type != POLYGON_TYPE
+	  || (polygon = (PolygonType *) f->points[i].conn->ptr2) == NULL)
+	continue;
+      for (j = 0; j < n; j++)
+	{
+	  ConnectionType *conn = f->points[j].conn;
+
+	  if ((conn->type == VIA_TYPE) != vias
+	      || conn->X < polygon->BoundingBox.X1
+	      || conn->X > polygon->BoundingBox.X2
+	      || conn->Y < polygon->BoundingBox.Y1
+	      || conn->Y > polygon->BoundingBox.Y2)
+	    continue;
+	  a = rat_find (f->parent, f->points[i].subnet);
+	  b = rat_find (f->parent, f->points[j].subnet);
+	  if (a == b || !IsPointInPolygonIgnoreHoles (conn->X, conn->Y,
+						      polygon))
+	    continue;
+	  f->parent[b] = a;
+	  changed |= rat_connect (conn, f->points[i].conn, true, style, funcp);
+	}
+    }
+  return changed;
+}
+
 /*!
  * \brief Draw a rat net (tree) having the shortest lines.
  *
@@ -572,8 +1173,12 @@ GatherSubnets (NetListType *Netl, bool NoWarn, bool AndRats)
  *
  * Each Connection is a vertex within that blob of connected items.
  *
- * This loop finds the closest vertex pairs between each blob and draws
- * rats that merge the blobs until there's just one big blob.
+ * This finds a minimum spanning forest of the blobs: first the blobs
+ * lying in a polygon of another blob are connected to it, then the
+ * blobs are joined to their nearest neighbours until there's just one
+ * big blob.  The nearest connections are found with a kd-tree, so a
+ * net of n connections takes O(n log n) steps per round, and each round
+ * at least halves the number of blobs.
  *
  * Just to clarify, with some examples:
  *
@@ -591,14 +1196,14 @@ GatherSubnets (NetListType *Netl, bool NoWarn, bool AndRats)
 static bool
 DrawShortestRats (NetListType *Netl, void (*funcp) (register ConnectionType *, register ConnectionType *, register RouteStyleType *))
 {
-  RatType *line;
-  register float distance, temp;
-  register ConnectionType *conn1, *conn2, *firstpoint, *secondpoint;
-  PolygonType *polygon;
+  RatForestType forest;
+  RouteStyleType *style;
   bool changed = false;
-  bool havepoints;
-  Cardinal n, m, j;
-  NetType *next, *subnet, *theSubnet = NULL;
+  bool merged = true;
+  int *best_point;
+  double *best_distance;
+  Cardinal j, m;
+  int n = 0, i, a, b;
 
   /* This is just a sanity check, to make sure we're passed
    * *something*.
@@ -606,120 +1211,98 @@ DrawShortestRats (NetListType *Netl, void (*funcp) (register ConnectionType *, r
   if (!Netl || Netl->NetN < 1)
     return false;
 
+  style = Netl->Net[0].Style;
+  for (j = 0; j < Netl->NetN; j++)
+    n += Netl->Net[j].ConnectionN;
+
+  forest.points = (RatPointType *) malloc (MAX (n, 1) * sizeof (RatPointType));
+  forest.nodes = (RatNodeType *) malloc (MAX (4 * n, 1) * sizeof (RatNodeType));
+  forest.parent = (int *) malloc (Netl->NetN * sizeof (int));
+  best_point = (int *) malloc (2 * MAX (n, 1) * sizeof (int));
+  best_distance = (double *) malloc (MAX (n, 1) * sizeof (double));
+
+  n = 0;
+  for (j = 0; j < Netl->NetN; j++)
+    {
+      forest.parent[j] = j;
+      for (m = 0; m < Netl->Net[j].ConnectionN; m++)
+	{
+	  forest.points[n].conn = &Netl->Net[j].Connection[m];
+	  forest.points[n].subnet = j;
+	  n++;
+	}
+    }
+
+  if (n > 0)
+    {
+      /* First the subnets over polygons, as those rats cost nothing */
+      changed |= rat_connect_polygons (&forest, n, true, style, funcp);
+      changed |= rat_connect_polygons (&forest, n, false, style, funcp);
+      rat_build (&forest, 0, 0, n);
+    }
+
   /*
-   * We keep doing this do/while loop until everything's connected.
-   * I.e. once per rat we add.
+   * Then Boruvka's algorithm: each round, every set of subnets is
+   * joined to its nearest neighbour, so there are at most log2(NetN)
+   * rounds of one nearest neighbour search per connection.
    */
-  distance = 0.0;
-  havepoints = true; /* so we run the loop at least once */
-  while (Netl->NetN > 1 && havepoints)
+  while (n > 0 && merged)
     {
-      /* This is the top of the "find one rat" logic.  */
-      havepoints = false;
-      firstpoint = secondpoint = NULL;
-
-      /* Test Net[0] vs Net[N] for N=1..max.  Find the shortest
-	 distance between any two points in different blobs.  */
-      subnet = &Netl->Net[0];
-      for (j = 1; j < Netl->NetN; j++)
+      merged = false;
+      for (i = 0; i < n; i++)
+	forest.points[i].root = rat_find (forest.parent,
+					  forest.points[i].subnet);
+      if (rat_label (&forest, 0, 0, n) >= 0)
+	break;
+
+      for (j = 0; j < Netl->NetN; j++)
+	best_point[2 * j] = -1;
+      for (i = 0; i < n; i++)
 	{
-	  /*
-	   * Scan between Net[0] blob (subnet) and Net[N] blob (next).
-	   * Note the shortest distance we find.
-	   */
-	  next = &Netl->Net[j];
-	  for (n = subnet->ConnectionN - 1; n != -1; n--)
+	  double distance = G_MAXDOUBLE;
+	  int found = -1;
+
+	  rat_nearest (&forest, 0, 0, n, i, &distance, &found);
+	  a = forest.points[i].root;
+	  if (found >= 0
+	      && (best_point[2 * a] < 0 || distance < best_distance[a]))
 	    {
-	      conn1 = &subnet->Connection[n];
-	      for (m = next->ConnectionN - 1; m != -1; m--)
-		{
-		  conn2 = &next->Connection[m];
-		  /*
-		   * At this point, conn1 and conn2 are two pins in
-		   * different blobs of the same net.  See how far
-		   * apart they are, and if they're "closer" than what
-		   * we already have.
-		   */
-
-		  /*
-		   * Prefer to connect Connections over polygons to the
-		   * polygons (ie assume the user wants a via to a plane,
-		   * not a daisy chain).  Further prefer to pick an existing
-		   * via in the Net to make that connection.
-		   */
-		  if (conn1->type == POLYGON_TYPE &&
-		      (polygon = (PolygonType *)conn1->ptr2) &&
-		      !(distance == 0 &&
-		        firstpoint && firstpoint->type == VIA_TYPE) &&
-		      IsPointInPolygonIgnoreHoles (conn2->X, conn2->Y, polygon))
-		    {
-		      distance = 0;
-		      firstpoint = conn2;
-		      secondpoint = conn1;
-		      theSubnet = next;
-		      havepoints = true;
-		    }
-		  else if (conn2->type == POLYGON_TYPE &&
-		      (polygon = (PolygonType *)conn2->ptr2) &&
-		      !(distance == 0 &&
-		        firstpoint && firstpoint->type == VIA_TYPE) &&
-		      IsPointInPolygonIgnoreHoles (conn1->X, conn1->Y, polygon))
-		    {
-		      distance = 0;
-		      firstpoint = conn1;
-		      secondpoint = conn2;
-		      theSubnet = next;
-		      havepoints = true;
-		    }
-		  else if ((temp = SQUARE (conn1->X - conn2->X) +
-		       SQUARE (conn1->Y - conn2->Y)) < distance || !firstpoint)
-		    {
-		      distance = temp;
-		      firstpoint = conn1;
-		      secondpoint = conn2;
-		      theSubnet = next;
-		      havepoints = true;
-		    }
-		}
+	      best_point[2 * a] = i;
+	      best_point[2 * a + 1] = found;
+	      best_distance[a] = distance;
 	    }
 	}
 
-      /*
-       * If HAVEPOINTS is true, we've found a pair of points in two
-       * separate blobs of the net, and need to connect them together.
-       */
-      if (havepoints)
+      for (j = 0; j < Netl->NetN; j++)
 	{
-	  if (funcp)
-	    {
-	      (*funcp) (firstpoint, secondpoint, subnet->Style);
-	    }
-	  else
-	    {
-	      /* found the shortest distance subnet, draw the rat */
-	      if ((line = CreateNewRat (PCB->Data,
-					firstpoint->X, firstpoint->Y,
-					secondpoint->X, secondpoint->Y,
-					firstpoint->group, secondpoint->group,
-					Settings.RatThickness,
-					NoFlags ())) != NULL)
-		{
-		  if (distance == 0)
-		    SET_FLAG (VIAFLAG, line);
-		  AddObjectToCreateUndoList (RATLINE_TYPE, line, line, line);
-		  DrawRat (line);
-		  changed = true;
-		}
-	    }
+	  ConnectionType *first, *second;
 
-	  /* copy theSubnet into the current subnet */
-	  TransferNet (Netl, theSubnet, subnet);
+	  if (best_point[2 * j] < 0)
+	    continue;
+	  first = forest.points[best_point[2 * j]].conn;
+	  second = forest.points[best_point[2 * j + 1]].conn;
+	  a = rat_find (forest.parent, forest.points[best_point[2 * j]].subnet);
+	  b = rat_find (forest.parent,
+			forest.points[best_point[2 * j + 1]].subnet);
+	  if (a == b)
+	    continue;
+	  forest.parent[b] = a;
+	  merged = true;
+	  changed |= rat_connect (first, second, best_distance[j] == 0,
+				  style, funcp);
 	}
     }
 
-  /* presently nothing to do with the new subnet */
-  /* so we throw it away and free the space */
-  FreeNetMemory (&Netl->Net[--(Netl->NetN)]);
+  free (forest.points);
+  free (forest.nodes);
+  free (forest.parent);
+  free (best_point);
+  free (best_distance);
+
+  /* presently nothing to do with the subnets */
+  /* so we throw them away and free the space */
+  while (Netl->NetN > 0)
+    FreeNetMemory (&Netl->Net[--(Netl->NetN)]);
   /* Sadly adding a rat line messes up the sorted arrays in connection finder */
   /* hace: perhaps not necessarily now that they aren't stored in normal layers */
   if (changed)
@@ -732,34 +1315,21 @@ DrawShortestRats (NetListType *Netl, void (*funcp) (register ConnectionType *, r
 
 
 /*!
- * \brief AddAllRats puts the rats nest into the layout from the loaded
- * netlist.
- *
- * If SelectedOnly is true, it will only draw rats to selected pins and
- * pads.
+ * \brief Adds the rats of the nets in Wantlist, or passes them to
+ * funcp.
  */
-bool
-AddAllRats (bool SelectedOnly, void (*funcp) (register ConnectionType *, register ConnectionType *, register RouteStyleType *))
+static bool
+AddNetRats (NetListType *Wantlist, bool SelectedOnly, bool *Warned,
+	    void (*funcp) (register ConnectionType *, register ConnectionType *, register RouteStyleType *))
 {
-  NetListType *Nets, *Wantlist;
+  NetListType *Nets;
   NetType *lonesome;
   ConnectionType *onepin;
-  bool changed, Warned = false;
+  bool changed = false;
 
-  /* the netlist library has the text form
-   * ProcNetlist fills in the Netlist
-   * structure the way the final routing
-   * is supposed to look
-   */
-  Wantlist = ProcNetlist (&PCB->NetlistLib);
-  if (!Wantlist)
-    {
-      Message (_("Can't add rat lines because no netlist is loaded.\n"));
-      return (false);
-    }
-  changed = false;
   /* initialize finding engine */
   InitConnectionLookup ();
+  LabelComponents (Wantlist, SelectedOnly, true);
   Nets = (NetListType *)calloc (1, sizeof (NetListType));
   /* now we build another netlist (Nets) for each
    * net in Wantlist that shows how it actually looks now,
@@ -787,14 +1357,46 @@ AddAllRats (bool SelectedOnly, void (*funcp) (register ConnectionType *, registe
 	}
     }
     END_LOOP;
-    Warned |= GatherSubnets (Nets, SelectedOnly, true);
+    *Warned |= GatherSubnets (Nets, SelectedOnly);
     if (Nets->NetN > 0)
       changed |= DrawShortestRats (Nets, funcp);
   }
   END_LOOP;
   FreeNetListMemory (Nets);
   free (Nets);
+  FreeComponents ();
   FreeConnectionLookupMemory ();
+  return (changed);
+}
+
+/*!
+ * \brief AddAllRats puts the rats nest into the layout from the loaded
+ * netlist.
+ *
+ * If SelectedOnly is true, it will only draw rats to selected pins and
+ * pads.
+ */
+bool
+AddAllRats (bool SelectedOnly, void (*funcp) (register ConnectionType *, register ConnectionType *, register RouteStyleType *))
+{
+  NetListType *Wantlist;
+  bool changed, Warned = false;
+
+  /* the netlist library has the text form
+   * ProcNetlist fills in the Netlist
+   * structure the way the final routing
+   * is supposed to look
+   */
+  Wantlist = ProcNetlist (&PCB->NetlistLib);
+  if (!Wantlist)
+    {
+      Message (_("Can't add rat lines because no netlist is loaded.\n"));
+      return (false);
+    }
+  /* all the nets are visited, so clear any stale mark that could stop
+   * a lookup */
+  ClearFlagOnAllObjects (DRCFLAG, false);
+  changed = AddNetRats (Wantlist, SelectedOnly, &Warned, funcp);
   if (funcp)
     return (true);
 
@@ -827,6 +1429,64 @@ AddAllRats (bool SelectedOnly, void (*funcp) (register ConnectionType *, registe
   return (false);
 }
 
+/*!
+ * \brief Replaces the rats of the nets connected to an element.
+ *
+ * The rats on the copper of these nets are deleted and the nets are
+ * connected again as by AddAllRats(), while the rest of the rats nest
+ * is left alone.  This keeps the rats nest up to date as elements are
+ * moved, rotated, flipped or pasted, see the live-rats option.
+ *
+ * Only the nets of the element and their copper are visited.  The
+ * changes go into the current undo step, so undo and redo bring back
+ * the rats with the element and need no update of their own.
+ *
+ * \return true if any rat was deleted or added.
+ */
+bool
+UpdateElementRats (ElementType *Element)
+{
+  NetListType *Wantlist, Dirty = { 0, 0, NULL };
+  GArray *nets;
+  GPtrArray *rats;
+  bool changed, Warned = false;
+  guint i;
+
+  Wantlist = rat_wantlist (&PCB->NetlistLib);
+  if (!Wantlist
+      || (nets = (GArray *) g_hash_table_lookup (element_nets,
+						 Element)) == NULL)
+    return (false);
+  for (i = 0; i < nets->len; i++)
+    {
+      NetType *net = &Wantlist->Net[g_array_index (nets, Cardinal, i)];
+
+      rat_refresh_net (net);
+      /* shares the connections of Wantlist */
+      *GetNetMemory (&Dirty) = *net;
+    }
+
+  InitConnectionLookup ();
+  LabelComponents (&Dirty, false, true);
+  rats = components.rats;
+  components.rats = NULL;
+  FreeComponents ();
+  FreeConnectionLookupMemory ();
+  for (i = 0; i < rats->len; i++)
+    RemoveObject (RATLINE_TYPE, rats->pdata[i], rats->pdata[i],
+		  rats->pdata[i]);
+  changed = rats->len > 0;
+  g_ptr_array_free (rats, TRUE);
+
+  changed |= AddNetRats (&Dirty, false, &Warned, NULL);
+  free (Dirty.Net);
+  if (Warned)
+    Settings.RatWarn = true;
+  if (Warned || changed)
+    Draw ();
+  return (changed);
+}
+
 /*!
  * \todo This is copied in large part from AddAllRats above; for
  * maintainability, AddAllRats probably wants to be tweaked to use this
@@ -851,8 +1511,11 @@ CollectSubnets (bool SelectedOnly)
       Message (_("Can't add rat lines because no netlist is loaded.\n"));
       return result;
     }
+  ClearFlagOnAllObjects (DRCFLAG, false);
   /* initialize finding engine */
   InitConnectionLookup ();
+  /* Note that AndRats is *FALSE* here! */
+  LabelComponents (Wantlist, SelectedOnly, false);
   /* now we build another netlist (Nets) for each
    * net in Wantlist that shows how it actually looks now,
    * then fill in any missing connections with rat lines.
@@ -880,10 +1543,10 @@ CollectSubnets (bool SelectedOnly)
 	}
     }
     END_LOOP;
-    /* Note that AndRats is *FALSE* here! */
-    GatherSubnets (Nets, SelectedOnly, false);
+    GatherSubnets (Nets, SelectedOnly);
   }
   END_LOOP;
+  FreeComponents ();
   FreeConnectionLookupMemory ();
   return result;
 }
@@ -50,6 +50,8 @@ bool AddAllRats (bool, void (*)(register ConnectionType *, register ConnectionTy
 bool SeekPad (LibraryEntryType *, ConnectionType *, bool);
 
 NetListType * ProcNetlist (LibraryType *);
+void InvalidateNetlist (void);
+bool UpdateElementRats (ElementType *);
 NetListListType CollectSubnets (bool);
 
 #endif
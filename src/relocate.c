@@ -83,11 +83,11 @@ relocate (int argc, char **argv, Coord x, Coord y)
         dy -= (element->MarkY + dy) % PCB->Grid;
         dy += PCB->Grid;
 
-        /* move the element. */
-        MoveElementLowLevel (PCB->Data, element, dx, dy);
-
         /* add to the undo list. */
         AddObjectToMoveUndoList (ELEMENT_TYPE, NULL, NULL, element, dx, dy);
+
+        /* move the element. */
+        MoveElementLowLevel (PCB->Data, element, dx, dy);
       }
   }
   END_LOOP;
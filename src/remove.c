@@ -253,6 +253,8 @@ DestroyText (LayerType *Layer, TextType *Text)
 static void *
 DestroyElement (ElementType *Element)
 {
+  if (DestroyTarget == PCB->Data)
+    InvalidateNetlist ();
   if (DestroyTarget->element_tree)
     r_delete_entry (DestroyTarget->element_tree, (BoxType *) Element);
   if (DestroyTarget->pin_tree)
@@ -47,6 +47,7 @@
 #include "error.h"
 #include "misc.h"
 #include "polygon.h"
+#include "rats.h"
 #include "rotate.h"
 #include "rtree.h"
 #include "rubberband.h"
@@ -412,6 +413,9 @@ RotateObject (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 			     Number);
   ptr2 = ObjectOperation (&RotateFunctions, Type, Ptr1, Ptr2, Ptr3);
   changed |= (ptr2 != NULL);
+  /* the rats are replaced in the same undo step as the rotation */
+  if (Type == ELEMENT_TYPE && ptr2 && Settings.LiveRats)
+    UpdateElementRats ((ElementType *) ptr2);
   if (changed)
     {
       Draw ();
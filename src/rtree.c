@@ -52,6 +52,7 @@
 #include <setjmp.h>
 
 #include "mymem.h"
+#include "profile.h"
 
 #include "rtree.h"
 
@@ -1053,6 +1054,7 @@ r_insert_entry (rtree_t * rtree, const BoxType * which, int man)
   assert (which);
   assert (which->X1 <= which->X2);
   assert (which->Y1 <= which->Y2);
+  PROFILE_PUSH (PROFILE_RTREE);
   /* recursively search the tree for the best leaf node */
   assert (rtree->root);
   __r_insert_node (rtree->root, which, man,
@@ -1061,6 +1063,7 @@ r_insert_entry (rtree_t * rtree, const BoxType * which, int man)
                    || rtree->root->box.Y1 > which->Y1
                    || rtree->root->box.Y2 < which->Y2);
   rtree->size++;
+  PROFILE_POP ();
 }
 
 bool
@@ -100,12 +100,12 @@ place (ElementType *element)
     return;
   }
 
-  /* move the element */
-  MoveElementLowLevel (PCB->Data, element, dx, dy);
-
   /* and add to the undo list so we can undo this operation */
   AddObjectToMoveUndoList (ELEMENT_TYPE, NULL, NULL, element, dx, dy);
 
+  /* move the element */
+  MoveElementLowLevel (PCB->Data, element, dx, dy);
+
   /* keep track of how tall this row is */
   minx += element->BoundingBox.X2 - element->BoundingBox.X1 + GAP;
   if (maxy < element->BoundingBox.Y2)
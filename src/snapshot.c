@@ -0,0 +1,1574 @@
+/*!
+ * \file src/snapshot.c
+ *
+ * \brief Binary board snapshots.
+ *
+ * A snapshot holds the same data as a .pcb file, but as fixed-size
+ * little endian records which load without any parsing:
+ *
+ * - a header: the magic "PCBSNAP\n", the format version and the number
+ *   of sections;
+ *
+ * - the section index: kind, layer, number of records, record size,
+ *   file offset and size of each section, plus the bounding box of the
+ *   objects in it;
+ *
+ * - the sections themselves.  Objects are stored per type, and per
+ *   layer for layer objects, so a layer can be found (and skipped)
+ *   through the index alone.  Child objects, like the pins of an
+ *   element or the points of a polygon, live in their own sections in
+ *   the order of their parents.
+ *
+ * The loader uses the index only to find each section; it still loads
+ * every layer, and nothing reads the section bounding boxes yet.
+ *
+ * All strings go into one string table and are referred to by offset,
+ * so repeated names and flag strings are stored once.  Flags, layer
+ * groups, route styles and layer types are stored in their .pcb file
+ * spelling and are converted with the same functions the parser uses.
+ * Objects are then created with the same calls and in the same order as
+ * the parser would create them from the .pcb file which WritePCB()
+ * writes for the board.  This way, saving a loaded snapshot as .pcb
+ * gives the same file as saving the original board.
+ *
+ * Save with SaveTo(Snapshot, filename); snapshots are recognized by
+ * their magic wherever a layout is loaded, so they work with LoadFrom(),
+ * on the command line and with the exporters.
+ *
+ * <hr>
+ *
+ * <h1><b>Copyright.</b></h1>\n
+ *
+ * PCB, interactive printed circuit board design
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "global.h"
+
+#include "create.h"
+#include "data.h"
+#include "error.h"
+#include "layerflags.h"
+#include "misc.h"
+#include "polygon.h"
+#include "profile.h"
+#include "remove.h"
+#include "rtree.h"
+#include "snapshot.h"
+#include "strflags.h"
+
+#ifdef HAVE_LIBDMALLOC
+#include <dmalloc.h>
+#endif
+
+#define SNAPSHOT_MAGIC "PCBSNAP\n"
+#define SNAPSHOT_MAGIC_LEN 8
+#define SNAPSHOT_VERSION 1
+
+/*! Size of the file header and of one index entry. */
+#define SNAPSHOT_HEADER_SIZE 16
+#define SNAPSHOT_INDEX_SIZE 64
+
+/*! Layer of sections that don't belong to one. */
+#define SNAPSHOT_NO_LAYER 0xffffffff
+
+/*!
+ * \brief Section kinds.
+ *
+ * These are stored in files, so only ever add to the end.
+ */
+enum snapshot_kind
+{
+  SNAP_STRINGS = 1,	/*!< NUL separated strings, offset 0 is "". */
+  SNAP_HEADER,		/*!< One record with the PCBType settings. */
+  SNAP_SYMBOLS,
+  SNAP_SYMBOL_LINES,
+  SNAP_ATTRIBUTES,
+  SNAP_VIAS,
+  SNAP_ELEMENTS,
+  SNAP_PINS,
+  SNAP_PADS,
+  SNAP_ELEMENT_LINES,
+  SNAP_ELEMENT_ARCS,
+  SNAP_RATS,
+  SNAP_LAYER,		/*!< One record with the layer name and type. */
+  SNAP_LINES,
+  SNAP_ARCS,
+  SNAP_TEXTS,
+  SNAP_POLYGONS,
+  SNAP_POLYGON_POINTS,
+  SNAP_POLYGON_HOLES,
+  SNAP_NETS,
+  SNAP_CONNECTIONS
+};
+
+/*! Owners of attribute records. */
+enum
+{
+  SNAP_ATTR_PCB,
+  SNAP_ATTR_LAYER,
+  SNAP_ATTR_ELEMENT
+};
+
+/* Record sizes of the sections; readers accept longer records, so
+ * fields can be added at the end of a record in later versions.
+ */
+#define REC_HEADER		(4 + 5 * 8 + 4 + 2 * 8 + 6 * 8 + 3 * 4)
+#define REC_SYMBOL		(2 * 4 + 8)
+#define REC_SYMBOL_LINE		(5 * 8)
+#define REC_ATTRIBUTE		(4 * 4)
+#define REC_VIA			(6 * 8 + 4 * 4)
+#define REC_ELEMENT		(4 * 4 + 4 * 8 + 3 * 4 + 4 * 4)
+#define REC_PIN			(6 * 8 + 3 * 4)
+#define REC_PAD			(7 * 8 + 3 * 4)
+#define REC_ELEMENT_LINE	(5 * 8)
+#define REC_ELEMENT_ARC		(5 * 8 + 2 * 8)
+#define REC_RAT			(4 * 8 + 3 * 4)
+#define REC_LAYER		(2 * 4)
+#define REC_LINE		(6 * 8 + 4)
+#define REC_ARC			(6 * 8 + 2 * 8 + 4)
+#define REC_TEXT		(2 * 8 + 4 * 4)
+#define REC_POLYGON		(3 * 4)
+#define REC_POLYGON_POINT	(2 * 8)
+#define REC_POLYGON_HOLE	(4)
+#define REC_NET			(3 * 4)
+#define REC_CONNECTION		(4)
+
+/* ---------------------------------------------------------------------------
+ * writing
+ */
+
+typedef struct
+{
+  enum snapshot_kind kind;
+  guint32 layer;
+  guint32 count;
+  guint32 record_size;
+  GByteArray *data;
+  BoxType box;
+} snap_section;
+
+typedef struct
+{
+  GPtrArray *sections;
+  GByteArray *strings;
+  GHashTable *string_ids;
+} snap_writer;
+
+static void
+put_u32 (GByteArray *b, guint32 v)
+{
+  guint8 buf[4];
+
+  buf[0] = v;
+  buf[1] = v >> 8;
+  buf[2] = v >> 16;
+  buf[3] = v >> 24;
+  g_byte_array_append (b, buf, 4);
+}
+
+static void
+put_u64 (GByteArray *b, guint64 v)
+{
+  put_u32 (b, (guint32) v);
+  put_u32 (b, (guint32) (v >> 32));
+}
+
+static void
+put_coord (GByteArray *b, Coord c)
+{
+  put_u64 (b, (guint64) (gint64) c);
+}
+
+static void
+put_double (GByteArray *b, double d)
+{
+  guint64 v;
+
+  memcpy (&v, &d, sizeof (v));
+  put_u64 (b, v);
+}
+
+/*!
+ * \brief Return the string table offset of a string, adding it to the
+ * table if it isn't there yet.
+ *
+ * NULL is stored like "", as the .pcb file does.
+ */
+static guint32
+intern (snap_writer *w, const char *s)
+{
+  gpointer id;
+
+  if (s == NULL || *s == '\0')
+    return 0;
+  if (g_hash_table_lookup_extended (w->string_ids, s, NULL, &id))
+    return GPOINTER_TO_UINT (id);
+
+  id = GUINT_TO_POINTER (w->strings->len);
+  g_byte_array_append (w->strings, (const guint8 *) s, strlen (s) + 1);
+  g_hash_table_insert (w->string_ids, g_strdup (s), id);
+  return GPOINTER_TO_UINT (id);
+}
+
+static guint32
+intern_flags (snap_writer *w, FlagType flags, int type)
+{
+  return intern (w, flags_to_string (flags, type));
+}
+
+static snap_section *
+new_section (snap_writer *w, enum snapshot_kind kind, guint32 layer,
+	     guint32 record_size)
+{
+  snap_section *s = g_new0 (snap_section, 1);
+
+  s->kind = kind;
+  s->layer = layer;
+  s->record_size = record_size;
+  s->data = g_byte_array_new ();
+  s->box.X1 = s->box.Y1 = MAX_COORD;
+  s->box.X2 = s->box.Y2 = -MAX_COORD;
+  g_ptr_array_add (w->sections, s);
+  return s;
+}
+
+/*!
+ * \brief Count a record and grow the section's bounding box by the
+ * record's object.
+ */
+static void
+add_record (snap_section *s, const BoxType *box)
+{
+  s->count++;
+  if (box != NULL)
+    {
+      MAKEMIN (s->box.X1, box->X1);
+      MAKEMIN (s->box.Y1, box->Y1);
+      MAKEMAX (s->box.X2, box->X2);
+      MAKEMAX (s->box.Y2, box->Y2);
+    }
+}
+
+static void
+write_attributes (snap_writer *w, snap_section *s, guint32 owner_type,
+		  guint32 owner, AttributeListType *list)
+{
+  int i;
+
+  for (i = 0; i < list->Number; i++)
+    {
+      put_u32 (s->data, owner_type);
+      put_u32 (s->data, owner);
+      put_u32 (s->data, intern (w, list->List[i].name));
+      put_u32 (s->data, intern (w, list->List[i].value));
+      add_record (s, NULL);
+    }
+}
+
+static void
+write_header (snap_writer *w)
+{
+  snap_section *s = new_section (w, SNAP_HEADER, SNAPSHOT_NO_LAYER,
+				 REC_HEADER);
+  char *str;
+
+  put_u32 (s->data, intern (w, PCB->Name));
+  put_coord (s->data, PCB->MaxWidth);
+  put_coord (s->data, PCB->MaxHeight);
+  put_coord (s->data, PCB->Grid);
+  put_coord (s->data, PCB->GridOffsetX);
+  put_coord (s->data, PCB->GridOffsetY);
+  put_u32 (s->data, Settings.DrawGrid);
+  put_double (s->data, PCB->IsleArea);
+  put_double (s->data, PCB->ThermScale);
+  put_coord (s->data, PCB->Bloat);
+  put_coord (s->data, PCB->Shrink);
+  put_coord (s->data, PCB->minWid);
+  put_coord (s->data, PCB->minSlk);
+  put_coord (s->data, PCB->minDrill);
+  put_coord (s->data, PCB->minRing);
+  put_u32 (s->data, intern (w, pcbflags_to_string (PCB->Flags)));
+  put_u32 (s->data, intern (w, LayerGroupsToString (&PCB->LayerGroups)));
+  str = make_route_string (PCB->RouteStyle, NUM_STYLES);
+  put_u32 (s->data, intern (w, str));
+  g_free (str);
+  add_record (s, NULL);
+}
+
+static void
+write_font (snap_writer *w)
+{
+  snap_section *symbols = NULL, *lines = NULL;
+  FontType *font = &PCB->Font;
+  Cardinal i, j;
+
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    {
+      if (!font->Symbol[i].Valid)
+	continue;
+      if (symbols == NULL)
+	{
+	  symbols = new_section (w, SNAP_SYMBOLS, SNAPSHOT_NO_LAYER,
+				 REC_SYMBOL);
+	  lines = new_section (w, SNAP_SYMBOL_LINES, SNAPSHOT_NO_LAYER,
+			       REC_SYMBOL_LINE);
+	}
+      put_u32 (symbols->data, i);
+      put_u32 (symbols->data, font->Symbol[i].LineN);
+      put_coord (symbols->data, font->Symbol[i].Delta);
+      add_record (symbols, NULL);
+      for (j = 0; j < font->Symbol[i].LineN; j++)
+	{
+	  LineType *line = &font->Symbol[i].Line[j];
+
+	  put_coord (lines->data, line->Point1.X);
+	  put_coord (lines->data, line->Point1.Y);
+	  put_coord (lines->data, line->Point2.X);
+	  put_coord (lines->data, line->Point2.Y);
+	  put_coord (lines->data, line->Thickness);
+	  add_record (lines, NULL);
+	}
+    }
+}
+
+static void
+write_vias (snap_writer *w)
+{
+  snap_section *s = new_section (w, SNAP_VIAS, SNAPSHOT_NO_LAYER, REC_VIA);
+  GList *iter;
+
+  for (iter = PCB->Data->Via; iter != NULL; iter = g_list_next (iter))
+    {
+      PinType *via = iter->data;
+
+      put_coord (s->data, via->X);
+      put_coord (s->data, via->Y);
+      put_coord (s->data, via->Thickness);
+      put_coord (s->data, via->Clearance);
+      put_coord (s->data, via->Mask);
+      put_coord (s->data, via->DrillingHole);
+      put_u32 (s->data, via->BuriedFrom);
+      put_u32 (s->data, via->BuriedTo);
+      put_u32 (s->data, intern (w, via->Name));
+      put_u32 (s->data, intern_flags (w, via->Flags, VIA_TYPE));
+      add_record (s, &via->BoundingBox);
+    }
+}
+
+static void
+write_elements (snap_writer *w, snap_section *attributes)
+{
+  snap_section *s = new_section (w, SNAP_ELEMENTS, SNAPSHOT_NO_LAYER,
+				 REC_ELEMENT);
+  snap_section *pins = new_section (w, SNAP_PINS, SNAPSHOT_NO_LAYER,
+				    REC_PIN);
+  snap_section *pads = new_section (w, SNAP_PADS, SNAPSHOT_NO_LAYER,
+				    REC_PAD);
+  snap_section *lines = new_section (w, SNAP_ELEMENT_LINES,
+				     SNAPSHOT_NO_LAYER, REC_ELEMENT_LINE);
+  snap_section *arcs = new_section (w, SNAP_ELEMENT_ARCS,
+				    SNAPSHOT_NO_LAYER, REC_ELEMENT_ARC);
+  GList *n, *p;
+
+  for (n = PCB->Data->Element; n != NULL; n = g_list_next (n))
+    {
+      ElementType *element = n->data;
+      TextType *text = &DESCRIPTION_TEXT (element);
+
+      /* WriteElementData() drops empty elements too */
+      if (!element->LineN && !element->PinN && !element->ArcN
+	  && !element->PadN)
+	continue;
+
+      put_u32 (s->data, intern_flags (w, element->Flags, ELEMENT_TYPE));
+      put_u32 (s->data, intern (w, DESCRIPTION_NAME (element)));
+      put_u32 (s->data, intern (w, NAMEONPCB_NAME (element)));
+      put_u32 (s->data, intern (w, VALUE_NAME (element)));
+      put_coord (s->data, element->MarkX);
+      put_coord (s->data, element->MarkY);
+      put_coord (s->data, text->X);
+      put_coord (s->data, text->Y);
+      put_u32 (s->data, text->Direction);
+      put_u32 (s->data, (guint32) text->Scale);
+      put_u32 (s->data, intern_flags (w, text->Flags, ELEMENTNAME_TYPE));
+      put_u32 (s->data, element->PinN);
+      put_u32 (s->data, element->PadN);
+      put_u32 (s->data, element->LineN);
+      put_u32 (s->data, element->ArcN);
+      write_attributes (w, attributes, SNAP_ATTR_ELEMENT, s->count,
+			&element->Attributes);
+      add_record (s, &element->BoundingBox);
+
+      for (p = element->Pin; p != NULL; p = g_list_next (p))
+	{
+	  PinType *pin = p->data;
+
+	  put_coord (pins->data, pin->X);
+	  put_coord (pins->data, pin->Y);
+	  put_coord (pins->data, pin->Thickness);
+	  put_coord (pins->data, pin->Clearance);
+	  put_coord (pins->data, pin->Mask);
+	  put_coord (pins->data, pin->DrillingHole);
+	  put_u32 (pins->data, intern (w, pin->Name));
+	  put_u32 (pins->data, intern (w, pin->Number));
+	  put_u32 (pins->data, intern_flags (w, pin->Flags, PIN_TYPE));
+	  add_record (pins, &pin->BoundingBox);
+	}
+      for (p = element->Pad; p != NULL; p = g_list_next (p))
+	{
+	  PadType *pad = p->data;
+
+	  put_coord (pads->data, pad->Point1.X);
+	  put_coord (pads->data, pad->Point1.Y);
+	  put_coord (pads->data, pad->Point2.X);
+	  put_coord (pads->data, pad->Point2.Y);
+	  put_coord (pads->data, pad->Thickness);
+	  put_coord (pads->data, pad->Clearance);
+	  put_coord (pads->data, pad->Mask);
+	  put_u32 (pads->data, intern (w, pad->Name));
+	  put_u32 (pads->data, intern (w, pad->Number));
+	  put_u32 (pads->data, intern_flags (w, pad->Flags, PAD_TYPE));
+	  add_record (pads, &pad->BoundingBox);
+	}
+      for (p = element->Line; p != NULL; p = g_list_next (p))
+	{
+	  LineType *line = p->data;
+
+	  put_coord (lines->data, line->Point1.X);
+	  put_coord (lines->data, line->Point1.Y);
+	  put_coord (lines->data, line->Point2.X);
+	  put_coord (lines->data, line->Point2.Y);
+	  put_coord (lines->data, line->Thickness);
+	  add_record (lines, &line->BoundingBox);
+	}
+      for (p = element->Arc; p != NULL; p = g_list_next (p))
+	{
+	  ArcType *arc = p->data;
+
+	  put_coord (arcs->data, arc->X);
+	  put_coord (arcs->data, arc->Y);
+	  put_coord (arcs->data, arc->Width);
+	  put_coord (arcs->data, arc->Height);
+	  put_coord (arcs->data, arc->Thickness);
+	  put_double (arcs->data, arc->StartAngle);
+	  put_double (arcs->data, arc->Delta);
+	  add_record (arcs, &arc->BoundingBox);
+	}
+    }
+}
+
+static void
+write_rats (snap_writer *w)
+{
+  snap_section *s = new_section (w, SNAP_RATS, SNAPSHOT_NO_LAYER, REC_RAT);
+  GList *iter;
+
+  for (iter = PCB->Data->Rat; iter != NULL; iter = g_list_next (iter))
+    {
+      RatType *line = iter->data;
+
+      put_coord (s->data, line->Point1.X);
+      put_coord (s->data, line->Point1.Y);
+      put_coord (s->data, line->Point2.X);
+      put_coord (s->data, line->Point2.Y);
+      put_u32 (s->data, line->group1);
+      put_u32 (s->data, line->group2);
+      put_u32 (s->data, intern_flags (w, line->Flags, RATLINE_TYPE));
+      add_record (s, &line->BoundingBox);
+    }
+}
+
+static void
+write_layer (snap_writer *w, snap_section *attributes, Cardinal number,
+	     LayerType *layer)
+{
+  snap_section *s, *lines, *arcs, *texts, *polygons, *points, *holes;
+  GList *n;
+
+  /* WriteLayerData() skips the same layers */
+  if (!(layer->LineN || layer->ArcN || layer->TextN || layer->PolygonN ||
+	(layer->Name && *layer->Name)))
+    return;
+
+  s = new_section (w, SNAP_LAYER, number, REC_LAYER);
+  put_u32 (s->data, intern (w, layer->Name));
+  put_u32 (s->data, intern (w, layertype_to_string (layer->Type)));
+  add_record (s, NULL);
+  write_attributes (w, attributes, SNAP_ATTR_LAYER, number,
+		    &layer->Attributes);
+
+  lines = new_section (w, SNAP_LINES, number, REC_LINE);
+  for (n = layer->Line; n != NULL; n = g_list_next (n))
+    {
+      LineType *line = n->data;
+
+      put_coord (lines->data, line->Point1.X);
+      put_coord (lines->data, line->Point1.Y);
+      put_coord (lines->data, line->Point2.X);
+      put_coord (lines->data, line->Point2.Y);
+      put_coord (lines->data, line->Thickness);
+      put_coord (lines->data, line->Clearance);
+      put_u32 (lines->data, intern_flags (w, line->Flags, LINE_TYPE));
+      add_record (lines, &line->BoundingBox);
+    }
+
+  arcs = new_section (w, SNAP_ARCS, number, REC_ARC);
+  for (n = layer->Arc; n != NULL; n = g_list_next (n))
+    {
+      ArcType *arc = n->data;
+
+      put_coord (arcs->data, arc->X);
+      put_coord (arcs->data, arc->Y);
+      put_coord (arcs->data, arc->Width);
+      put_coord (arcs->data, arc->Height);
+      put_coord (arcs->data, arc->Thickness);
+      put_coord (arcs->data, arc->Clearance);
+      put_double (arcs->data, arc->StartAngle);
+      put_double (arcs->data, arc->Delta);
+      put_u32 (arcs->data, intern_flags (w, arc->Flags, ARC_TYPE));
+      add_record (arcs, &arc->BoundingBox);
+    }
+
+  texts = new_section (w, SNAP_TEXTS, number, REC_TEXT);
+  for (n = layer->Text; n != NULL; n = g_list_next (n))
+    {
+      TextType *text = n->data;
+
+      put_coord (texts->data, text->X);
+      put_coord (texts->data, text->Y);
+      put_u32 (texts->data, text->Direction);
+      put_u32 (texts->data, (guint32) text->Scale);
+      put_u32 (texts->data, intern (w, text->TextString));
+      put_u32 (texts->data, intern_flags (w, text->Flags, TEXT_TYPE));
+      add_record (texts, &text->BoundingBox);
+    }
+
+  polygons = new_section (w, SNAP_POLYGONS, number, REC_POLYGON);
+  points = new_section (w, SNAP_POLYGON_POINTS, number, REC_POLYGON_POINT);
+  holes = new_section (w, SNAP_POLYGON_HOLES, number, REC_POLYGON_HOLE);
+  for (n = layer->Polygon; n != NULL; n = g_list_next (n))
+    {
+      PolygonType *polygon = n->data;
+      Cardinal i;
+
+      put_u32 (polygons->data, intern_flags (w, polygon->Flags,
+					     POLYGON_TYPE));
+      put_u32 (polygons->data, polygon->PointN);
+      put_u32 (polygons->data, polygon->HoleIndexN);
+      add_record (polygons, &polygon->BoundingBox);
+      for (i = 0; i < polygon->PointN; i++)
+	{
+	  put_coord (points->data, polygon->Points[i].X);
+	  put_coord (points->data, polygon->Points[i].Y);
+	  add_record (points, NULL);
+	}
+      for (i = 0; i < polygon->HoleIndexN; i++)
+	{
+	  put_u32 (holes->data, polygon->HoleIndex[i]);
+	  add_record (holes, NULL);
+	}
+    }
+}
+
+static void
+write_netlist (snap_writer *w)
+{
+  snap_section *nets, *connections;
+  Cardinal n, p;
+
+  if (!PCB->NetlistLib.MenuN)
+    return;
+
+  nets = new_section (w, SNAP_NETS, SNAPSHOT_NO_LAYER, REC_NET);
+  connections = new_section (w, SNAP_CONNECTIONS, SNAPSHOT_NO_LAYER,
+			     REC_CONNECTION);
+  for (n = 0; n < PCB->NetlistLib.MenuN; n++)
+    {
+      LibraryMenuType *menu = &PCB->NetlistLib.Menu[n];
+
+      /* Same strings as WritePCBNetlistData() */
+      put_u32 (nets->data, intern (w, &menu->Name[2]));
+      put_u32 (nets->data, intern (w, UNKNOWN (menu->Style)));
+      put_u32 (nets->data, menu->EntryN);
+      add_record (nets, NULL);
+      for (p = 0; p < menu->EntryN; p++)
+	{
+	  put_u32 (connections->data,
+		   intern (w, menu->Entry[p].ListEntry));
+	  add_record (connections, NULL);
+	}
+    }
+}
+
+/*!
+ * \brief Write the header, the index and the sections to a file.
+ */
+static int
+write_file (snap_writer *w, char *Filename)
+{
+  GByteArray *head = g_byte_array_new ();
+  guint64 offset;
+  guint i;
+  FILE *fp;
+  int result = STATUS_OK;
+
+  g_byte_array_append (head, (const guint8 *) SNAPSHOT_MAGIC,
+		       SNAPSHOT_MAGIC_LEN);
+  put_u32 (head, SNAPSHOT_VERSION);
+  put_u32 (head, w->sections->len);
+
+  offset = SNAPSHOT_HEADER_SIZE
+    + (guint64) w->sections->len * SNAPSHOT_INDEX_SIZE;
+  for (i = 0; i < w->sections->len; i++)
+    {
+      snap_section *s = g_ptr_array_index (w->sections, i);
+
+      if (s->box.X1 > s->box.X2)
+	s->box.X1 = s->box.Y1 = s->box.X2 = s->box.Y2 = 0;
+      put_u32 (head, s->kind);
+      put_u32 (head, s->layer);
+      put_u32 (head, s->count);
+      put_u32 (head, s->record_size);
+      put_u64 (head, offset);
+      put_u64 (head, s->data->len);
+      put_coord (head, s->box.X1);
+      put_coord (head, s->box.Y1);
+      put_coord (head, s->box.X2);
+      put_coord (head, s->box.Y2);
+      offset += s->data->len;
+    }
+
+  if ((fp = fopen (Filename, "wb")) == NULL)
+    {
+      OpenErrorMessage (Filename);
+      g_byte_array_free (head, TRUE);
+      return STATUS_ERROR;
+    }
+  fwrite (head->data, 1, head->len, fp);
+  for (i = 0; i < w->sections->len; i++)
+    {
+      snap_section *s = g_ptr_array_index (w->sections, i);
+
+      fwrite (s->data->data, 1, s->data->len, fp);
+    }
+  if (ferror (fp))
+    {
+      Message (_("Error writing snapshot %s\n"), Filename);
+      result = STATUS_ERROR;
+    }
+  if (fclose (fp) != 0)
+    result = STATUS_ERROR;
+  g_byte_array_free (head, TRUE);
+  return result;
+}
+
+static void
+free_section (gpointer data)
+{
+  snap_section *s = data;
+
+  g_byte_array_free (s->data, TRUE);
+  g_free (s);
+}
+
+/*!
+ * \brief Save the board as a binary snapshot.
+ */
+int
+SaveSnapshot (char *Filename)
+{
+  snap_writer w;
+  snap_section *strings, *attributes;
+  Cardinal i;
+  int result;
+
+  if (PCB->is_footprint)
+    {
+      Message (_("Footprints can't be saved as snapshots\n"));
+      return STATUS_ERROR;
+    }
+
+  w.sections = g_ptr_array_new_with_free_func (free_section);
+  w.strings = NULL;
+  w.string_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+					g_free, NULL);
+
+  /* The string table goes first, so a reader has it before anything
+   * that refers to it; it is filled in while writing the rest.
+   */
+  strings = new_section (&w, SNAP_STRINGS, SNAPSHOT_NO_LAYER, 1);
+  w.strings = strings->data;
+  g_byte_array_append (w.strings, (const guint8 *) "", 1);
+
+  write_header (&w);
+  write_font (&w);
+  attributes = new_section (&w, SNAP_ATTRIBUTES, SNAPSHOT_NO_LAYER,
+			    REC_ATTRIBUTE);
+  write_attributes (&w, attributes, SNAP_ATTR_PCB, 0, &PCB->Attributes);
+  write_vias (&w);
+  write_elements (&w, attributes);
+  write_rats (&w);
+  for (i = 0; i < max_copper_layer + SILK_LAYER; i++)
+    write_layer (&w, attributes, i, &PCB->Data->Layer[i]);
+  write_netlist (&w);
+  strings->count = w.strings->len;
+
+  result = write_file (&w, Filename);
+  if (result == STATUS_OK)
+    Message (_("Snapshot %s saved\n"), Filename);
+
+  g_hash_table_destroy (w.string_ids);
+  g_ptr_array_free (w.sections, TRUE);
+  return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * reading
+ */
+
+typedef struct
+{
+  guint32 kind;
+  guint32 layer;
+  guint32 count;
+  guint32 record_size;
+  const guint8 *data;
+  BoxType box;
+} snap_index;
+
+/*!
+ * \brief Reads the records of one section.
+ */
+typedef struct
+{
+  const snap_index *section;
+  guint32 next;			/*!< Index of the next record. */
+  const guint8 *p, *end;	/*!< Fields left in the current record. */
+} snap_cursor;
+
+typedef struct
+{
+  snap_index *index;
+  guint32 n_sections;
+  const char *strings;
+  guint32 strings_size;
+  GHashTable *flags;		/*!< Parsed flag strings by string offset. */
+  bool error;
+} snap_reader;
+
+static snap_reader *reader;
+
+static const snap_index *
+find_section (snap_reader *r, guint32 kind, guint32 layer)
+{
+  guint32 i;
+
+  for (i = 0; i < r->n_sections; i++)
+    if (r->index[i].kind == kind && r->index[i].layer == layer)
+      return &r->index[i];
+  return NULL;
+}
+
+static void
+cursor_init (snap_cursor *c, snap_reader *r, guint32 kind, guint32 layer)
+{
+  c->section = find_section (r, kind, layer);
+  c->next = 0;
+  c->p = c->end = NULL;
+}
+
+/*!
+ * \brief Step to the next record of a section.
+ *
+ * \return false, and flag an error, if there are no records left.
+ */
+static bool
+next_record (snap_cursor *c)
+{
+  const snap_index *s = c->section;
+
+  if (s == NULL || c->next >= s->count)
+    {
+      reader->error = true;
+      return false;
+    }
+  c->p = s->data + (gsize) c->next * s->record_size;
+  c->end = c->p + s->record_size;
+  c->next++;
+  return true;
+}
+
+static guint32
+get_u32 (snap_cursor *c)
+{
+  guint32 v;
+
+  if (c->end - c->p < 4)
+    {
+      reader->error = true;
+      return 0;
+    }
+  v = c->p[0] | (c->p[1] << 8) | (c->p[2] << 16) | ((guint32) c->p[3] << 24);
+  c->p += 4;
+  return v;
+}
+
+static guint64
+get_u64 (snap_cursor *c)
+{
+  guint64 lo = get_u32 (c);
+
+  return lo | ((guint64) get_u32 (c) << 32);
+}
+
+static Coord
+get_coord (snap_cursor *c)
+{
+  return (Coord) (gint64) get_u64 (c);
+}
+
+static double
+get_double (snap_cursor *c)
+{
+  guint64 v = get_u64 (c);
+  double d;
+
+  memcpy (&d, &v, sizeof (d));
+  return d;
+}
+
+/*!
+ * \brief Look up a string table offset.
+ *
+ * \return NULL for "", like the parser does for empty strings.
+ */
+static char *
+string_at (guint32 id)
+{
+  if (id >= reader->strings_size)
+    {
+      reader->error = true;
+      return NULL;
+    }
+  if (reader->strings[id] == '\0')
+    return NULL;
+  return (char *) reader->strings + id;
+}
+
+static char *
+get_string (snap_cursor *c)
+{
+  return string_at (get_u32 (c));
+}
+
+static int
+snapshot_error (const char *msg)
+{
+  Message (_("ERROR in snapshot: %s\n"), msg);
+  return 0;
+}
+
+/*!
+ * \brief Read a flags string reference; each distinct string is only
+ * parsed once.
+ */
+static FlagType
+get_flags (snap_cursor *c)
+{
+  guint32 id = get_u32 (c);
+  FlagType *flags;
+  char *str;
+
+  flags = g_hash_table_lookup (reader->flags, GUINT_TO_POINTER (id));
+  if (flags == NULL)
+    {
+      str = string_at (id);
+      flags = g_new (FlagType, 1);
+      *flags = string_to_flags (str ? str : "", snapshot_error);
+      g_hash_table_insert (reader->flags, GUINT_TO_POINTER (id), flags);
+    }
+  return *flags;
+}
+
+/*!
+ * \brief Check the header and read the section index of a snapshot.
+ */
+static bool
+read_index (snap_reader *r, const guint8 *data, gsize size)
+{
+  guint32 i, version;
+  snap_cursor c;
+  snap_index whole;
+  const snap_index *strings;
+
+  if (size < SNAPSHOT_HEADER_SIZE
+      || memcmp (data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0)
+    return false;
+
+  /* Read the fixed parts through a cursor over the whole file */
+  whole.data = data;
+  whole.count = 1;
+  whole.record_size = size;
+  c.section = &whole;
+  c.next = 0;
+  next_record (&c);
+  c.p += SNAPSHOT_MAGIC_LEN;
+  version = get_u32 (&c);
+  r->n_sections = get_u32 (&c);
+  if (version != SNAPSHOT_VERSION)
+    {
+      Message (_("Snapshot format version %u is not supported\n"), version);
+      return false;
+    }
+  if (r->n_sections > (size - SNAPSHOT_HEADER_SIZE) / SNAPSHOT_INDEX_SIZE)
+    return false;
+
+  r->index = g_new0 (snap_index, r->n_sections);
+  for (i = 0; i < r->n_sections; i++)
+    {
+      snap_index *s = &r->index[i];
+      guint64 offset, length;
+
+      s->kind = get_u32 (&c);
+      s->layer = get_u32 (&c);
+      s->count = get_u32 (&c);
+      s->record_size = get_u32 (&c);
+      offset = get_u64 (&c);
+      length = get_u64 (&c);
+      s->box.X1 = get_coord (&c);
+      s->box.Y1 = get_coord (&c);
+      s->box.X2 = get_coord (&c);
+      s->box.Y2 = get_coord (&c);
+      if (offset > size || length > size - offset || s->record_size == 0
+	  || (guint64) s->count * s->record_size > length)
+	return false;
+      s->data = data + offset;
+    }
+
+  strings = find_section (r, SNAP_STRINGS, SNAPSHOT_NO_LAYER);
+  if (strings == NULL || strings->count == 0
+      || strings->data[strings->count - 1] != '\0')
+    return false;
+  r->strings = (const char *) strings->data;
+  r->strings_size = strings->count;
+  return !r->error;
+}
+
+/*!
+ * \brief Check the record sizes of the sections we know.
+ */
+static bool
+check_record_sizes (snap_reader *r)
+{
+  static const struct
+  {
+    guint32 kind, size;
+  } sizes[] =
+  {
+    {SNAP_HEADER, REC_HEADER},
+    {SNAP_SYMBOLS, REC_SYMBOL},
+    {SNAP_SYMBOL_LINES, REC_SYMBOL_LINE},
+    {SNAP_ATTRIBUTES, REC_ATTRIBUTE},
+    {SNAP_VIAS, REC_VIA},
+    {SNAP_ELEMENTS, REC_ELEMENT},
+    {SNAP_PINS, REC_PIN},
+    {SNAP_PADS, REC_PAD},
+    {SNAP_ELEMENT_LINES, REC_ELEMENT_LINE},
+    {SNAP_ELEMENT_ARCS, REC_ELEMENT_ARC},
+    {SNAP_RATS, REC_RAT},
+    {SNAP_LAYER, REC_LAYER},
+    {SNAP_LINES, REC_LINE},
+    {SNAP_ARCS, REC_ARC},
+    {SNAP_TEXTS, REC_TEXT},
+    {SNAP_POLYGONS, REC_POLYGON},
+    {SNAP_POLYGON_POINTS, REC_POLYGON_POINT},
+    {SNAP_POLYGON_HOLES, REC_POLYGON_HOLE},
+    {SNAP_NETS, REC_NET},
+    {SNAP_CONNECTIONS, REC_CONNECTION}
+  };
+  guint32 i, j;
+
+  for (i = 0; i < r->n_sections; i++)
+    for (j = 0; j < sizeof (sizes) / sizeof (sizes[0]); j++)
+      if (r->index[i].kind == sizes[j].kind
+	  && r->index[i].record_size < sizes[j].size)
+	return false;
+  return true;
+}
+
+static bool
+read_header (snap_reader *r, PCBType *pcb)
+{
+  snap_cursor c;
+  char *str;
+
+  cursor_init (&c, r, SNAP_HEADER, SNAPSHOT_NO_LAYER);
+  if (!next_record (&c))
+    return false;
+
+  str = get_string (&c);
+  pcb->Name = str ? strdup (str) : NULL;
+  pcb->MaxWidth = get_coord (&c);
+  pcb->MaxHeight = get_coord (&c);
+  pcb->Grid = get_coord (&c);
+  pcb->GridOffsetX = get_coord (&c);
+  pcb->GridOffsetY = get_coord (&c);
+  Settings.DrawGrid = get_u32 (&c) ? true : false;
+  pcb->IsleArea = get_double (&c);
+  pcb->ThermScale = get_double (&c);
+  pcb->Bloat = get_coord (&c);
+  pcb->Shrink = get_coord (&c);
+  pcb->minWid = get_coord (&c);
+  pcb->minSlk = get_coord (&c);
+  pcb->minDrill = get_coord (&c);
+  pcb->minRing = get_coord (&c);
+  str = get_string (&c);
+  pcb->Flags = string_to_pcbflags (str ? str : "", snapshot_error);
+  str = get_string (&c);
+  if (str != NULL
+      && ParseGroupString (str, &pcb->LayerGroups, &pcb->Data->LayerN))
+    {
+      Message (_("illegal layer-group string\n"));
+      return false;
+    }
+  str = get_string (&c);
+  if (ParseRouteString (str ? str : (char *) "", &pcb->RouteStyle[0], "cmil"))
+    {
+      Message (_("illegal route-style string\n"));
+      return false;
+    }
+  return !r->error;
+}
+
+static bool
+read_font (snap_reader *r, FontType *font)
+{
+  snap_cursor symbols, lines;
+  guint32 i, j, n;
+
+  cursor_init (&symbols, r, SNAP_SYMBOLS, SNAPSHOT_NO_LAYER);
+  if (symbols.section == NULL)
+    return true;
+  cursor_init (&lines, r, SNAP_SYMBOL_LINES, SNAPSHOT_NO_LAYER);
+
+  font->Valid = false;
+  for (i = 0; i <= MAX_FONTPOSITION; i++)
+    free (font->Symbol[i].Line);
+  memset (font->Symbol, 0, sizeof (font->Symbol));
+
+  for (i = 0; i < symbols.section->count && next_record (&symbols); i++)
+    {
+      guint32 position = get_u32 (&symbols);
+      SymbolType *symbol;
+
+      n = get_u32 (&symbols);
+      if (position == 0 || position > MAX_FONTPOSITION
+	  || font->Symbol[position].Valid)
+	return false;
+      symbol = &font->Symbol[position];
+      symbol->Valid = true;
+      symbol->Delta = get_coord (&symbols);
+      for (j = 0; j < n && next_record (&lines); j++)
+	{
+	  Coord x1 = get_coord (&lines);
+	  Coord y1 = get_coord (&lines);
+	  Coord x2 = get_coord (&lines);
+	  Coord y2 = get_coord (&lines);
+
+	  CreateNewLineInSymbol (symbol, x1, y1, x2, y2, get_coord (&lines));
+	}
+    }
+  font->Valid = true;
+  SetFontInfo (font);
+  return !r->error;
+}
+
+static void
+read_vias (snap_reader *r, DataType *data)
+{
+  snap_cursor c;
+  guint32 i;
+
+  cursor_init (&c, r, SNAP_VIAS, SNAPSHOT_NO_LAYER);
+  for (i = 0; c.section && i < c.section->count && next_record (&c); i++)
+    {
+      Coord x = get_coord (&c);
+      Coord y = get_coord (&c);
+      Coord thickness = get_coord (&c);
+      Coord clearance = get_coord (&c);
+      Coord mask = get_coord (&c);
+      Coord drill = get_coord (&c);
+      Cardinal from = get_u32 (&c);
+      Cardinal to = get_u32 (&c);
+      char *name = get_string (&c);
+      FlagType flags = get_flags (&c);
+
+      if (from != 0 || to != 0)
+	CreateNewViaEx (data, x, y, thickness, clearance, mask, drill,
+			name, flags, from, to);
+      else
+	CreateNewVia (data, x, y, thickness, clearance, mask, drill,
+		      name, flags);
+    }
+}
+
+/*!
+ * \brief Create the elements and their pins, pads, lines and arcs.
+ *
+ * \return The created elements, in order, for their attributes.
+ */
+static GPtrArray *
+read_elements (snap_reader *r, DataType *data, FontType *font)
+{
+  snap_cursor c, pins, pads, lines, arcs;
+  GPtrArray *elements = g_ptr_array_new ();
+  guint32 i, j;
+
+  cursor_init (&c, r, SNAP_ELEMENTS, SNAPSHOT_NO_LAYER);
+  cursor_init (&pins, r, SNAP_PINS, SNAPSHOT_NO_LAYER);
+  cursor_init (&pads, r, SNAP_PADS, SNAPSHOT_NO_LAYER);
+  cursor_init (&lines, r, SNAP_ELEMENT_LINES, SNAPSHOT_NO_LAYER);
+  cursor_init (&arcs, r, SNAP_ELEMENT_ARCS, SNAPSHOT_NO_LAYER);
+  for (i = 0; c.section && i < c.section->count && next_record (&c); i++)
+    {
+      ElementType *element;
+      FlagType flags = get_flags (&c);
+      char *description = get_string (&c);
+      char *name = get_string (&c);
+      char *value = get_string (&c);
+      Coord mark_x = get_coord (&c);
+      Coord mark_y = get_coord (&c);
+      Coord text_x = get_coord (&c);
+      Coord text_y = get_coord (&c);
+      BYTE direction = get_u32 (&c);
+      int scale = (gint32) get_u32 (&c);
+      FlagType text_flags = get_flags (&c);
+      guint32 pin_n = get_u32 (&c);
+      guint32 pad_n = get_u32 (&c);
+      guint32 line_n = get_u32 (&c);
+      guint32 arc_n = get_u32 (&c);
+
+      element = CreateNewElement (data, font, flags, description, name,
+				  value, text_x, text_y, direction, scale,
+				  text_flags, false);
+      element->MarkX = mark_x;
+      element->MarkY = mark_y;
+      g_ptr_array_add (elements, element);
+
+      for (j = 0; j < pin_n && next_record (&pins); j++)
+	{
+	  Coord x = get_coord (&pins);
+	  Coord y = get_coord (&pins);
+	  Coord thickness = get_coord (&pins);
+	  Coord clearance = get_coord (&pins);
+	  Coord mask = get_coord (&pins);
+	  Coord drill = get_coord (&pins);
+	  char *pin_name = get_string (&pins);
+	  char *number = get_string (&pins);
+
+	  CreateNewPin (element, x, y, thickness, clearance, mask, drill,
+			pin_name, number, get_flags (&pins));
+	}
+      for (j = 0; j < pad_n && next_record (&pads); j++)
+	{
+	  Coord x1 = get_coord (&pads);
+	  Coord y1 = get_coord (&pads);
+	  Coord x2 = get_coord (&pads);
+	  Coord y2 = get_coord (&pads);
+	  Coord thickness = get_coord (&pads);
+	  Coord clearance = get_coord (&pads);
+	  Coord mask = get_coord (&pads);
+	  char *pad_name = get_string (&pads);
+	  char *number = get_string (&pads);
+
+	  CreateNewPad (element, x1, y1, x2, y2, thickness, clearance, mask,
+			pad_name, number, get_flags (&pads));
+	}
+      for (j = 0; j < line_n && next_record (&lines); j++)
+	{
+	  Coord x1 = get_coord (&lines);
+	  Coord y1 = get_coord (&lines);
+	  Coord x2 = get_coord (&lines);
+	  Coord y2 = get_coord (&lines);
+
+	  CreateNewLineInElement (element, x1, y1, x2, y2,
+				  get_coord (&lines));
+	}
+      for (j = 0; j < arc_n && next_record (&arcs); j++)
+	{
+	  Coord x = get_coord (&arcs);
+	  Coord y = get_coord (&arcs);
+	  Coord width = get_coord (&arcs);
+	  Coord height = get_coord (&arcs);
+	  Coord thickness = get_coord (&arcs);
+	  Angle start = get_double (&arcs);
+	  Angle delta = get_double (&arcs);
+
+	  CreateNewArcInElement (element, x, y, width, height, start, delta,
+				 thickness);
+	}
+      SetElementBoundingBox (data, element, font);
+    }
+  return elements;
+}
+
+static void
+read_rats (snap_reader *r, DataType *data)
+{
+  snap_cursor c;
+  guint32 i;
+
+  cursor_init (&c, r, SNAP_RATS, SNAPSHOT_NO_LAYER);
+  for (i = 0; c.section && i < c.section->count && next_record (&c); i++)
+    {
+      Coord x1 = get_coord (&c);
+      Coord y1 = get_coord (&c);
+      Coord x2 = get_coord (&c);
+      Coord y2 = get_coord (&c);
+      Cardinal group1 = get_u32 (&c);
+      Cardinal group2 = get_u32 (&c);
+
+      CreateNewRat (data, x1, y1, x2, y2, group1, group2,
+		    Settings.RatThickness, get_flags (&c));
+    }
+}
+
+static void
+read_polygons (snap_reader *r, DataType *data, LayerType *layer,
+	       guint32 number)
+{
+  snap_cursor c, points, holes;
+  guint32 i, j, point_n, hole_n, hole;
+
+  cursor_init (&c, r, SNAP_POLYGONS, number);
+  cursor_init (&points, r, SNAP_POLYGON_POINTS, number);
+  cursor_init (&holes, r, SNAP_POLYGON_HOLES, number);
+  for (i = 0; c.section && i < c.section->count && next_record (&c); i++)
+    {
+      PolygonType *polygon = CreateNewPolygon (layer, get_flags (&c));
+      Cardinal contour, contour_start, contour_end;
+      bool bad_contour_found = false;
+
+      point_n = get_u32 (&c);
+      hole_n = get_u32 (&c);
+      hole = point_n;
+      if (hole_n > 0 && next_record (&holes))
+	hole = get_u32 (&holes);
+      for (j = 0; j < point_n && next_record (&points); j++)
+	{
+	  Coord x = get_coord (&points);
+	  Coord y = get_coord (&points);
+
+	  while (j == hole && hole_n > 0)
+	    {
+	      CreateNewHoleInPolygon (polygon);
+	      hole = point_n;
+	      if (--hole_n > 0 && next_record (&holes))
+		hole = get_u32 (&holes);
+	    }
+	  CreateNewPointInPolygon (polygon, x, y);
+	}
+      /* Trailing holes without points are dropped, like WritePCB()
+       * drops them.
+       */
+      for (; hole_n > 1; hole_n--)
+	next_record (&holes);
+
+      /* Same checks as the parser */
+      for (contour = 0; contour <= polygon->HoleIndexN; contour++)
+	{
+	  contour_start = (contour == 0) ?
+	    0 : polygon->HoleIndex[contour - 1];
+	  contour_end = (contour == polygon->HoleIndexN) ?
+	    polygon->PointN : polygon->HoleIndex[contour];
+	  if (contour_end - contour_start < 3)
+	    bad_contour_found = true;
+	}
+      if (bad_contour_found)
+	DestroyObject (data, POLYGON_TYPE, layer, polygon, polygon);
+      else
+	{
+	  SetPolygonBoundingBox (polygon);
+	  if (!layer->polygon_tree)
+	    layer->polygon_tree = r_create_tree (NULL, 0, 0);
+	  r_insert_entry (layer->polygon_tree, (BoxType *) polygon, 0);
+	}
+    }
+}
+
+static bool
+read_layers (snap_reader *r, DataType *data, FontType *font)
+{
+  bool used[MAX_ALL_LAYER];
+  guint32 i, j, number;
+
+  memset (used, 0, sizeof (used));
+  for (i = 0; i < r->n_sections; i++)
+    {
+      snap_cursor c;
+      LayerType *layer;
+      char *name, *type;
+
+      if (r->index[i].kind != SNAP_LAYER)
+	continue;
+      number = r->index[i].layer;
+      if (number >= MAX_ALL_LAYER || used[number])
+	{
+	  Message (_("Layernumber out of range or used twice\n"));
+	  return false;
+	}
+      used[number] = true;
+      layer = &data->Layer[number];
+
+      c.section = &r->index[i];
+      c.next = 0;
+      if (!next_record (&c))
+	return false;
+      name = get_string (&c);
+      type = get_string (&c);
+      free (layer->Name);
+      layer->Name = strdup (name ? name : "");
+      if (type != NULL)
+	layer->Type = string_to_layertype (type, snapshot_error);
+      else
+	layer->Type = guess_layertype (name, number + 1, data);
+
+      cursor_init (&c, r, SNAP_LINES, number);
+      for (j = 0; c.section && j < c.section->count && next_record (&c); j++)
+	{
+	  Coord x1 = get_coord (&c);
+	  Coord y1 = get_coord (&c);
+	  Coord x2 = get_coord (&c);
+	  Coord y2 = get_coord (&c);
+	  Coord thickness = get_coord (&c);
+	  Coord clearance = get_coord (&c);
+
+	  CreateNewLineOnLayer (layer, x1, y1, x2, y2, thickness, clearance,
+				get_flags (&c));
+	}
+
+      cursor_init (&c, r, SNAP_ARCS, number);
+      for (j = 0; c.section && j < c.section->count && next_record (&c); j++)
+	{
+	  Coord x = get_coord (&c);
+	  Coord y = get_coord (&c);
+	  Coord width = get_coord (&c);
+	  Coord height = get_coord (&c);
+	  Coord thickness = get_coord (&c);
+	  Coord clearance = get_coord (&c);
+	  Angle start = get_double (&c);
+	  Angle delta = get_double (&c);
+
+	  CreateNewArcOnLayer (layer, x, y, width, height, start, delta,
+			       thickness, clearance, get_flags (&c));
+	}
+
+      cursor_init (&c, r, SNAP_TEXTS, number);
+      for (j = 0; c.section && j < c.section->count && next_record (&c); j++)
+	{
+	  Coord x = get_coord (&c);
+	  Coord y = get_coord (&c);
+	  unsigned direction = get_u32 (&c);
+	  int scale = (gint32) get_u32 (&c);
+	  char *string = get_string (&c);
+	  FlagType flags = get_flags (&c);
+	  LayerType *text_layer = layer;
+
+	  /* As in the parser */
+	  if (flags.f & ONSILKFLAG)
+	    text_layer = &data->Layer[data->LayerN +
+				      ((flags.f & ONSOLDERFLAG) ?
+				       BOTTOM_SILK_LAYER : TOP_SILK_LAYER)];
+	  CreateNewText (text_layer, font, x, y, direction, scale, string,
+			 flags);
+	}
+
+      read_polygons (r, data, layer, number);
+      if (r->error)
+	return false;
+    }
+  return true;
+}
+
+static void
+read_attributes (snap_reader *r, PCBType *pcb, GPtrArray *elements)
+{
+  snap_cursor c;
+  guint32 i;
+
+  cursor_init (&c, r, SNAP_ATTRIBUTES, SNAPSHOT_NO_LAYER);
+  for (i = 0; c.section && i < c.section->count && next_record (&c); i++)
+    {
+      guint32 owner_type = get_u32 (&c);
+      guint32 owner = get_u32 (&c);
+      char *name = get_string (&c);
+      char *value = get_string (&c);
+      AttributeListType *list;
+
+      if (owner_type == SNAP_ATTR_PCB)
+	list = &pcb->Attributes;
+      else if (owner_type == SNAP_ATTR_LAYER && owner < MAX_ALL_LAYER)
+	list = &pcb->Data->Layer[owner].Attributes;
+      else if (owner_type == SNAP_ATTR_ELEMENT && owner < elements->len)
+	list = &((ElementType *) g_ptr_array_index (elements, owner))
+	  ->Attributes;
+      else
+	{
+	  r->error = true;
+	  return;
+	}
+      CreateNewAttribute (list, name, value ? value : (char *) "");
+    }
+}
+
+static void
+read_netlist (snap_reader *r, PCBType *pcb)
+{
+  snap_cursor c, connections;
+  guint32 i, j, n;
+
+  cursor_init (&c, r, SNAP_NETS, SNAPSHOT_NO_LAYER);
+  cursor_init (&connections, r, SNAP_CONNECTIONS, SNAPSHOT_NO_LAYER);
+  for (i = 0; c.section && i < c.section->count && next_record (&c); i++)
+    {
+      char *name = get_string (&c);
+      char *style = get_string (&c);
+      LibraryMenuType *menu;
+
+      n = get_u32 (&c);
+      menu = CreateNewNet (&pcb->NetlistLib, name ? name : (char *) "",
+			   style ? style : (char *) "");
+      for (j = 0; j < n && next_record (&connections); j++)
+	{
+	  char *connection = get_string (&connections);
+
+	  CreateNewConnection (menu, connection ? connection : (char *) "");
+	}
+    }
+}
+
+/*!
+ * \brief Does the file start with the snapshot magic?
+ */
+bool
+IsSnapshotFile (const char *Filename)
+{
+  char magic[SNAPSHOT_MAGIC_LEN];
+  FILE *fp;
+  bool result;
+
+  if ((fp = fopen (Filename, "rb")) == NULL)
+    return false;
+  result = fread (magic, 1, SNAPSHOT_MAGIC_LEN, fp) == SNAPSHOT_MAGIC_LEN
+    && memcmp (magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) == 0;
+  fclose (fp);
+  return result;
+}
+
+/*!
+ * \brief Load a snapshot into a new board, in place of ParsePCB().
+ *
+ * \return 0 on success, like ParsePCB().
+ */
+int
+LoadSnapshot (PCBType *pcb, char *Filename)
+{
+  snap_reader r;
+  GPtrArray *elements = NULL;
+  PCBType *pcb_save = PCB;
+  DataType *data = pcb->Data;
+  gchar *contents;
+  gsize size;
+  bool ok;
+
+  if (!g_file_get_contents (Filename, &contents, &size, NULL))
+    {
+      Message (_("Can't open %s for reading\n"), Filename);
+      return 1;
+    }
+
+  memset (&r, 0, sizeof (r));
+  r.flags = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+				   NULL, g_free);
+  reader = &r;
+
+  ok = read_index (&r, (const guint8 *) contents, size)
+    && check_record_sizes (&r);
+  if (!ok)
+    Message (_("%s is not a valid snapshot\n"), Filename);
+
+  CreateBeLenient (true);
+  if (ok)
+    {
+      /* Start out like the parser does */
+      data->pcb = pcb;
+      data->LayerN = 0;
+      if (ParseGroupString (Settings.Groups, &pcb->LayerGroups,
+			    &data->LayerN))
+	{
+	  Message (_("illegal default layer-group string\n"));
+	  ok = false;
+	}
+    }
+  ok = ok && read_header (&r, pcb) && read_font (&r, &pcb->Font);
+  if (ok)
+    {
+      read_vias (&r, data);
+      elements = read_elements (&r, data, &pcb->Font);
+      read_rats (&r, data);
+      ok = !r.error && read_layers (&r, data, &pcb->Font);
+    }
+  if (ok)
+    {
+      read_attributes (&r, pcb, elements);
+      read_netlist (&r, pcb);
+      ok = !r.error;
+    }
+  if (ok)
+    {
+      CreateNewPCBPost (pcb, 0);
+      PCB = pcb;
+      PROFILE_PUSH (PROFILE_CLIP);
+      ALLPOLYGON_LOOP (data);
+      {
+	InitClip (data, layer, polygon);
+      }
+      ENDALL_LOOP;
+      PROFILE_POP ();
+      PCB = pcb_save;
+    }
+  else if (r.error)
+    Message (_("Snapshot %s is damaged\n"), Filename);
+  CreateBeLenient (false);
+
+  if (elements != NULL)
+    g_ptr_array_free (elements, TRUE);
+  g_hash_table_destroy (r.flags);
+  g_free (r.index);
+  g_free (contents);
+  reader = NULL;
+  return ok ? 0 : 1;
+}
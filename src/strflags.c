@@ -140,6 +140,63 @@ static FlagBitsType pcb_flagbits[] = {
 
 #undef N
 
+/*!
+ * \brief The flag names of a table, by their first letter.
+ *
+ * string_to_flags() runs for every object of a layout being loaded, so
+ * names are looked up through their first letter and length instead of
+ * comparing them with the whole table.  The chains keep the order of
+ * the table.
+ */
+typedef struct
+{
+  FlagBitsType *flagbits;
+  int n_flagbits;
+  bool built;
+  signed char head[256];	/*!< First entry with this letter, or -1. */
+  signed char next[64];		/*!< Next entry with the same letter. */
+} FlagIndexType;
+
+static FlagIndexType object_index = { object_flagbits, ENTRIES (object_flagbits) };
+static FlagIndexType pcb_index = { pcb_flagbits, ENTRIES (pcb_flagbits) };
+
+static void
+build_flag_index (FlagIndexType *index)
+{
+  int i;
+
+  memset (index->head, -1, sizeof (index->head));
+  for (i = index->n_flagbits - 1; i >= 0; i--)
+    {
+      unsigned char c = index->flagbits[i].name[0];
+
+      index->next[i] = index->head[c];
+      index->head[c] = i;
+    }
+  index->built = true;
+}
+
+/*!
+ * \brief Finds a flag name of length Len in a table.
+ *
+ * \return The table entry, or NULL.
+ */
+static FlagBitsType *
+find_flag (FlagIndexType *index, const char *Name, int Len)
+{
+  int i;
+
+  if (!index->built)
+    build_flag_index (index);
+  if (Len == 0)
+    return NULL;
+  for (i = index->head[(unsigned char) Name[0]]; i >= 0; i = index->next[i])
+    if (index->flagbits[i].nlen == Len
+	&& memcmp (index->flagbits[i].name, Name, Len) == 0)
+      return &index->flagbits[i];
+  return NULL;
+}
+
 /*
  * This helper function maintains a small list of buffers which are
  * used by flags_to_string().  Each buffer is allocated from the heap,
@@ -171,6 +228,8 @@ alloc_buf (int len)
 #undef B
 }
 
+static void uninit_flag_cache (void);
+
 void
 uninit_strflags_buf (void)
 {
@@ -183,6 +242,7 @@ uninit_strflags_buf (void)
           buffers[n].ptr = NULL;
         }
     }
+  uninit_flag_cache ();
 }
 
 static char *layers = 0;
@@ -424,12 +484,12 @@ static FlagType empty_flags;
 static FlagType
 common_string_to_flags (const char *flagstring,
 			int (*error) (const char *msg),
-			FlagBitsType *flagbits,
-			int n_flagbits)
+			FlagIndexType *index)
 {
   const char *fp, *ep;
   int flen;
   FlagHolder rv;
+  FlagBitsType *bits;
   int i;
 
   rv.Flags = empty_flags;
@@ -447,8 +507,6 @@ common_string_to_flags (const char *flagstring,
 
   while (*ep && *ep != '"')
     {
-      int found = 0;
-
       for (ep = fp; *ep && *ep != ',' && *ep != '"' && *ep != '('; ep++)
 	;
       flen = ep - fp;
@@ -461,23 +519,14 @@ common_string_to_flags (const char *flagstring,
 	    if (layers[i])
 	      ASSIGN_THERM (i, layers[i], &rv);
 	}
+      else if ((bits = find_flag (index, fp, flen)) != NULL)
+	SET_FLAG (bits->mask, &rv);
       else
 	{
-	  for (i = 0; i < n_flagbits; i++)
-	    if (flagbits[i].nlen == flen
-		&& memcmp (flagbits[i].name, fp, flen) == 0)
-	      {
-		found = 1;
-		SET_FLAG (flagbits[i].mask, &rv);
-		break;
-	      }
-	  if (!found)
-	    {
-	      const char *fmt = "Unknown flag: \"%.*s\" ignored";
-	      char *msg = alloc_buf (strlen (fmt) + flen);
-	      sprintf (msg, fmt, flen, fp);
-	      error (msg);
-	    }
+	  const char *fmt = "Unknown flag: \"%.*s\" ignored";
+	  char *msg = alloc_buf (strlen (fmt) + flen);
+	  sprintf (msg, fmt, flen, fp);
+	  error (msg);
 	}
       fp = ep + 1;
     }
@@ -497,10 +546,7 @@ FlagType
 string_to_flags (const char *flagstring,
 		 int (*error) (const char *msg))
 {
-  return common_string_to_flags (flagstring,
-				 error,
-				 object_flagbits,
-				 ENTRIES (object_flagbits));
+  return common_string_to_flags (flagstring, error, &object_index);
 }
 
 /*!
@@ -516,10 +562,7 @@ FlagType
 string_to_pcbflags (const char *flagstring,
 		    int (*error) (const char *msg))
 {
-  return common_string_to_flags (flagstring,
-				 error,
-				 pcb_flagbits,
-				 ENTRIES (pcb_flagbits));
+  return common_string_to_flags (flagstring, error, &pcb_index);
 }
 
 /*!
@@ -617,6 +660,35 @@ common_flags_to_string (FlagType flags,
   return buf;
 }
 
+/*!
+ * \brief Strings made by flags_to_string(), by flags and object type.
+ *
+ * A layout uses few combinations of flags, so each is formatted once
+ * and then found in this open addressed table.  The strings are kept
+ * until uninit_strflags_buf(); once the table is three quarters full,
+ * new combinations are formatted each time.
+ */
+#define FLAG_CACHE_SIZE 1024
+
+static struct
+{
+  FlagType flags;
+  int object_type;
+  char *string;
+} flag_cache[FLAG_CACHE_SIZE];
+static int flag_cache_used = 0;
+
+static unsigned int
+hash_flags (FlagType *flags, int object_type)
+{
+  unsigned int h = (unsigned int) flags->f * 2654435761u ^ object_type;
+  int i;
+
+  for (i = 0; i < sizeof (flags->t); i++)
+    h = h * 31 + flags->t[i];
+  return h ^ (h >> 16);
+}
+
 /*!
  * \brief Object flags converted to strings.
  *
@@ -628,10 +700,40 @@ common_flags_to_string (FlagType flags,
 char *
 flags_to_string (FlagType flags, int object_type)
 {
-  return common_flags_to_string (flags,
-				 object_type,
-				 object_flagbits,
-				 ENTRIES (object_flagbits));
+  unsigned int i = hash_flags (&flags, object_type) & (FLAG_CACHE_SIZE - 1);
+  char *string;
+
+  for (; flag_cache[i].string != NULL; i = (i + 1) & (FLAG_CACHE_SIZE - 1))
+    if (flag_cache[i].flags.f == flags.f
+	&& flag_cache[i].object_type == object_type
+	&& memcmp (flag_cache[i].flags.t, flags.t, sizeof (flags.t)) == 0)
+      return flag_cache[i].string;
+
+  string = common_flags_to_string (flags,
+				   object_type,
+				   object_flagbits,
+				   ENTRIES (object_flagbits));
+  if (flag_cache_used >= FLAG_CACHE_SIZE * 3 / 4)
+    return string;
+
+  flag_cache[i].flags = flags;
+  flag_cache[i].object_type = object_type;
+  flag_cache[i].string = strdup (string);
+  flag_cache_used++;
+  return flag_cache[i].string;
+}
+
+static void
+uninit_flag_cache (void)
+{
+  int i;
+
+  for (i = 0; i < FLAG_CACHE_SIZE; i++)
+    {
+      free (flag_cache[i].string);
+      flag_cache[i].string = NULL;
+    }
+  flag_cache_used = 0;
 }
 
 /*!
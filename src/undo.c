@@ -67,6 +67,7 @@
 #include "error.h"
 #include "flags.h"
 #include "insert.h"
+#include "journal.h"
 #include "misc.h"
 #include "mirror.h"
 #include "move.h"
@@ -221,6 +222,7 @@ static bool andDraw = true;
  * some local prototypes
  */
 static UndoListType *GetUndoSlot (int, int, int);
+static void JournalTouchEntry (UndoListType *);
 static void DrawRecoveredObject (int, void *, void *, void *);
 static bool UndoRotate (UndoListType *);
 static bool UndoChangeName (UndoListType *);
@@ -312,6 +314,41 @@ GetUndoSlot (int CommandType, int ID, int Kind)
   return (ptr);
 }
 
+/*!
+ * \brief Tells the journal about the object an undo entry is about to
+ * change.
+ */
+static void
+JournalTouchEntry (UndoListType *Entry)
+{
+  void *ptr1, *ptr2, *ptr3;
+  int type;
+
+  if (!JournalActive ())
+    return;
+  if (Entry->Type == UNDO_LAYERCHANGE || Entry->Type == UNDO_NETLISTCHANGE)
+    {
+      JournalTouch (Entry->Type, NO_TYPE, NULL, NULL, NULL);
+      return;
+    }
+
+  type =
+    SearchObjectByID (PCB->Data, &ptr1, &ptr2, &ptr3, Entry->ID, Entry->Kind);
+  if (type == NO_TYPE && RemoveList)
+    type =
+      SearchObjectByID (RemoveList, &ptr1, &ptr2, &ptr3, Entry->ID,
+			Entry->Kind);
+  if (type != NO_TYPE)
+    JournalTouch (Entry->Type, type, ptr1, ptr2, ptr3);
+
+  /* contour changes swap the polygon with its saved copy */
+  if ((Entry->Type == UNDO_REMOVE_CONTOUR
+       || Entry->Type == UNDO_INSERT_CONTOUR) && RemoveList
+      && SearchObjectByID (RemoveList, &ptr1, &ptr2, &ptr3,
+			   Entry->Data.CopyID, Entry->Kind) != NO_TYPE)
+    JournalTouch (Entry->Type, Entry->Kind, ptr1, ptr2, ptr3);
+}
+
 /*!
  * \brief Redraws the recovered object.
  */
@@ -1122,13 +1159,17 @@ Undo (bool draw)
   /* Loop over all entries with the correct serial number */
   for (; UndoN && ptr->Serial == Serial; ptr--, UndoN--, RedoN++)
     {
-      int undid = PerformUndo (ptr);
+      int undid;
+
+      JournalTouchEntry (ptr);
+      undid = PerformUndo (ptr);
       if (undid == 0)
         error_undoing = true;
       Types |= undid;
     }
 
   UnlockUndo ();
+  JournalCommit ();
 
   if (error_undoing)
     Message (_("ERROR: Failed to undo some operations\n"));
@@ -1300,7 +1341,10 @@ Redo (bool draw)
   /* and loop over all entries with the correct serial number */
   for (; RedoN && ptr->Serial == Serial; ptr++, UndoN++, RedoN--)
     {
-      int undid = PerformUndo (ptr);
+      int undid;
+
+      JournalTouchEntry (ptr);
+      undid = PerformUndo (ptr);
       if (undid == 0)
         error_undoing = true;
       Types |= undid;
@@ -1310,6 +1354,7 @@ Redo (bool draw)
   Serial++;
 
   UnlockUndo ();
+  JournalCommit ();
 
   if (error_undoing)
     Message (_("ERROR: Failed to redo some operations\n"));
@@ -1370,6 +1415,7 @@ IncrementUndoSerialNumber (void)
       Serial++;
       Bumped = true;
       between_increment_and_restore = true;
+      JournalCommit ();
       return Serial;
     }
   return -1;
@@ -1414,6 +1460,9 @@ ClearUndoList (bool Force)
 {
   UndoListType *undo;
 
+  /* the journal still refers to objects in the remove list */
+  JournalCommit ();
+
   if (UndoN
       && (Force || gui->confirm_dialog ("OK to clear 'undo' buffer?", 0)))
     {
@@ -1451,6 +1500,7 @@ AddObjectToClearPolyUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CLEAR, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_CLEAR, OBJECT_ID (Ptr3), Type);
       undo->Data.ClearPoly.Clear = clear;
       undo->Data.ClearPoly.Layer = (LayerType *) Ptr1;
@@ -1468,6 +1518,7 @@ AddObjectToMirrorUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 
   if (!Locked)
     {
+      JournalTouch (UNDO_MIRROR, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_MIRROR, OBJECT_ID (Ptr3), Type);
       undo->Data.Move.DY = yoff;
     }
@@ -1485,6 +1536,7 @@ AddObjectToRotateUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 
   if (!Locked)
     {
+      JournalTouch (UNDO_ROTATE, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_ROTATE, OBJECT_ID (Ptr3), Type);
       undo->Data.Rotate.CenterX = CenterX;
       undo->Data.Rotate.CenterY = CenterY;
@@ -1505,6 +1557,7 @@ MoveObjectToRemoveUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
   if (!RemoveList)
     RemoveList = CreateNewBuffer ();
 
+  JournalTouch (UNDO_REMOVE, Type, Ptr1, Ptr2, Ptr3);
   GetUndoSlot (UNDO_REMOVE, OBJECT_ID (Ptr3), Type);
   MoveObjectToBuffer (RemoveList, PCB->Data, Type, Ptr1, Ptr2, Ptr3);
 }
@@ -1530,6 +1583,7 @@ AddObjectToRemovePointUndoList (int Type,
 	    /* save the ID of the parent object; else it will be
 	     * impossible to recover the point
 	     */
+	    JournalTouch (UNDO_REMOVE_POINT, Type, Ptr1, Ptr2, NULL);
 	    undo =
 	      GetUndoSlot (UNDO_REMOVE_POINT, OBJECT_ID (polygon),
 			   POLYGON_TYPE);
@@ -1561,7 +1615,10 @@ void
 AddObjectToInsertPointUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 {
   if (!Locked)
-    GetUndoSlot (UNDO_INSERT_POINT, OBJECT_ID (Ptr3), Type);
+    {
+      JournalTouch (UNDO_INSERT_POINT, Type, Ptr1, Ptr2, Ptr3);
+      GetUndoSlot (UNDO_INSERT_POINT, OBJECT_ID (Ptr3), Type);
+    }
 }
 
 static void
@@ -1576,6 +1633,7 @@ CopyObjectToUndoList (int undo_type, int Type, void *Ptr1, void *Ptr2, void *Ptr
   if (!RemoveList)
     RemoveList = CreateNewBuffer ();
 
+  JournalTouch (undo_type, Type, Ptr1, Ptr2, Ptr3);
   undo = GetUndoSlot (undo_type, OBJECT_ID (Ptr2), Type);
   copy = (AnyObjectType *)CopyObjectToBuffer (RemoveList, PCB->Data, Type, Ptr1, Ptr2, Ptr3);
   undo->Data.CopyID = copy->ID;
@@ -1616,6 +1674,7 @@ AddObjectToMoveUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 
   if (!Locked)
     {
+      JournalTouch (UNDO_MOVE, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_MOVE, OBJECT_ID (Ptr3), Type);
       undo->Data.Move.DX = DX;
       undo->Data.Move.DY = DY;
@@ -1633,6 +1692,7 @@ AddObjectToChangeNameUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3,
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CHANGENAME, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_CHANGENAME, OBJECT_ID (Ptr3), Type);
       undo->Data.ChangeName.Name = OldName;
     }
@@ -1648,6 +1708,7 @@ AddObjectToMoveToLayerUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_MOVETOLAYER, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_MOVETOLAYER, OBJECT_ID (Ptr3), Type);
       undo->Data.MoveToLayer.OriginalLayer =
 	GetLayerNumber (PCB->Data, (LayerType *) Ptr1);
@@ -1661,7 +1722,10 @@ void
 AddObjectToCreateUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 {
   if (!Locked)
-    GetUndoSlot (UNDO_CREATE, OBJECT_ID (Ptr3), Type);
+    {
+      JournalTouch (UNDO_CREATE, Type, Ptr1, Ptr2, Ptr3);
+      GetUndoSlot (UNDO_CREATE, OBJECT_ID (Ptr3), Type);
+    }
   ClearFromPolygon (PCB->Data, Type, Ptr1, Ptr2);
 }
 
@@ -1675,6 +1739,7 @@ AddObjectToFlagUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_FLAG, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_FLAG, OBJECT_ID (Ptr2), Type);
       undo->Data.Flags = ((PinType *) Ptr2)->Flags;
     }
@@ -1690,6 +1755,7 @@ AddObjectToSizeUndoList (int Type, void *ptr1, void *ptr2, void *ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CHANGESIZE, Type, ptr1, ptr2, ptr3);
       undo = GetUndoSlot (UNDO_CHANGESIZE, OBJECT_ID (ptr2), Type);
       switch (Type)
 	{
@@ -1726,6 +1792,7 @@ AddObjectToClearSizeUndoList (int Type, void *ptr1, void *ptr2, void *ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CHANGECLEARSIZE, Type, ptr1, ptr2, ptr3);
       undo = GetUndoSlot (UNDO_CHANGECLEARSIZE, OBJECT_ID (ptr2), Type);
       switch (Type)
 	{
@@ -1756,6 +1823,7 @@ AddObjectToMaskSizeUndoList (int Type, void *ptr1, void *ptr2, void *ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CHANGEMASKSIZE, Type, ptr1, ptr2, ptr3);
       undo = GetUndoSlot (UNDO_CHANGEMASKSIZE, OBJECT_ID (ptr2), Type);
       switch (Type)
 	{
@@ -1780,6 +1848,7 @@ AddObjectTo2ndSizeUndoList (int Type, void *ptr1, void *ptr2, void *ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CHANGE2NDSIZE, Type, ptr1, ptr2, ptr3);
       undo = GetUndoSlot (UNDO_CHANGE2NDSIZE, OBJECT_ID (ptr2), Type);
       if (Type == PIN_TYPE || Type == VIA_TYPE)
 	undo->Data.Size = ((PinType *) ptr2)->DrillingHole;
@@ -1800,6 +1869,7 @@ AddObjectToChangeAnglesUndoList (int Type, void *Ptr1, void *Ptr2, void *Ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CHANGEANGLES, Type, Ptr1, Ptr2, Ptr3);
       undo = GetUndoSlot (UNDO_CHANGEANGLES, OBJECT_ID (Ptr3), Type);
       undo->Data.Move.DX = a->StartAngle;
       undo->Data.Move.DY = a->Delta;
@@ -1816,6 +1886,7 @@ AddLayerChangeToUndoList (int old_index, int new_index)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_LAYERCHANGE, NO_TYPE, NULL, NULL, NULL);
       undo = GetUndoSlot (UNDO_LAYERCHANGE, 0, 0);
       undo->Data.LayerChange.old_index = old_index;
       undo->Data.LayerChange.new_index = new_index;
@@ -1834,6 +1905,7 @@ AddNetlistLibToUndoList (LibraryType *lib)
   
   if (!Locked)
     {
+      JournalTouch (UNDO_NETLISTCHANGE, NO_TYPE, NULL, NULL, NULL);
       undo = GetUndoSlot (UNDO_NETLISTCHANGE, 0, 0);
       /* keep track of where the data needs to go */
       undo->Data.NetlistChange.lib = lib;
@@ -1924,6 +1996,7 @@ AddObjectToSetViaLayersUndoList (void *ptr1, void *ptr2, void *ptr3)
 
   if (!Locked)
     {
+      JournalTouch (UNDO_CHANGESETVIALAYERS, VIA_TYPE, ptr1, ptr2, ptr3);
       undo = GetUndoSlot (UNDO_CHANGESETVIALAYERS, OBJECT_ID (ptr2), VIA_TYPE);
       undo->Data.SetViaLayersChange.from = ((PinType *) ptr2)->BuriedFrom;
       undo->Data.SetViaLayersChange.to = ((PinType *) ptr2)->BuriedTo;
@@ -0,0 +1,7 @@
+Element["" "via footprint" "" "" 0.0000 0.0000 -30.00mil -150.00mil 0 100 ""]
+(
+	Pin[0.0000 0.0000 60.00mil 20.00mil 66.00mil 30.00mil "1" "1" ""]
+	ElementLine [-50.00mil -100.00mil -50.00mil 100.00mil 10.00mil]
+
+	)
+Via[100.00mil 0.0000 40.00mil 20.00mil 0.0000 20.00mil "" ""]
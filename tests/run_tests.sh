@@ -178,6 +178,10 @@ else
 	PCB=${PCB:-../../../src/pcbtest.sh}
 fi
 
+# Have pcb check its fast scanner against flex on every file it loads
+PCB_LEXER_CHECK=1
+export PCB_LEXER_CHECK
+
 # The gerbv executible 
 GERBV=${GERBV:-gerbv}
 GERBV_DEFAULT_FLAGS=${GERBV_DEFAULT_FLAGS:---export=png --window=640x480}
@@ -237,6 +241,7 @@ TESTFILESTRING=`sed -e':x
                          }'  $TESTLIST`
 
 if test -z "$all_tests" ; then
+    check_inputs=yes
     all_tests=`echo "${TESTFILESTRING}" \
                | ${AWK} 'BEGIN{FS="|"} /^#/{next} {print $1}'\
                | sed 's; ;;g'`
@@ -883,7 +888,7 @@ for t in $all_tests ; do
         *.pcb)
           pcb_files="${pcb_files} ${f}"
           ;;
-        *.attrs)
+        *.attrs|*.fp)
           continue
           ;;
         *)
@@ -1027,6 +1032,90 @@ for t in $all_tests ; do
 
 done
 
+##########################################################################
+#
+# Load every input layout once, so that PCB_LEXER_CHECK compares the
+# fast scanner with flex on all of them and not only on the ones the
+# tests above happen to use.
+#
+
+if test "X${check_inputs}" = "Xyes" && test "X$regen" != "Xyes" ; then
+    rundir="${OUTDIR}/LexerCheck"
+    test -d ${rundir} && rm -fr ${rundir}
+    mkdir -p ${rundir}
+    for f in ${INDIR}/*.pcb ; do
+	show_sep
+	fn=`basename $f`
+	echo "Scanner check:  ${fn}"
+	tot=`expr $tot + 1`
+	cp "$f" "${rundir}"
+	chmod u+w "${rundir}/${fn}"
+	(cd ${rundir} && ${PCB} -x bom --bomfile /dev/null --xyfile /dev/null \
+	    ${fn} 2> ${fn}.err.log)
+	if test $? -ne 0 ; then
+	    cat ${rundir}/${fn}.err.log
+	    echo "FAIL"
+	    fail=`expr $fail + 1`
+	else
+	    echo "PASSED"
+	    pass=`expr $pass + 1`
+	    rm -f ${rundir}/${fn} ${rundir}/${fn}.err.log
+	fi
+    done
+fi
+
+##########################################################################
+#
+# Check the newlib library index: a first run writes it, a second run
+# with unchanged directories takes the footprints from it without
+# reading them, and a run after a directory changed reads that one
+# again.  The directories are dated back so their mtime can be trusted.
+#
+
+libindex_run () {
+    (cd ${rundir} && ${PCB} -x bom --bomfile /dev/null --xyfile /dev/null \
+	--lib-newlib `pwd`/newlib --lib-index library-index \
+	--action-string "DumpLibrary()" default.pcb > $1 2> $1.err.log)
+}
+
+if test "X${check_inputs}" = "Xyes" && test "X$regen" != "Xyes" ; then
+    show_sep
+    echo "Library index check"
+    tot=`expr $tot + 1`
+    rundir="${OUTDIR}/LibraryIndex"
+    test -d ${rundir} && rm -fr ${rundir}
+    mkdir -p ${rundir}/newlib/sub
+    cp "${INDIR}/default.pcb" "${rundir}"
+    chmod u+w "${rundir}/default.pcb"
+    echo 'Element["" "" "" "" 0 0 0 0 0 100 ""] ()' > ${rundir}/newlib/sub/one.fp
+    touch -t 200001010000 ${rundir}/newlib/sub ${rundir}/newlib
+    libindex_failed=no
+
+    libindex_run first.txt || libindex_failed=yes
+    grep 'newlib: "one.fp"' ${rundir}/first.txt > /dev/null || libindex_failed=yes
+    grep '^F one.fp$' ${rundir}/library-index > /dev/null || libindex_failed=yes
+
+    # a new file the index can't know about, as the mtime is put back
+    cp ${rundir}/newlib/sub/one.fp ${rundir}/newlib/sub/two.fp
+    touch -t 200001010000 ${rundir}/newlib/sub
+    libindex_run second.txt || libindex_failed=yes
+    grep 'newlib: "one.fp"' ${rundir}/second.txt > /dev/null || libindex_failed=yes
+    grep 'newlib: "two.fp"' ${rundir}/second.txt > /dev/null && libindex_failed=yes
+
+    touch ${rundir}/newlib/sub
+    libindex_run third.txt || libindex_failed=yes
+    grep 'newlib: "two.fp"' ${rundir}/third.txt > /dev/null || libindex_failed=yes
+    grep '^F two.fp$' ${rundir}/library-index > /dev/null || libindex_failed=yes
+
+    if test $libindex_failed = yes ; then
+	echo "FAIL"
+	fail=`expr $fail + 1`
+    else
+	echo "PASSED"
+	pass=`expr $pass + 1`
+    fi
+fi
+
 show_sep
 echo "Passed $pass, failed $fail, skipped $skip out of $tot tests."
 